@@ -0,0 +1,414 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * etui-bench: measures the opening of a document and the rendering of
+ * its pages, with the headless API and with an Etui object on a buffer
+ * canvas, and prints the results as one JSON object on stdout. The
+ * canvas goes through page_set, render_pre, render and render_end, so
+ * the modules without page_raster are measured too. One document per
+ * process, so that the peak RSS is the one of the document.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/resource.h>
+#endif
+
+#include <Eina.h>
+#include <Ecore.h>
+#include <Ecore_Getopt.h>
+#include <Ecore_Evas.h>
+#include <Evas.h>
+
+#include <Etui.h>
+
+typedef struct
+{
+    double min;
+    double max;
+    double total;
+    unsigned long long pixels;
+    int count;
+} Etui_Bench_Stat;
+
+/* a page not shown after this delay is a failed render */
+#define ETUI_BENCH_CANVAS_TIMEOUT 60.0
+
+typedef struct
+{
+    Ecore_Timer *timeout;
+    double time;
+    int page;
+    Eina_Bool rendered;
+} Etui_Bench_Canvas;
+
+static const Ecore_Getopt options = {
+    "etui-bench",
+    "%prog [options] filename",
+    PACKAGE_VERSION,
+    "(C) 2013-2020 Vincent Torri and others",
+    "AGPL v3",
+    "Measure the opening and the rendering of a document.",
+    EINA_TRUE,
+    {
+        ECORE_GETOPT_STORE_DOUBLE('s', "scale",
+                                  "Scale of the pages (default: 1.0)."),
+        ECORE_GETOPT_STORE_INT('n', "pages",
+                               "Number of page turns of each pass (default: 16)."),
+        ECORE_GETOPT_STORE_INT('r', "seed",
+                               "Seed of the random page turns (default: 1)."),
+
+        ECORE_GETOPT_VERSION   ('V', "version"),
+        ECORE_GETOPT_HELP      ('h', "help"),
+        ECORE_GETOPT_SENTINEL
+    }
+};
+
+static void
+_etui_bench_stat_add(Etui_Bench_Stat *stat, double t, int width, int height)
+{
+    if (!stat->count || (t < stat->min)) stat->min = t;
+    if (!stat->count || (t > stat->max)) stat->max = t;
+    stat->total += t;
+    stat->pixels += (unsigned long long)width * height;
+    stat->count++;
+}
+
+static Eina_Bool
+_etui_bench_page(Etui_File *ef, int page_num, double scale, Etui_Bench_Stat *stat)
+{
+    unsigned int *pixels;
+    double t;
+    Eina_Bool res;
+    int width;
+    int height;
+
+    /* the size is part of the latency, as in a page turn */
+    t = ecore_time_get();
+    if (!etui_file_page_raster_size_get(ef, page_num, scale, ETUI_ROTATION_0,
+                                        &width, &height))
+        return EINA_FALSE;
+
+    pixels = (unsigned int *)malloc((size_t)width * height * sizeof(unsigned int));
+    if (!pixels)
+        return EINA_FALSE;
+
+    res = etui_file_page_render_to_buffer(ef, page_num, scale, ETUI_ROTATION_0,
+                                          pixels, width * 4);
+    t = ecore_time_get() - t;
+    free(pixels);
+
+    if (!res)
+        return EINA_FALSE;
+
+    _etui_bench_stat_add(stat, t, width, height);
+
+    return EINA_TRUE;
+}
+
+static void
+_etui_bench_canvas_rendered_cb(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
+{
+    Etui_Bench_Canvas *canvas;
+
+    canvas = data;
+    if (*(int *)event_info != canvas->page)
+        return;
+
+    canvas->time = ecore_time_get() - canvas->time;
+    canvas->rendered = EINA_TRUE;
+    ecore_main_loop_quit();
+}
+
+static Eina_Bool
+_etui_bench_canvas_timeout_cb(void *data)
+{
+    Etui_Bench_Canvas *canvas;
+
+    canvas = data;
+    canvas->timeout = NULL;
+    ecore_main_loop_quit();
+
+    return ECORE_CALLBACK_CANCEL;
+}
+
+/* from the page turn to the page shown, as in the viewer */
+static Eina_Bool
+_etui_bench_canvas_page(Evas_Object *obj, Etui_Bench_Canvas *canvas, int page_num, double scale, Etui_Bench_Stat *stat)
+{
+    int width;
+    int height;
+
+    /* the current page is not rendered again */
+    if (page_num == etui_object_page_get(obj))
+        return EINA_FALSE;
+
+    canvas->page = page_num;
+    canvas->rendered = EINA_FALSE;
+    canvas->time = ecore_time_get();
+    etui_object_page_set(obj, page_num);
+    if (!EINA_DBL_EQ(etui_object_page_scale_get(obj), scale))
+        etui_object_page_scale_set(obj, scale);
+
+    canvas->timeout = ecore_timer_add(ETUI_BENCH_CANVAS_TIMEOUT,
+                                      _etui_bench_canvas_timeout_cb, canvas);
+    ecore_main_loop_begin();
+    if (canvas->timeout)
+    {
+        ecore_timer_del(canvas->timeout);
+        canvas->timeout = NULL;
+    }
+
+    if (!canvas->rendered)
+        return EINA_FALSE;
+
+    etui_object_page_size_get(obj, &width, &height);
+    _etui_bench_stat_add(stat, canvas->time, width, height);
+
+    return EINA_TRUE;
+}
+
+/* the document is opened again, so that its first page is not warmed up */
+static void
+_etui_bench_canvas_run(const char *filename, double scale, int pages, int seed,
+                       Etui_Bench_Stat *first, Etui_Bench_Stat *sequential,
+                       Etui_Bench_Stat *shuffled)
+{
+    Etui_Bench_Canvas canvas;
+    Etui_File *ef;
+    Ecore_Evas *ee;
+    Evas_Object *obj;
+    int count;
+    int i;
+
+    ef = etui_file_new(filename);
+    if (!ef)
+    {
+        fprintf(stderr, "can not open file %s\n", filename);
+        return;
+    }
+
+    ee = ecore_evas_buffer_new(1, 1);
+    if (!ee)
+    {
+        fprintf(stderr, "can not create the buffer canvas\n");
+        etui_file_free(ef);
+        return;
+    }
+    ecore_evas_show(ee);
+
+    memset(&canvas, 0, sizeof(canvas));
+    obj = etui_object_add(ecore_evas_get(ee));
+    evas_object_smart_callback_add(obj, "page,rendered",
+                                   _etui_bench_canvas_rendered_cb, &canvas);
+    etui_object_file_set(obj, ef);
+    /* each page turn renders, nothing is kept or rendered ahead */
+    etui_object_cache_size_set(obj, 0);
+    etui_object_prefetch_set(obj, 0, 0);
+    etui_object_tiled_set(obj, EINA_FALSE);
+    evas_object_show(obj);
+
+    count = etui_object_document_pages_count(obj);
+    if ((count > 0) && _etui_bench_canvas_page(obj, &canvas, 0, scale, first))
+    {
+        for (i = 1; (i <= pages) && (count > 1); i++)
+            _etui_bench_canvas_page(obj, &canvas, i % count, scale, sequential);
+
+        srand(seed);
+        for (i = 0; i < pages; i++)
+            _etui_bench_canvas_page(obj, &canvas, rand() % count, scale, shuffled);
+    }
+
+    evas_object_del(obj);
+    ecore_evas_free(ee);
+    etui_file_free(ef);
+}
+
+static void
+_etui_bench_stat_print(const char *name, const Etui_Bench_Stat *stat)
+{
+    if (!stat->count)
+    {
+        printf(",\n  \"%s\": null", name);
+        return;
+    }
+
+    printf(",\n  \"%s\": { \"count\": %d, \"min_ms\": %.3f, \"mean_ms\": %.3f, "
+           "\"max_ms\": %.3f, \"pixels_per_second\": %.0f }",
+           name, stat->count,
+           stat->min * 1000.0, stat->total * 1000.0 / stat->count,
+           stat->max * 1000.0,
+           (stat->total > 0.0) ? stat->pixels / stat->total : 0.0);
+}
+
+static long
+_etui_bench_peak_rss_get(void)
+{
+#ifndef _WIN32
+    struct rusage usage;
+
+    /* kilobytes on Linux and BSD, bytes on macOS */
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+# ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+# else
+        return usage.ru_maxrss;
+# endif
+    }
+#endif
+
+    return -1;
+}
+
+int
+main(int argc, char **argv)
+{
+    Etui_Bench_Stat first;
+    Etui_Bench_Stat sequential;
+    Etui_Bench_Stat shuffled;
+    Etui_Bench_Stat canvas_first;
+    Etui_Bench_Stat canvas_sequential;
+    Etui_Bench_Stat canvas_shuffled;
+    Etui_File *ef;
+    const char *filename;
+    const char *s;
+    double open_time;
+    double scale = 1.0;
+    int pages = 16;
+    int seed = 1;
+    int count;
+    int args;
+    int ret = 1;
+    int i;
+    Eina_Bool quit_option = EINA_FALSE;
+    Ecore_Getopt_Value values[] = {
+        ECORE_GETOPT_VALUE_DOUBLE(scale),
+        ECORE_GETOPT_VALUE_INT(pages),
+        ECORE_GETOPT_VALUE_INT(seed),
+
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+
+        ECORE_GETOPT_VALUE_NONE
+    };
+
+    if (!etui_init())
+    {
+        fprintf(stderr, "could not initialize Etui library.\n");
+        return 1;
+    }
+
+    if (!ecore_evas_init())
+    {
+        fprintf(stderr, "could not initialize Ecore_Evas library.\n");
+        goto shutdown_etui;
+    }
+
+    args = ecore_getopt_parse(&options, values, argc, argv);
+    if (args < 0)
+    {
+        fprintf(stderr, "Could not parse command line options.\n");
+        goto shutdown_ecore_evas;
+    }
+
+    if (quit_option)
+    {
+        ret = 0;
+        goto shutdown_ecore_evas;
+    }
+
+    if (args != (argc - 1))
+    {
+        ecore_getopt_help(stderr, &options);
+        goto shutdown_ecore_evas;
+    }
+
+    filename = argv[args];
+
+    /* only the module is measured, not the hash of the file for the disk cache */
+    etui_disk_cache_size_set(0);
+
+    open_time = ecore_time_get();
+    ef = etui_file_new(filename);
+    open_time = ecore_time_get() - open_time;
+    if (!ef)
+    {
+        fprintf(stderr, "can not open file %s\n", filename);
+        goto shutdown_ecore_evas;
+    }
+
+    memset(&first, 0, sizeof(first));
+    memset(&sequential, 0, sizeof(sequential));
+    memset(&shuffled, 0, sizeof(shuffled));
+    memset(&canvas_first, 0, sizeof(canvas_first));
+    memset(&canvas_sequential, 0, sizeof(canvas_sequential));
+    memset(&canvas_shuffled, 0, sizeof(canvas_shuffled));
+
+    count = etui_file_pages_count(ef);
+
+    /* a module without page_raster() has no render result */
+    if ((count > 0) && _etui_bench_page(ef, 0, scale, &first))
+    {
+        for (i = 1; (i <= pages) && (count > 1); i++)
+            _etui_bench_page(ef, i % count, scale, &sequential);
+
+        srand(seed);
+        for (i = 0; i < pages; i++)
+            _etui_bench_page(ef, rand() % count, scale, &shuffled);
+    }
+
+    _etui_bench_canvas_run(filename, scale, pages, seed,
+                           &canvas_first, &canvas_sequential, &canvas_shuffled);
+
+    s = strrchr(filename, '/');
+    s = s ? s + 1 : filename;
+    printf("{\n  \"file\": \"");
+    for (; *s; s++)
+    {
+        if ((*s == '"') || (*s == '\\'))
+            putchar('\\');
+        putchar(*s);
+    }
+    printf("\",\n  \"module\": \"%s\",\n  \"pages\": %d,\n  \"scale\": %.3f,\n"
+           "  \"open_ms\": %.3f",
+           etui_file_module_name_get(ef), count, scale, open_time * 1000.0);
+    _etui_bench_stat_print("first_page", &first);
+    _etui_bench_stat_print("sequential", &sequential);
+    _etui_bench_stat_print("random", &shuffled);
+    _etui_bench_stat_print("canvas_first_page", &canvas_first);
+    _etui_bench_stat_print("canvas_sequential", &canvas_sequential);
+    _etui_bench_stat_print("canvas_random", &canvas_shuffled);
+    printf(",\n  \"peak_rss_kb\": %ld\n}\n", _etui_bench_peak_rss_get());
+
+    etui_file_free(ef);
+
+    ret = 0;
+
+  shutdown_ecore_evas:
+    ecore_evas_shutdown();
+  shutdown_etui:
+    etui_shutdown();
+
+    return ret;
+}
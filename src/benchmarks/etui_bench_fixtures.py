@@ -0,0 +1,374 @@
+#!/usr/bin/env python3
+#
+# Etui - Multi-document rendering library using the EFL
+# Copyright (C) 2013-2017 Vincent Torri
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Generates the synthetic documents used by the benchmarks. The content
+# is pseudo random with a fixed seed, so that the files are the same
+# from a run to another.
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import zipfile
+import zlib
+
+SEED = 20130
+
+# A4 at 300 DPI
+PAGE_W = 2480
+PAGE_H = 3508
+
+
+def text_page_rows(rng, width, height, margin):
+    """
+    rows of a grey page looking like text: black words on white lines.
+    Rows are shared between the lines, only a few distinct rows exist.
+    """
+    white = bytes([255]) * width
+    rows = []
+    y = 0
+    while y < height:
+        if y < margin or y > height - margin:
+            rows.append(white)
+            y += 1
+            continue
+        line = bytearray(white)
+        x = margin
+        while x < width - margin:
+            word = rng.randint(width // 80, width // 12)
+            end = min(x + word, width - margin)
+            line[x:end] = bytes([rng.randint(0, 64)]) * (end - x)
+            x = end + width // 100
+        line = bytes(line)
+        size = height // 90
+        for i in range(min(size, height - y)):
+            rows.append(line)
+        y += size
+        for i in range(min(size // 2, height - y)):
+            rows.append(white)
+        y += size // 2
+    return rows[:height]
+
+
+# ---------------------------------------------------------------- PDF
+
+def write_pdf(path, rng, pages=8, paths=3000):
+    """vector heavy PDF: each page is made of thousands of filled curves"""
+    objs = []
+
+    def add(data):
+        objs.append(data)
+        return len(objs)
+
+    catalog = add(None)
+    pages_obj = add(None)
+    kids = []
+    for p in range(pages):
+        ops = []
+        for i in range(paths):
+            ops.append('%.3f %.3f %.3f rg' % (rng.random(), rng.random(), rng.random()))
+            x, y = rng.uniform(0, 595), rng.uniform(0, 842)
+            ops.append('%.2f %.2f m' % (x, y))
+            for j in range(3):
+                ops.append('%.2f %.2f %.2f %.2f %.2f %.2f c' %
+                           tuple(v + rng.uniform(-40, 40)
+                                 for v in (x, y, x, y, x, y)))
+            ops.append('h f' if i % 2 else 'h S')
+        stream = zlib.compress('\n'.join(ops).encode('ascii'))
+        content = add(b'<< /Length %d /Filter /FlateDecode >>\nstream\n' % len(stream) +
+                      stream + b'\nendstream')
+        kids.append(add(('<< /Type /Page /Parent %d 0 R /MediaBox [0 0 595 842] '
+                         '/Contents %d 0 R >>' % (pages_obj, content)).encode('ascii')))
+    objs[catalog - 1] = ('<< /Type /Catalog /Pages %d 0 R >>' % pages_obj).encode('ascii')
+    objs[pages_obj - 1] = ('<< /Type /Pages /Kids [%s] /Count %d >>' %
+                           (' '.join('%d 0 R' % k for k in kids), len(kids))).encode('ascii')
+
+    with open(path, 'wb') as f:
+        f.write(b'%PDF-1.4\n')
+        offsets = []
+        for i, data in enumerate(objs):
+            offsets.append(f.tell())
+            f.write(b'%d 0 obj\n' % (i + 1) + data + b'\nendobj\n')
+        xref = f.tell()
+        f.write(b'xref\n0 %d\n0000000000 65535 f \n' % (len(objs) + 1))
+        for o in offsets:
+            f.write(b'%010d 00000 n \n' % o)
+        f.write(b'trailer\n<< /Size %d /Root %d 0 R >>\nstartxref\n%d\n%%%%EOF\n' %
+                (len(objs) + 1, catalog, xref))
+
+
+# ---------------------------------------------------------------- TIFF
+
+TIFF_SHORT = 3
+TIFF_LONG = 4
+TIFF_RATIONAL = 5
+
+
+def packbits(data):
+    """PackBits compression of a row"""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        run = 1
+        while i + run < n and run < 128 and data[i + run] == data[i]:
+            run += 1
+        if run > 1:
+            out += bytes([257 - run, data[i]])
+            i += run
+            continue
+        start = i
+        while i < n and i - start < 128 and (i + 1 >= n or data[i + 1] != data[i]):
+            i += 1
+        out += bytes([i - start - 1]) + data[start:i]
+    return bytes(out)
+
+
+def bilevel_rows(rows):
+    """1 bit rows, the dark pixels being the bits set (min is white)"""
+    cache = {}
+    bits_rows = []
+    for r in rows:
+        if id(r) not in cache:
+            bits = bytearray((len(r) + 7) // 8)
+            for x, v in enumerate(r):
+                if v < 128:
+                    bits[x >> 3] |= 0x80 >> (x & 7)
+            cache[id(r)] = bytes(bits)
+        bits_rows.append(cache[id(r)])
+    return bits_rows
+
+
+def write_tiff(path, rng, pages=4, rgb=False, bilevel=False, tile=0, rows_per_strip=16):
+    """
+    multi-page little endian TIFF, deflate compressed, either in strips
+    of rows_per_strip rows or in tiles of tile x tile pixels. Bilevel
+    pages are 1 bit and PackBits compressed, in strips.
+    """
+    spp = 3 if rgb else 1
+
+    with open(path, 'wb') as f:
+        f.write(b'II*\0\0\0\0\0')
+        prev_next = 4
+        for p in range(pages):
+            rows = text_page_rows(rng, PAGE_W, PAGE_H, PAGE_W // 12)
+            if rgb:
+                cache = {}
+                rgb_rows = []
+                for r in rows:
+                    if id(r) not in cache:
+                        cache[id(r)] = bytes(v for v in r for c in range(3))
+                    rgb_rows.append(cache[id(r)])
+                rows = rgb_rows
+
+            chunks = []
+            if bilevel:
+                rows = bilevel_rows(rows)
+                for y in range(0, PAGE_H, rows_per_strip):
+                    chunks.append(b''.join(packbits(r) for r in rows[y:y + rows_per_strip]))
+            elif tile:
+                for ty in range(0, PAGE_H, tile):
+                    for tx in range(0, PAGE_W, tile):
+                        data = bytearray()
+                        for y in range(ty, ty + tile):
+                            r = rows[y] if y < PAGE_H else b''
+                            part = r[tx * spp:(tx + tile) * spp]
+                            data += part + bytes(tile * spp - len(part))
+                        chunks.append(zlib.compress(bytes(data)))
+            else:
+                for y in range(0, PAGE_H, rows_per_strip):
+                    chunks.append(zlib.compress(b''.join(rows[y:y + rows_per_strip])))
+
+            offsets = []
+            for c in chunks:
+                offsets.append(f.tell())
+                f.write(c)
+            if f.tell() & 1:
+                f.write(b'\0')
+
+            tags = [
+                (256, TIFF_LONG, [PAGE_W]),
+                (257, TIFF_LONG, [PAGE_H]),
+                (258, TIFF_SHORT, [1 if bilevel else 8] * spp),
+                (259, TIFF_SHORT, [32773 if bilevel else 8]),
+                (262, TIFF_SHORT, [2 if rgb else 0 if bilevel else 1]),
+                (277, TIFF_SHORT, [spp]),
+                (282, TIFF_RATIONAL, [(300, 1)]),
+                (283, TIFF_RATIONAL, [(300, 1)]),
+                (284, TIFF_SHORT, [1]),
+                (296, TIFF_SHORT, [2]),
+            ]
+            if tile:
+                tags += [
+                    (322, TIFF_LONG, [tile]),
+                    (323, TIFF_LONG, [tile]),
+                    (324, TIFF_LONG, offsets),
+                    (325, TIFF_LONG, [len(c) for c in chunks]),
+                ]
+            else:
+                tags += [
+                    (273, TIFF_LONG, offsets),
+                    (278, TIFF_LONG, [rows_per_strip]),
+                    (279, TIFF_LONG, [len(c) for c in chunks]),
+                ]
+            tags.sort()
+
+            # values larger than 4 bytes are written before the IFD
+            entries = []
+            for tag, typ, values in tags:
+                if typ == TIFF_SHORT:
+                    data = struct.pack('<%dH' % len(values), *values)
+                elif typ == TIFF_LONG:
+                    data = struct.pack('<%dI' % len(values), *values)
+                else:
+                    data = b''.join(struct.pack('<II', *v) for v in values)
+                if len(data) > 4:
+                    offset = f.tell()
+                    f.write(data)
+                    if f.tell() & 1:
+                        f.write(b'\0')
+                    data = struct.pack('<I', offset)
+                entries.append(struct.pack('<HHI', tag, typ, len(values)) +
+                               data + bytes(4 - len(data)))
+
+            ifd = f.tell()
+            f.write(struct.pack('<H', len(entries)))
+            f.write(b''.join(entries))
+            next_pos = f.tell()
+            f.write(struct.pack('<I', 0))
+
+            f.seek(prev_next)
+            f.write(struct.pack('<I', ifd))
+            f.seek(0, os.SEEK_END)
+            prev_next = next_pos
+
+
+# ---------------------------------------------------------------- CB
+
+def png_data(width, height, rows):
+    """8 bits RGB PNG of the given rows"""
+    def chunk(kind, data):
+        return (struct.pack('>I', len(data)) + kind + data +
+                struct.pack('>I', zlib.crc32(kind + data) & 0xffffffff))
+
+    raw = b''.join(b'\0' + r for r in rows)
+    return (b'\x89PNG\r\n\x1a\n' +
+            chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 2, 0, 0, 0)) +
+            chunk(b'IDAT', zlib.compress(raw, 6)) +
+            chunk(b'IEND', b''))
+
+
+def comic_pages(rng, pages=24, width=1200, height=1800):
+    """colored panels, each page has its own layout"""
+    for p in range(pages):
+        rows = []
+        y = 0
+        while y < height:
+            h = rng.randint(height // 6, height // 3)
+            line = bytearray()
+            x = 0
+            while x < width:
+                w = min(rng.randint(width // 4, width // 2), width - x)
+                color = bytes([rng.randint(0, 255) for c in range(3)])
+                line += color * w
+                x += w
+            line = bytes(line)
+            rows += [line] * min(h, height - y)
+            y += h
+            # gutter
+            rows += [b'\xff' * (3 * width)] * min(12, height - y)
+            y += 12
+        yield png_data(width, height, rows[:height])
+
+
+def write_cbz(path, rng):
+    with zipfile.ZipFile(path, 'w', zipfile.ZIP_STORED) as z:
+        for i, data in enumerate(comic_pages(rng)):
+            z.writestr('page-%03d.png' % (i + 1), data)
+
+
+def write_cb7(path, rng, sevenzip):
+    with tempfile.TemporaryDirectory() as tmp:
+        names = []
+        for i, data in enumerate(comic_pages(rng)):
+            name = os.path.join(tmp, 'page-%03d.png' % (i + 1))
+            with open(name, 'wb') as f:
+                f.write(data)
+            names.append(name)
+        if os.path.exists(path):
+            os.remove(path)
+        subprocess.check_call([sevenzip, 'a', '-bd', '-y', path] + names,
+                              stdout=subprocess.DEVNULL)
+
+
+# ---------------------------------------------------------------- DjVu
+
+def write_djvu(path, rng, cjb2, djvm, pages=4):
+    """bilevel pages at 600 DPI, encoded with cjb2 and bundled with djvm"""
+    width = PAGE_W * 2
+    height = PAGE_H * 2
+    with tempfile.TemporaryDirectory() as tmp:
+        names = []
+        for p in range(pages):
+            rows = text_page_rows(rng, width, height, width // 12)
+            pbm = os.path.join(tmp, 'page-%d.pbm' % p)
+            cache = {}
+            with open(pbm, 'wb') as f:
+                f.write(b'P4\n%d %d\n' % (width, height))
+                for r in rows:
+                    if id(r) not in cache:
+                        bits = bytearray((width + 7) // 8)
+                        for x in range(width):
+                            if r[x] < 128:
+                                bits[x >> 3] |= 0x80 >> (x & 7)
+                        cache[id(r)] = bytes(bits)
+                    f.write(cache[id(r)])
+            djvu = os.path.join(tmp, 'page-%d.djvu' % p)
+            subprocess.check_call([cjb2, '-dpi', '600', pbm, djvu])
+            names.append(djvu)
+        subprocess.check_call([djvm, '-c', path] + names)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the benchmark documents.')
+    parser.add_argument('outdir')
+    parser.add_argument('--cjb2')
+    parser.add_argument('--djvm')
+    parser.add_argument('--7z', dest='sevenzip')
+    args = parser.parse_args()
+
+    out = lambda name: os.path.join(args.outdir, name)
+
+    write_pdf(out('vector.pdf'), random.Random(SEED))
+    write_tiff(out('striped.tif'), random.Random(SEED + 1))
+    write_tiff(out('tiled.tif'), random.Random(SEED + 2), rgb=True, tile=256)
+    write_tiff(out('bilevel.tif'), random.Random(SEED + 5), bilevel=True, rows_per_strip=128)
+    write_cbz(out('comic.cbz'), random.Random(SEED + 3))
+    if args.sevenzip:
+        write_cb7(out('comic.cb7'), random.Random(SEED + 3), args.sevenzip)
+    if args.cjb2 and args.djvm:
+        write_djvu(out('bilevel.djvu'), random.Random(SEED + 4), args.cjb2, args.djvm)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
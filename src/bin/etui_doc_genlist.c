@@ -18,10 +18,12 @@
 #include <config.h>
 
 #include <Elementary.h>
+
 #include <Etui.h>
 
 #include "etui_private.h"
-#include "etui_main.h"
+#include "etui_config.h"
+#include "etui_win.h"
 #include "etui_doc_genlist.h"
 
 
@@ -30,53 +32,156 @@
  *============================================================================*/
 
 
-struct Etui_Doc_Genlist_
+#define ETUI_ZOOM_IN 1.2
+#define ETUI_ZOOM_OUT (1.0 / ETUI_ZOOM_IN)
+
+#define ETUI_MIN_SCALE 0.25
+#define ETUI_MAX_SCALE 5.0
+
+/*
+ * The pages are the items of a genlist. Only the realized items have an
+ * image, created when the item is realized and deleted when it is
+ * unrealized, so that the memory used does not depend on the number of
+ * pages. The pixels come from the cache of the etui object, which is
+ * never displayed.
+ */
+
+typedef struct
+{
+    Etui_Doc_Genlist *doc;
+    Evas_Object *img;
+    Etui_Page_Request *req; /* NULL once the page is displayed */
+} Etui_Doc_Genlist_Page;
+
+static void
+_etui_doc_genlist_page_cb(void *data,
+                          Evas_Object *obj EINA_UNUSED,
+                          int page_num,
+                          const unsigned int *pixels,
+                          int width,
+                          int height)
 {
-    Etui_File *ef;
-    Evas_Object *obj;
-    Evas_Object *gl;
-};
+    Etui_Doc_Genlist_Page *page;
+
+    page = (Etui_Doc_Genlist_Page *)data;
+    page->req = NULL;
+
+    if (!pixels)
+    {
+        ERR("page %d can not be rendered", page_num);
+        return;
+    }
+
+    evas_object_image_size_set(page->img, width, height);
+    evas_object_image_data_copy_set(page->img, (void *)pixels);
+    evas_object_image_data_update_add(page->img, 0, 0, width, height);
+}
 
 static void
-gl_sel(void *data, Evas_Object *obj, void *event_info)
+_etui_doc_genlist_page_del_cb(void *data,
+                              Evas *e EINA_UNUSED,
+                              Evas_Object *obj EINA_UNUSED,
+                              void *event EINA_UNUSED)
 {
-   printf("sel item data [%p] on genlist obj [%p], item pointer [%p], index [%d]\n",
-          data, obj, event_info, elm_genlist_item_index_get(event_info));
+    Etui_Doc_Genlist_Page *page;
+
+    page = (Etui_Doc_Genlist_Page *)data;
+    /* the item is unrealized before its page is rendered */
+    etui_object_page_request_cancel(page->req);
+    free(page);
 }
 
 static Evas_Object *
-gl_content_get(void *data, Evas_Object *obj, const char *part)
+_etui_doc_genlist_content_get(void *data, Evas_Object *obj, const char *part)
 {
-    int num;
+    Etui_Doc_Genlist *doc;
+    Etui_Doc_Genlist_Page *page;
     Evas_Object *o;
+    int num;
+    int width;
+    int height;
 
     if (strcmp(part, "elm.swallow.content") != 0)
         return NULL;
 
-    o  = evas_object_rectangle_add(evas_object_evas_get(obj));
-    evas_object_size_hint_min_set(o, 50, 200);
-    evas_object_size_hint_max_set(o, 50, 200);
-    evas_object_size_hint_weight_set(o, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
-    evas_object_size_hint_fill_set(o, EVAS_HINT_FILL, EVAS_HINT_FILL);
-
+    doc = evas_object_data_get(obj, "doc");
     num = (int)(uintptr_t)data;
-    switch (num % 3)
-    {
-        case 0:
-            evas_object_color_set(o, 255, 0, 0, 255);
-            break;
-        case 1:
-            evas_object_color_set(o, 0, 255, 0, 255);
-            break;
-        case 2:
-            evas_object_color_set(o, 0, 0, 255, 255);
-            break;
-    }
+    if (!etui_object_page_raster_size_get(doc->obj, num, doc->scale,
+                                          &width, &height))
+        return NULL;
+
+    page = (Etui_Doc_Genlist_Page *)calloc(1, sizeof(Etui_Doc_Genlist_Page));
+    if (!page)
+        return NULL;
+
+    o = evas_object_image_filled_add(evas_object_evas_get(obj));
+    evas_object_image_alpha_set(o, EINA_FALSE);
+    evas_object_size_hint_min_set(o, width, height);
+    evas_object_size_hint_max_set(o, width, height);
+    evas_object_event_callback_add(o, EVAS_CALLBACK_DEL,
+                                   _etui_doc_genlist_page_del_cb, page);
     evas_object_show(o);
 
+    page->doc = doc;
+    page->img = o;
+    page->req = etui_object_page_request(doc->obj, num, doc->scale,
+                                         _etui_doc_genlist_page_cb, page);
+
     return o;
 }
 
+static void
+_etui_doc_genlist_zoom(Etui_Doc_Genlist *doc, double scale)
+{
+    if ((scale < ETUI_MIN_SCALE) || (scale > ETUI_MAX_SCALE))
+        return;
+
+    doc->scale = scale;
+    /* the realized items are created again at the new scale */
+    elm_genlist_realized_items_update(doc->gl);
+}
+
+static void
+_etui_doc_genlist_key_down_cb(void *w,
+                              Evas *_e EINA_UNUSED,
+                              Evas_Object *_obj EINA_UNUSED,
+                              void *event)
+{
+    Evas_Event_Key_Down *ev;
+    Etui *etui;
+    Etui_Doc_Genlist *doc;
+    Elm_Object_Item *it;
+
+    EINA_SAFETY_ON_NULL_RETURN(w);
+    EINA_SAFETY_ON_NULL_RETURN(event);
+
+    etui = evas_object_data_get(w, "etui");
+    ev = (Evas_Event_Key_Down *)event;
+    doc = (Etui_Doc_Genlist *)eina_list_data_get(etui->docs);
+
+    if (!evas_key_modifier_is_set(ev->modifiers, "Control"))
+        return;
+
+    if (!strcmp(ev->key, "KP_Add") || !strcmp(ev->key, "plus"))
+        _etui_doc_genlist_zoom(doc, doc->scale * ETUI_ZOOM_IN);
+    else if (!strcmp(ev->key, "KP_Subtract") || !strcmp(ev->key, "minus"))
+        _etui_doc_genlist_zoom(doc, doc->scale * ETUI_ZOOM_OUT);
+    else if (!strcmp(ev->key, "KP_1"))
+        _etui_doc_genlist_zoom(doc, 1.0);
+    else if (!strcmp(ev->key, "Home"))
+    {
+        it = elm_genlist_first_item_get(doc->gl);
+        if (it)
+            elm_genlist_item_bring_in(it, ELM_GENLIST_ITEM_SCROLLTO_TOP);
+    }
+    else if (!strcmp(ev->key, "End"))
+    {
+        it = elm_genlist_last_item_get(doc->gl);
+        if (it)
+            elm_genlist_item_bring_in(it, ELM_GENLIST_ITEM_SCROLLTO_TOP);
+    }
+}
+
 
 /*============================================================================*
  *                                 Global                                     *
@@ -84,77 +189,75 @@ gl_content_get(void *data, Evas_Object *obj, const char *part)
 
 
 Eina_Bool
-etui_doc_add(Etui *etui, const char *filename)
+etui_doc_add(Evas_Object *win, Etui_File *ef)
 {
-    Elm_Genlist_Item_Class *itc;
+    Etui *etui;
     Etui_Doc_Genlist *doc;
     int num_pages;
     int i;
 
+    EINA_SAFETY_ON_NULL_RETURN_VAL(win, EINA_FALSE);
+    EINA_SAFETY_ON_NULL_RETURN_VAL(ef, EINA_FALSE);
+
+    etui = evas_object_data_get(win, "etui");
+
     doc = (Etui_Doc_Genlist *)calloc(1, sizeof(Etui_Doc_Genlist));
     if (!doc)
         return EINA_FALSE;
 
-    doc->ef = etui_file_new(filename);
-    if (!doc->ef)
-        goto free_doc;
+    doc->ef = ef;
+    doc->scale = 1.0;
 
-    doc->obj = etui_object_add(evas_object_evas_get(etui->window.win));
+    /* only used to render the pages, never shown */
+    doc->obj = etui_object_add(evas_object_evas_get(win));
     etui_object_file_set(doc->obj, doc->ef);
     num_pages = etui_object_document_pages_count(doc->obj);
 
-    doc->gl = elm_genlist_add(etui->window.win);
+    doc->gl = elm_genlist_add(win);
     elm_genlist_mode_set(doc->gl, ELM_LIST_COMPRESS);
-    elm_genlist_multi_select_set(doc->gl, EINA_FALSE);
+    /* not homogeneous: each item has the size of its page */
+    elm_genlist_select_mode_set(doc->gl, ELM_OBJECT_SELECT_MODE_NONE);
     evas_object_size_hint_weight_set(doc->gl,
                                      EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
     evas_object_size_hint_align_set(doc->gl,
                                     EVAS_HINT_FILL, EVAS_HINT_FILL);
-    elm_object_part_content_set(etui->window.base, "content", doc->gl);
-    elm_win_resize_object_add(etui->window.win, doc->gl);
+    evas_object_data_set(doc->gl, "doc", doc);
     evas_object_show(doc->gl);
 
-    itc = elm_genlist_item_class_new();
-    itc->item_style = "full";
-    itc->func.text_get = NULL; //gl_text_get1;
-    itc->func.content_get = gl_content_get;
-    itc->func.state_get = NULL;//gl_state_get;
-    itc->func.del = NULL;
-    itc->func.reusable_content_get = NULL;//gl_reusable_content_get;
+    doc->itc = elm_genlist_item_class_new();
+    doc->itc->item_style = "full";
+    doc->itc->func.content_get = _etui_doc_genlist_content_get;
 
     for (i = 0; i < num_pages; i++)
     {
-        Elm_Object_Item *gli;
-
-        gli = elm_genlist_item_append(doc->gl, itc,
-                                      (void *)(uintptr_t)i/* item data */,
-                                      NULL/* parent */,
-                                      ELM_GENLIST_ITEM_NONE,
-                                      gl_sel/* func */,
-                                      (void *)(uintptr_t)(i * 10)/* func data */);
+        elm_genlist_item_append(doc->gl, doc->itc,
+                                (void *)(uintptr_t)i, NULL,
+                                ELM_GENLIST_ITEM_NONE,
+                                NULL, NULL);
     }
-    elm_genlist_item_class_free(itc);
 
-    etui->docs = eina_list_append(etui->docs, doc);
+    elm_object_part_content_set(etui->layout, "doc:etui.content", doc->gl);
 
-    evas_object_show(doc->obj);
+    evas_object_event_callback_add(doc->gl, EVAS_CALLBACK_KEY_DOWN,
+                                   _etui_doc_genlist_key_down_cb, win);
 
-    return EINA_TRUE;
-
-  free_doc:
-    free(doc);
+    etui->docs = eina_list_append(etui->docs, doc);
 
-    return EINA_FALSE;
+    return EINA_TRUE;
 }
 
 void
 etui_doc_del(Etui_Doc_Genlist *doc)
 {
+    /* the pending renderings are cancelled */
+    evas_object_del(doc->gl);
+    evas_object_del(doc->obj);
+    elm_genlist_item_class_free(doc->itc);
     etui_file_free(doc->ef);
+    free(doc);
 }
 
 
 /*============================================================================*
  *                                   API                                      *
  *============================================================================*/
-
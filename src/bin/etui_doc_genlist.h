@@ -19,7 +19,18 @@
 #define ETUI_DOC_GENLIST_H
 
 
-Eina_Bool etui_doc_add(Etui *etui, const char *filename);
+typedef struct Etui_Doc_Genlist_ Etui_Doc_Genlist;
+
+struct Etui_Doc_Genlist_
+{
+    Etui_File *ef;
+    Evas_Object *obj;
+    Evas_Object *gl;
+    Elm_Genlist_Item_Class *itc;
+    double scale; /* scale of all the pages */
+};
+
+Eina_Bool etui_doc_add(Evas_Object *win, Etui_File *ef);
 void etui_doc_del(Etui_Doc_Genlist *doc);
 
 
@@ -43,12 +43,74 @@
 
 #define ETUI_MIN_SCALE 0.25
 #define ETUI_MAX_SCALE 5.0
+/* above this scale, only the visible part of the page is rendered */
+#define ETUI_TILED_SCALE 2.0
 
 static void _etui_doc_key_down_cb(void *data,
                                   Evas *_e EINA_UNUSED,
                                   Evas_Object *_obj EINA_UNUSED,
                                   void *event);
 
+static char *
+_etui_doc_search_text_get(void *data,
+                          Evas_Object *obj EINA_UNUSED,
+                          const char *part EINA_UNUSED)
+{
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "Page %d", (int)(uintptr_t)data + 1);
+
+    return strdup(buf);
+}
+
+static void
+_etui_doc_search_sel_cb(void *data, Evas_Object *obj EINA_UNUSED, void *event)
+{
+    Etui_Doc_Simple *doc;
+
+    doc = (Etui_Doc_Simple *)data;
+    etui_object_page_set(doc->obj,
+                         (int)(uintptr_t)elm_object_item_data_get(event));
+}
+
+/* the boxes are highlighted by the etui object */
+static void
+_etui_doc_search_hit_cb(void *data,
+                        Evas_Object *obj EINA_UNUSED,
+                        int page_num,
+                        const Eina_Inarray *boxes)
+{
+    Etui_Doc_Simple *doc;
+
+    doc = (Etui_Doc_Simple *)data;
+    DBG("%u occurrences page %d", eina_inarray_count(boxes), page_num + 1);
+
+    /* the first page found is displayed, the others are listed */
+    if (!doc->search.found)
+    {
+        etui_object_page_set(doc->obj, page_num);
+        doc->search.found = EINA_TRUE;
+    }
+
+    elm_genlist_item_append(doc->search.list, doc->search.itc,
+                            (void *)(uintptr_t)page_num, NULL,
+                            ELM_GENLIST_ITEM_NONE,
+                            _etui_doc_search_sel_cb, doc);
+}
+
+static void
+_etui_doc_search_end_cb(void *data, Evas_Object *obj EINA_UNUSED, Eina_Bool cancelled)
+{
+    Etui_Doc_Simple *doc;
+
+    if (cancelled)
+        return;
+
+    doc = (Etui_Doc_Simple *)data;
+    if (!doc->search.found)
+        INF("text not found");
+}
+
 static void
 _etui_doc_search_add(Etui *etui)
 {
@@ -106,7 +168,9 @@ _etui_doc_search_add(Etui *etui)
     evas_object_show(o);
     doc->search.list = o;
 
-    /* append items */
+    doc->search.itc = elm_genlist_item_class_new();
+    doc->search.itc->item_style = "default";
+    doc->search.itc->func.text_get = _etui_doc_search_text_get;
 }
 
 static void
@@ -117,6 +181,7 @@ _etui_doc_zoom(const Etui_Doc_Simple *doc)
 
     elm_scroller_page_relative_get(doc->sc, &rx, &ry);
     etui_object_page_mode_set(doc->obj, ETUI_MODE_FREE);
+    etui_object_tiled_set(doc->obj, doc->scale >= ETUI_TILED_SCALE);
     etui_object_page_scale_set(doc->obj, doc->scale);
     etui_object_page_size_get(doc->obj, &w, &h);
     elm_scroller_page_size_set(doc->sc, w, h);
@@ -280,6 +345,7 @@ _etui_doc_key_down_cb(void *w,
                 elm_object_signal_emit(etui->layout,
                                        "doc:search,hide", "etui");
                 doc->search.searching = EINA_FALSE;
+                etui_object_search_highlight_set(doc->obj, EINA_FALSE);
             }
         }
     }
@@ -332,6 +398,7 @@ _etui_doc_key_down_cb(void *w,
                 elm_object_signal_emit(etui->layout,
                                        "doc:search,show", "etui");
                 doc->search.searching = EINA_TRUE;
+                etui_object_search_highlight_set(doc->obj, EINA_TRUE);
             }
         }
         else if (!strcmp(ev->key, "g"))
@@ -341,35 +408,20 @@ _etui_doc_key_down_cb(void *w,
             if (doc->search.searching &&
                 (text = elm_entry_entry_get(doc->search.entry)))
             {
-                Eina_Rectangle *r;
-                const Etui_Module_Pdf_Api *api;
-                Eina_Inarray *a;
-                int page = 0;
-                int num_pages;
-                int i;
-
-                api = etui_object_api_get(doc->obj);
-                num_pages = etui_object_document_pages_count(doc->obj);
-                a = NULL;
-                for (i = 0; i < num_pages; i++)
-                {
-                    if ((a = api->search(api->mod, i, text)))
-                    {
-                        page = i;
-                        break;
-                    }
-                }
-                if (a)
-                {
-                    etui_object_page_set(doc->obj, page);
-                    fprintf(stderr, "text '%s' find page %d\n", text, page);
-                    EINA_INARRAY_FOREACH(a, r)
-                    {
-                        fprintf(stderr, "  box (%d, %d) (%d, %d)\n",
-                                r->x, r->y, r->w, r->h);
-                    }
-                    fflush(stderr);
-                }
+                char *utf8;
+
+                /* the pages after the current one are searched first */
+                elm_genlist_clear(doc->search.list);
+                doc->search.found = EINA_FALSE;
+                utf8 = elm_entry_markup_to_utf8(text);
+                if (!utf8 ||
+                    !etui_object_search_run(doc->obj, utf8,
+                                            etui_object_page_get(doc->obj) + 1,
+                                            _etui_doc_search_hit_cb,
+                                            _etui_doc_search_end_cb,
+                                            doc))
+                    ERR("text can not be searched");
+                free(utf8);
             }
         }
     }
@@ -529,6 +581,10 @@ etui_doc_add(Evas_Object *win, Etui_File *ef)
 void
 etui_doc_del(Etui_Doc_Simple *doc)
 {
+    if (doc->obj)
+        etui_object_search_cancel(doc->obj);
+    if (doc->search.itc)
+        elm_genlist_item_class_free(doc->search.itc);
     etui_file_free(doc->ef);
     free(doc);
 }
@@ -36,7 +36,9 @@ struct Etui_Doc_Simple_
         Evas_Object *bt_next;
         Evas_Object *bt_prev;
         Evas_Object *list;
+        Elm_Genlist_Item_Class *itc;
         Eina_Bool searching : 1;
+        Eina_Bool found : 1; /* a page has been found by the last search */
     } search;
 };
 
@@ -25,7 +25,11 @@
 #include "etui_private.h"
 #include "etui_config.h"
 #include "etui_win.h"
-#include "etui_doc_simple.h"
+#ifdef ETUI_DOC_GENLIST
+# include "etui_doc_genlist.h"
+#else
+# include "etui_doc_simple.h"
+#endif
 
 int etui_app_log_dom_global = 1;
 
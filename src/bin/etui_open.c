@@ -24,7 +24,11 @@
 #include "etui_private.h"
 #include "etui_config.h"
 #include "etui_win.h"
-#include "etui_doc_simple.h"
+#ifdef ETUI_DOC_GENLIST
+# include "etui_doc_genlist.h"
+#else
+# include "etui_doc_simple.h"
+#endif
 #include "etui_open.h"
 #include "etui_settings.h"
 
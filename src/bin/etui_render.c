@@ -0,0 +1,507 @@
+/* Etui - Multi-document rendering application using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * etui-render: renders the pages of a document in image files, without
+ * any canvas. The pages are shared between a pool of workers, each
+ * worker having its own Etui_File, so that the modules run in parallel.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <Eina.h>
+#include <Ecore.h>
+#include <Ecore_Getopt.h>
+#include <Evas.h>
+
+#include <Etui.h>
+
+#include "etui_private.h"
+
+typedef enum
+{
+    ETUI_RENDER_FORMAT_PNG,
+    ETUI_RENDER_FORMAT_PPM
+} Etui_Render_Format;
+
+typedef struct
+{
+    const char *dir;
+    Etui_Render_Format format;
+    double scale;
+    Etui_Rotation rotation;
+    Eina_Lock lock; /* protects next and failures */
+    int next;
+    int last;
+    int failures;
+} Etui_Render;
+
+typedef struct
+{
+    Etui_Render *render;
+    Etui_File *ef;
+    Eina_Thread thread;
+    int count;
+} Etui_Render_Worker;
+
+int etui_app_log_dom_global = 1;
+
+static const char *_etui_render_formats[] = { "png", "ppm", NULL };
+
+static const Ecore_Getopt options = {
+    "etui-render",
+    "%prog [options] filename",
+    PACKAGE_VERSION,
+    "(C) 2013-2020 Vincent Torri and others",
+    "AGPL v3",
+    "Render the pages of a document in image files, without display.",
+    EINA_TRUE,
+    {
+        ECORE_GETOPT_STORE_DOUBLE('s', "scale",
+                                  "Scale of the pages (default: 1.0)."),
+        ECORE_GETOPT_STORE_INT('r', "rotation",
+                               "Rotation of the pages: 0, 90, 180 or 270 (default: 0)."),
+        ECORE_GETOPT_STORE_INT('j', "jobs",
+                               "Number of workers (default: number of CPU)."),
+        ECORE_GETOPT_STORE_STR('o', "output",
+                               "Directory of the images (default: current directory)."),
+        ECORE_GETOPT_CHOICE('t', "type", "Type of the images (default: png).",
+                            _etui_render_formats),
+        ECORE_GETOPT_STORE_INT('b', "begin",
+                               "First page to render, starting from 1 (default: 1)."),
+        ECORE_GETOPT_STORE_INT('e', "end",
+                               "Last page to render (default: last page)."),
+
+        ECORE_GETOPT_VERSION   ('V', "version"),
+        ECORE_GETOPT_COPYRIGHT ('C', "copyright"),
+        ECORE_GETOPT_LICENSE   ('L', "license"),
+        ECORE_GETOPT_HELP      ('h', "help"),
+        ECORE_GETOPT_SENTINEL
+    }
+};
+
+/*
+ * converts the premultiplied ARGB pixels of a row to RGB, the pixels
+ * being composited over a white background
+ */
+static void
+_etui_render_row_rgb(unsigned char *dst, const unsigned int *src, int width)
+{
+    unsigned int a;
+    int i;
+
+    for (i = 0; i < width; i++, src++)
+    {
+        a = 255 - (*src >> 24);
+        *dst++ = ((*src >> 16) & 0xff) + a;
+        *dst++ = ((*src >> 8) & 0xff) + a;
+        *dst++ = (*src & 0xff) + a;
+    }
+}
+
+static void
+_etui_render_be32_set(unsigned char *p, unsigned int v)
+{
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static Eina_Bool
+_etui_render_png_chunk_write(FILE *f, const char *type, const unsigned char *data, unsigned int size)
+{
+    unsigned char buf[4];
+    uLong crc;
+
+    _etui_render_be32_set(buf, size);
+    if (fwrite(buf, 1, 4, f) != 4)
+        return EINA_FALSE;
+    if (fwrite(type, 1, 4, f) != 4)
+        return EINA_FALSE;
+    if (size && (fwrite(data, 1, size, f) != size))
+        return EINA_FALSE;
+
+    crc = crc32(0L, (const Bytef *)type, 4);
+    if (size)
+        crc = crc32(crc, data, size);
+    _etui_render_be32_set(buf, (unsigned int)crc);
+
+    return fwrite(buf, 1, 4, f) == 4;
+}
+
+/* 8 bits RGB PNG, one IDAT chunk compressed with zlib */
+static Eina_Bool
+_etui_render_png_save(FILE *f, const unsigned int *pixels, int width, int height)
+{
+    static const unsigned char sig[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    unsigned char ihdr[13];
+    unsigned char *raw;
+    unsigned char *z;
+    size_t raw_size;
+    uLongf z_size;
+    Eina_Bool res = EINA_FALSE;
+    int i;
+
+    raw_size = (size_t)height * (1 + 3 * (size_t)width);
+    raw = (unsigned char *)malloc(raw_size);
+    if (!raw)
+        return EINA_FALSE;
+
+    for (i = 0; i < height; i++)
+    {
+        unsigned char *row;
+
+        row = raw + i * (1 + 3 * (size_t)width);
+        *row = 0; /* no filter */
+        _etui_render_row_rgb(row + 1, pixels + i * width, width);
+    }
+
+    z_size = compressBound(raw_size);
+    z = (unsigned char *)malloc(z_size);
+    if (!z)
+        goto free_raw;
+
+    if (compress2(z, &z_size, raw, raw_size, Z_DEFAULT_COMPRESSION) != Z_OK)
+        goto free_z;
+
+    _etui_render_be32_set(ihdr, width);
+    _etui_render_be32_set(ihdr + 4, height);
+    ihdr[8] = 8; /* bit depth */
+    ihdr[9] = 2; /* RGB */
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    res = (fwrite(sig, 1, sizeof(sig), f) == sizeof(sig)) &&
+          _etui_render_png_chunk_write(f, "IHDR", ihdr, sizeof(ihdr)) &&
+          _etui_render_png_chunk_write(f, "IDAT", z, z_size) &&
+          _etui_render_png_chunk_write(f, "IEND", NULL, 0);
+
+  free_z:
+    free(z);
+  free_raw:
+    free(raw);
+
+    return res;
+}
+
+static Eina_Bool
+_etui_render_ppm_save(FILE *f, const unsigned int *pixels, int width, int height)
+{
+    unsigned char *row;
+    Eina_Bool res = EINA_TRUE;
+    int i;
+
+    row = (unsigned char *)malloc(3 * (size_t)width);
+    if (!row)
+        return EINA_FALSE;
+
+    if (fprintf(f, "P6\n%d %d\n255\n", width, height) < 0)
+        res = EINA_FALSE;
+
+    for (i = 0; res && (i < height); i++)
+    {
+        _etui_render_row_rgb(row, pixels + i * width, width);
+        if (fwrite(row, 3, width, f) != (size_t)width)
+            res = EINA_FALSE;
+    }
+
+    free(row);
+
+    return res;
+}
+
+static Eina_Bool
+_etui_render_page(Etui_Render_Worker *w, int page_num)
+{
+    Etui_Render *render;
+    char file[PATH_MAX];
+    unsigned int *pixels;
+    FILE *f;
+    Eina_Bool res = EINA_FALSE;
+    int width;
+    int height;
+
+    render = w->render;
+
+    if (!etui_file_page_raster_size_get(w->ef, page_num,
+                                        render->scale, render->rotation,
+                                        &width, &height))
+        return EINA_FALSE;
+
+    pixels = (unsigned int *)malloc((size_t)width * height * sizeof(unsigned int));
+    if (!pixels)
+        return EINA_FALSE;
+
+    if (!etui_file_page_render_to_buffer(w->ef, page_num,
+                                         render->scale, render->rotation,
+                                         pixels, width * 4))
+        goto free_pixels;
+
+    snprintf(file, sizeof(file), "%s/page-%05d.%s",
+             render->dir, page_num + 1, _etui_render_formats[render->format]);
+    f = fopen(file, "wb");
+    if (!f)
+    {
+        ERR("can not create file %s", file);
+        goto free_pixels;
+    }
+
+    if (render->format == ETUI_RENDER_FORMAT_PNG)
+        res = _etui_render_png_save(f, pixels, width, height);
+    else
+        res = _etui_render_ppm_save(f, pixels, width, height);
+
+    if (fclose(f) != 0)
+        res = EINA_FALSE;
+
+    if (!res)
+        ERR("can not write file %s", file);
+
+  free_pixels:
+    free(pixels);
+
+    return res;
+}
+
+static void *
+_etui_render_worker(void *data, Eina_Thread t EINA_UNUSED)
+{
+    Etui_Render_Worker *w;
+    Etui_Render *render;
+    int page_num;
+
+    w = (Etui_Render_Worker *)data;
+    render = w->render;
+
+    while (1)
+    {
+        /* one page at a time, so that slow pages do not unbalance the pool */
+        eina_lock_take(&render->lock);
+        page_num = render->next++;
+        eina_lock_release(&render->lock);
+
+        if (page_num > render->last)
+            break;
+
+        if (_etui_render_page(w, page_num))
+            w->count++;
+        else
+        {
+            ERR("can not render page %d", page_num + 1);
+            eina_lock_take(&render->lock);
+            render->failures++;
+            eina_lock_release(&render->lock);
+        }
+    }
+
+    return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+    Etui_Render render;
+    Etui_Render_Worker *workers;
+    const char *filename;
+    char *format = NULL;
+    char *dir = NULL;
+    double scale = 1.0;
+    double t;
+    int rotation = 0;
+    int jobs = 0;
+    int threads;
+    int begin = 1;
+    int end = 0;
+    int files;
+    int count;
+    int args;
+    int ret = 1;
+    int i;
+    Eina_Bool quit_option = EINA_FALSE;
+    Ecore_Getopt_Value values[] = {
+        ECORE_GETOPT_VALUE_DOUBLE(scale),
+        ECORE_GETOPT_VALUE_INT(rotation),
+        ECORE_GETOPT_VALUE_INT(jobs),
+        ECORE_GETOPT_VALUE_STR(dir),
+        ECORE_GETOPT_VALUE_STR(format),
+        ECORE_GETOPT_VALUE_INT(begin),
+        ECORE_GETOPT_VALUE_INT(end),
+
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+        ECORE_GETOPT_VALUE_BOOL(quit_option),
+
+        ECORE_GETOPT_VALUE_NONE
+    };
+
+    if (!etui_init())
+    {
+        fprintf(stderr, "could not initialize Etui library.\n");
+        return 1;
+    }
+
+    etui_app_log_dom_global = eina_log_domain_register("etui-render", NULL);
+    if (etui_app_log_dom_global < 0)
+    {
+        EINA_LOG_CRIT("could not create log domain 'etui-render'.");
+        goto shutdown_etui;
+    }
+
+    args = ecore_getopt_parse(&options, values, argc, argv);
+    if (args < 0)
+    {
+        ERR("Could not parse command line options.");
+        goto unregister_log;
+    }
+
+    if (quit_option)
+    {
+        ret = 0;
+        goto unregister_log;
+    }
+
+    if (args != (argc - 1))
+    {
+        ecore_getopt_help(stderr, &options);
+        goto unregister_log;
+    }
+
+    filename = argv[args];
+
+    if ((rotation != 0) && (rotation != 90) &&
+        (rotation != 180) && (rotation != 270))
+    {
+        ERR("rotation must be 0, 90, 180 or 270.");
+        goto unregister_log;
+    }
+
+    if (scale <= 0.0)
+    {
+        ERR("scale must be positive.");
+        goto unregister_log;
+    }
+
+    if (jobs <= 0)
+        jobs = eina_cpu_count();
+    if (jobs <= 0)
+        jobs = 1;
+
+    memset(&render, 0, sizeof(render));
+    render.dir = dir ? dir : ".";
+    render.format = (format && !strcmp(format, "ppm")) ?
+        ETUI_RENDER_FORMAT_PPM : ETUI_RENDER_FORMAT_PNG;
+    render.scale = scale;
+    render.rotation = (Etui_Rotation)rotation;
+
+    workers = (Etui_Render_Worker *)calloc(jobs, sizeof(Etui_Render_Worker));
+    if (!workers)
+        goto unregister_log;
+
+    /*
+     * the files are opened in the main thread, as loading the modules
+     * is not thread safe. Each worker renders with its own file.
+     */
+    files = jobs;
+    for (i = 0; i < files; i++)
+    {
+        workers[i].render = &render;
+        workers[i].ef = etui_file_new(filename);
+        if (!workers[i].ef)
+        {
+            ERR("can not open file %s", filename);
+            goto free_files;
+        }
+    }
+
+    count = etui_file_pages_count(workers[0].ef);
+    if (end <= 0 || end > count)
+        end = count;
+    if (begin < 1)
+        begin = 1;
+    if (begin > end)
+    {
+        ERR("no page to render in %s", filename);
+        goto free_files;
+    }
+
+    render.next = begin - 1;
+    render.last = end - 1;
+
+    /* no need for more workers than pages */
+    if (jobs > (end - begin + 1))
+        jobs = end - begin + 1;
+
+    /* the CPUs are shared by the workers, not used by each of them */
+    threads = eina_cpu_count() / jobs;
+    etui_page_threads_set((threads > 0) ? threads : 1);
+
+    if (!eina_lock_new(&render.lock))
+        goto free_files;
+
+    t = ecore_time_get();
+
+    for (i = 0; i < jobs; i++)
+    {
+        if (!eina_thread_create(&workers[i].thread, EINA_THREAD_NORMAL, -1,
+                                _etui_render_worker, &workers[i]))
+        {
+            ERR("can not create worker %d", i);
+            break;
+        }
+    }
+
+    /* the main thread renders too if no worker could be created */
+    if (i == 0)
+        _etui_render_worker(&workers[0], 0);
+
+    count = 0;
+    while (i-- > 0)
+        eina_thread_join(workers[i].thread);
+    for (i = 0; i < jobs; i++)
+        count += workers[i].count;
+
+    t = ecore_time_get() - t;
+    INF("%d pages rendered in %.3f s with %d workers", count, t, jobs);
+    printf("%d pages rendered in %.3f s (%.1f pages/s)\n",
+           count, t, (t > 0.0) ? count / t : 0.0);
+
+    eina_lock_free(&render.lock);
+
+    if (render.failures == 0)
+        ret = 0;
+
+  free_files:
+    for (i = 0; i < files; i++)
+        etui_file_free(workers[i].ef);
+    free(workers);
+  unregister_log:
+    eina_log_domain_unregister(etui_app_log_dom_global);
+    etui_app_log_dom_global = -1;
+  shutdown_etui:
+    etui_shutdown();
+
+    return ret;
+}
@@ -68,6 +68,15 @@ typedef enum
 
 typedef struct Etui_File_s Etui_File;
 
+/* boxes are Eina_Rectangle, in page coordinates at scale 1 and rotation 0 */
+typedef void (*Etui_Search_Hit_Cb)(void *data, Evas_Object *obj, int page_num, const Eina_Inarray *boxes);
+typedef void (*Etui_Search_End_Cb)(void *data, Evas_Object *obj, Eina_Bool cancelled);
+
+typedef struct Etui_Page_Request_s Etui_Page_Request;
+
+/* pixels are ARGB premultiplied, NULL if the page can not be rendered, only valid during the call */
+typedef void (*Etui_Page_Cb)(void *data, Evas_Object *obj, int page_num, const unsigned int *pixels, int width, int height);
+
 
 EAPI int etui_init(void);
 EAPI int etui_shutdown(void);
@@ -75,7 +84,19 @@ EAPI int etui_shutdown(void);
 EAPI Etui_File *etui_file_new (const char *filename);
 EAPI void etui_file_free(Etui_File *ef);
 EAPI const char *etui_file_filename_get(const Etui_File *ef);
+EAPI const char *etui_file_module_name_get(const Etui_File *ef);
+EAPI int etui_file_pages_count(const Etui_File *ef);
+EAPI Eina_Bool etui_file_page_raster_size_get(const Etui_File *ef, int page_num, double scale, Etui_Rotation rotation, int *width, int *height);
+EAPI Eina_Bool etui_file_page_render_to_buffer(const Etui_File *ef, int page_num, double scale, Etui_Rotation rotation, unsigned int *buffer, int stride);
 
+EAPI void etui_disk_cache_size_set(size_t size);
+EAPI size_t etui_disk_cache_size_get(void);
+
+/* threads rendering one page, 0 for one per CPU */
+EAPI void etui_page_threads_set(int threads);
+EAPI int etui_page_threads_get(void);
+
+/* smart callback "page,rendered": a page is shown, event_info is an int * on its number */
 EAPI Evas_Object *etui_object_add(Evas *evas);
 
 EAPI void etui_object_file_set(Evas_Object *obj, const Etui_File *ef);
@@ -101,6 +122,27 @@ EAPI Etui_Mode etui_object_page_mode_get(const Evas_Object *obj);
 
 EAPI const void *etui_object_api_get(Evas_Object *obj);
 
+EAPI void etui_object_cache_size_set(Evas_Object *obj, size_t size);
+EAPI size_t etui_object_cache_size_get(const Evas_Object *obj);
+EAPI void etui_object_cache_stats_get(const Evas_Object *obj, unsigned int *hits, unsigned int *misses, size_t *size);
+
+EAPI void etui_object_prefetch_set(Evas_Object *obj, int ahead, int behind);
+EAPI void etui_object_prefetch_get(const Evas_Object *obj, int *ahead, int *behind);
+
+EAPI void etui_object_tiled_set(Evas_Object *obj, Eina_Bool on);
+EAPI Eina_Bool etui_object_tiled_get(const Evas_Object *obj);
+
+EAPI Eina_Bool etui_object_search_run(Evas_Object *obj, const char *needle, int page_start, Etui_Search_Hit_Cb hit_cb, Etui_Search_End_Cb end_cb, const void *data);
+EAPI void etui_object_search_cancel(Evas_Object *obj);
+EAPI void etui_object_search_highlight_set(Evas_Object *obj, Eina_Bool on);
+EAPI Eina_Bool etui_object_search_highlight_get(const Evas_Object *obj);
+
+EAPI Eina_Bool etui_object_disk_cache_warm(Evas_Object *obj, double scale);
+
+EAPI Eina_Bool etui_object_page_raster_size_get(Evas_Object *obj, int page_num, double scale, int *width, int *height);
+EAPI Etui_Page_Request *etui_object_page_request(Evas_Object *obj, int page_num, double scale, Etui_Page_Cb cb, const void *data);
+EAPI void etui_object_page_request_cancel(Etui_Page_Request *req);
+
 /*** specific module features ***/
 
 /* cb */
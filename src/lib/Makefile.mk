@@ -5,13 +5,21 @@ includes_HEADERS = src/lib/Etui.h
 includesdir = $(pkgincludedir)-@VMAJ@
 
 src_lib_libetui_la_SOURCES = \
+src/lib/etui_cache.c \
+src/lib/etui_disk_cache.c \
 src/lib/etui_file.c \
 src/lib/etui_main.c \
 src/lib/etui_module.c \
+src/lib/etui_search.c \
 src/lib/etui_smart.c \
+src/lib/etui_zip.c \
+src/lib/etui_cache.h \
+src/lib/etui_disk_cache.h \
 src/lib/etui_file.h \
 src/lib/etui_module.h \
-src/lib/etui_private.h
+src/lib/etui_private.h \
+src/lib/etui_search.h \
+src/lib/etui_zip.h
 
 src_lib_libetui_la_CPPFLAGS = \
 -DPACKAGE_BIN_DIR=\"$(bindir)\" \
@@ -0,0 +1,350 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Eina.h>
+
+#include "Etui.h"
+#include "etui_cache.h"
+#include "etui_private.h"
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+/**
+ * @cond LOCAL
+ */
+
+/*
+ * The entries are kept in LRU order: the most recently used one is the
+ * first of the list, the eviction starts from the last one.
+ * The cache is only used from the main loop.
+ */
+struct Etui_Cache_s
+{
+    Eina_Inlist *entries;
+    Eina_Inlist *cleared; /* pinned entries removed by etui_cache_clear() */
+    size_t budget;
+    size_t size;
+    unsigned int hits;
+    unsigned int misses;
+};
+
+static Etui_Cache_Entry *
+_etui_cache_lookup(const Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y)
+{
+    Etui_Cache_Entry *entry;
+
+    EINA_INLIST_FOREACH(cache->entries, entry)
+    {
+        if ((entry->page == page) &&
+            (entry->rotation == rotation) &&
+            (entry->x == x) &&
+            (entry->y == y) &&
+            EINA_DBL_EQ(entry->scale, scale))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void
+_etui_cache_entry_del(Etui_Cache *cache, Etui_Cache_Entry *entry)
+{
+    cache->entries = eina_inlist_remove(cache->entries, EINA_INLIST_GET(entry));
+    cache->size -= entry->size;
+    free(entry->data);
+    free(entry);
+}
+
+static void
+_etui_cache_evict(Etui_Cache *cache, size_t needed)
+{
+    Eina_Inlist *l;
+
+    if (!cache->entries)
+        return;
+
+    l = cache->entries->last;
+    while (l && (cache->size + needed > cache->budget))
+    {
+        Etui_Cache_Entry *entry;
+
+        entry = EINA_INLIST_CONTAINER_GET(l, Etui_Cache_Entry);
+        l = l->prev;
+        if (entry->pinned)
+            continue;
+
+        DBG("evict page %d at %dx%d (scale %f, rotation %d)",
+            entry->page, entry->x, entry->y, entry->scale, entry->rotation);
+        _etui_cache_entry_del(cache, entry);
+    }
+}
+
+/**
+ * @endcond
+ */
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+Etui_Cache *
+etui_cache_new(size_t budget)
+{
+    Etui_Cache *cache;
+
+    cache = (Etui_Cache *)calloc(1, sizeof(Etui_Cache));
+    if (!cache)
+        return NULL;
+
+    cache->budget = budget;
+
+    return cache;
+}
+
+void
+etui_cache_free(Etui_Cache *cache)
+{
+    if (!cache)
+        return;
+
+    etui_cache_clear(cache);
+    /* the entries still pinned can not be used after the cache */
+    while (cache->cleared)
+    {
+        Etui_Cache_Entry *entry;
+
+        entry = EINA_INLIST_CONTAINER_GET(cache->cleared, Etui_Cache_Entry);
+        cache->cleared = eina_inlist_remove(cache->cleared, cache->cleared);
+        free(entry->data);
+        free(entry);
+    }
+    free(cache);
+}
+
+/*
+ * Removes all the entries. The pinned ones are still used, they can not
+ * be found anymore and are freed when they are unpinned.
+ */
+void
+etui_cache_clear(Etui_Cache *cache)
+{
+    while (cache->entries)
+    {
+        Etui_Cache_Entry *entry;
+
+        entry = EINA_INLIST_CONTAINER_GET(cache->entries, Etui_Cache_Entry);
+        if (!entry->pinned)
+        {
+            _etui_cache_entry_del(cache, entry);
+            continue;
+        }
+
+        cache->entries = eina_inlist_remove(cache->entries, EINA_INLIST_GET(entry));
+        cache->size -= entry->size;
+        entry->cleared = EINA_TRUE;
+        cache->cleared = eina_inlist_append(cache->cleared, EINA_INLIST_GET(entry));
+    }
+    cache->hits = 0;
+    cache->misses = 0;
+}
+
+void
+etui_cache_budget_set(Etui_Cache *cache, size_t budget)
+{
+    cache->budget = budget;
+    _etui_cache_evict(cache, 0);
+}
+
+size_t
+etui_cache_budget_get(const Etui_Cache *cache)
+{
+    return cache->budget;
+}
+
+Etui_Cache_Entry *
+etui_cache_find(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y)
+{
+    Etui_Cache_Entry *entry;
+
+    entry = _etui_cache_lookup(cache, page, scale, rotation, x, y);
+    if (!entry)
+    {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->entries = eina_inlist_promote(cache->entries,
+                                         EINA_INLIST_GET(entry));
+    cache->hits++;
+
+    return entry;
+}
+
+/*
+ * Returns the rendering of the whole page at the largest scale, whatever
+ * the scale. Neither the LRU order nor the statistics are changed.
+ */
+Etui_Cache_Entry *
+etui_cache_page_find(const Etui_Cache *cache, int page, Etui_Rotation rotation)
+{
+    Etui_Cache_Entry *entry;
+    Etui_Cache_Entry *best = NULL;
+
+    EINA_INLIST_FOREACH(cache->entries, entry)
+    {
+        if ((entry->page == page) &&
+            (entry->rotation == rotation) &&
+            (entry->x == 0) &&
+            (entry->y == 0) &&
+            (!best || (entry->scale > best->scale)))
+            best = entry;
+    }
+
+    return best;
+}
+
+Eina_Bool
+etui_cache_exists(const Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y)
+{
+    return _etui_cache_lookup(cache, page, scale, rotation, x, y) != NULL;
+}
+
+Etui_Cache_Entry *
+etui_cache_add(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y, const void *data, int width, int height)
+{
+    Etui_Cache_Entry *entry;
+    void *copy;
+    size_t size;
+
+    if (!data || (width <= 0) || (height <= 0))
+        return NULL;
+
+    size = (size_t)width * height * sizeof(unsigned int);
+    if (size > cache->budget)
+        return NULL;
+
+    copy = malloc(size);
+    if (!copy)
+        return NULL;
+
+    memcpy(copy, data, size);
+    entry = etui_cache_take(cache, page, scale, rotation, x, y, copy, width, height);
+
+    return entry;
+}
+
+Etui_Cache_Entry *
+etui_cache_take(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y, void *data, int width, int height)
+{
+    Etui_Cache_Entry *entry;
+    size_t size;
+
+    if (!data)
+        return NULL;
+
+    size = (size_t)width * height * sizeof(unsigned int);
+    if ((width <= 0) || (height <= 0) || (size > cache->budget))
+        goto free_data;
+
+    /* replace an older rendering of the same page, if not displayed */
+    entry = _etui_cache_lookup(cache, page, scale, rotation, x, y);
+    if (entry)
+    {
+        if (entry->pinned)
+        {
+            free(data);
+            return entry;
+        }
+        _etui_cache_entry_del(cache, entry);
+    }
+
+    _etui_cache_evict(cache, size);
+
+    entry = (Etui_Cache_Entry *)calloc(1, sizeof(Etui_Cache_Entry));
+    if (!entry)
+        goto free_data;
+
+    entry->data = (unsigned int *)data;
+    entry->page = page;
+    entry->scale = scale;
+    entry->rotation = rotation;
+    entry->x = x;
+    entry->y = y;
+    entry->width = width;
+    entry->height = height;
+    entry->size = size;
+
+    cache->entries = eina_inlist_prepend(cache->entries, EINA_INLIST_GET(entry));
+    cache->size += size;
+
+    return entry;
+
+  free_data:
+    free(data);
+
+    return NULL;
+}
+
+void
+etui_cache_entry_pin(Etui_Cache_Entry *entry)
+{
+    entry->pinned++;
+}
+
+void
+etui_cache_entry_unpin(Etui_Cache *cache, Etui_Cache_Entry *entry)
+{
+    if (entry->pinned > 0)
+        entry->pinned--;
+
+    if (entry->cleared)
+    {
+        if (!entry->pinned)
+        {
+            cache->cleared = eina_inlist_remove(cache->cleared, EINA_INLIST_GET(entry));
+            free(entry->data);
+            free(entry);
+        }
+        return;
+    }
+
+    /* the budget may have been lowered while the entry was pinned */
+    if (!entry->pinned && (cache->size > cache->budget))
+        _etui_cache_evict(cache, 0);
+}
+
+void
+etui_cache_stats_get(const Etui_Cache *cache, unsigned int *hits, unsigned int *misses, size_t *size)
+{
+    if (hits) *hits = cache->hits;
+    if (misses) *misses = cache->misses;
+    if (size) *size = cache->size;
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
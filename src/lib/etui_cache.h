@@ -0,0 +1,58 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ETUI_CACHE_H
+#define ETUI_CACHE_H
+
+
+#define ETUI_CACHE_SIZE_DEFAULT (64 * 1024 * 1024)
+
+typedef struct Etui_Cache_s Etui_Cache;
+typedef struct Etui_Cache_Entry_s Etui_Cache_Entry;
+
+struct Etui_Cache_Entry_s
+{
+    EINA_INLIST;
+    int page;
+    double scale;
+    Etui_Rotation rotation;
+    int x; /* origin in the page raster, 0 for a whole page */
+    int y;
+    int width;
+    int height;
+    unsigned int *data; /* ARGB premultiplied, width * height pixels */
+    size_t size;
+    int pinned; /* pinned entries are never evicted */
+    Eina_Bool cleared; /* out of the cache, freed when unpinned */
+};
+
+Etui_Cache *etui_cache_new(size_t budget);
+void etui_cache_free(Etui_Cache *cache);
+void etui_cache_clear(Etui_Cache *cache);
+void etui_cache_budget_set(Etui_Cache *cache, size_t budget);
+size_t etui_cache_budget_get(const Etui_Cache *cache);
+Eina_Bool etui_cache_exists(const Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y);
+Etui_Cache_Entry *etui_cache_find(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y);
+Etui_Cache_Entry *etui_cache_page_find(const Etui_Cache *cache, int page, Etui_Rotation rotation);
+Etui_Cache_Entry *etui_cache_add(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y, const void *data, int width, int height);
+Etui_Cache_Entry *etui_cache_take(Etui_Cache *cache, int page, double scale, Etui_Rotation rotation, int x, int y, void *data, int width, int height);
+void etui_cache_entry_pin(Etui_Cache_Entry *entry);
+void etui_cache_entry_unpin(Etui_Cache *cache, Etui_Cache_Entry *entry);
+void etui_cache_stats_get(const Etui_Cache *cache, unsigned int *hits, unsigned int *misses, size_t *size);
+
+
+#endif /* ETUI_CACHE_H */
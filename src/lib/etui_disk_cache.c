@@ -0,0 +1,638 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <direct.h>
+# include <sys/utime.h>
+#else
+# include <utime.h>
+#endif
+
+#include <Eina.h>
+#include <Ecore.h> /* for Ecore_Thread in Etui_Module_Instance */
+#include <Eet.h>
+
+#include "Etui.h"
+#include "etui_module.h"
+#include "etui_file.h"
+#include "etui_disk_cache.h"
+#include "etui_private.h"
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+/**
+ * @cond LOCAL
+ */
+
+/*
+ * Each document has its own eet file in the cache directory, named after
+ * a hash of its content and of its file, so that a renamed document is
+ * found again and a modified one is not. The renderings are stored with the key
+ * "page/rotation/scale", the scale in thousandths. When a rendering makes
+ * the cache too large, the least recently used files of the documents
+ * which are not opened are removed.
+ */
+
+/* size of the parts of the document that are hashed */
+#define ETUI_DISK_CACHE_HASH_CHUNK (64 * 1024)
+/* renderings smaller than that are thumbnails, stored in JPEG, in pixels */
+#define ETUI_DISK_CACHE_THUMB_AREA (512 * 512)
+#define ETUI_DISK_CACHE_THUMB_QUALITY 85
+/*
+ * eet keeps in memory what is written until the file is closed, it is
+ * reopened when it holds more than that
+ */
+#define ETUI_DISK_CACHE_PENDING_MAX (32 * 1024 * 1024)
+/* the cache is trimmed to that part of its budget, so that it is not at each write */
+#define ETUI_DISK_CACHE_TRIM_RATIO 0.75
+
+struct Etui_Disk_Cache_s
+{
+    Eet_File *ef;
+    char *path;
+    size_t written; /* bytes written since the document is opened */
+    size_t pending; /* bytes written since the eet file is opened */
+    Eina_Lock lock; /* the cache is filled by threads too */
+    /*
+     * keys of the renderings, so that the main loop knows if a page is
+     * cached without waiting for a write, which holds lock
+     */
+    Eina_Hash *keys;
+    Eina_Lock keys_lock;
+};
+
+typedef struct
+{
+    char *path;
+    unsigned long int mtime;
+    unsigned long long int size;
+} Etui_Disk_Cache_File;
+
+static char *_etui_disk_cache_dir = NULL;
+static size_t _etui_disk_cache_budget = ETUI_DISK_CACHE_SIZE_DEFAULT;
+/* protects the variables below, the caches are written by threads */
+static Eina_Lock _etui_disk_cache_lock;
+static Eina_List *_etui_disk_cache_opened = NULL; /* files not to be removed */
+static unsigned long long int _etui_disk_cache_used = 0;
+static Eina_Bool _etui_disk_cache_used_known = EINA_FALSE;
+
+/* 64 bits FNV-1a */
+static uint64_t
+_etui_disk_cache_hash(uint64_t h, const unsigned char *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+static uint64_t
+_etui_disk_cache_hash_u64(uint64_t h, uint64_t v)
+{
+    unsigned char s[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        s[i] = (unsigned char)((v >> (i * 8)) & 0xff);
+
+    return _etui_disk_cache_hash(h, s, sizeof(s));
+}
+
+/*
+ * the size of the document, its beginning, its middle and its end are
+ * hashed, without reading all of it. The device, the inode and the
+ * modification time of the file are added, so that a document modified
+ * in the parts which are not read gets another cache file.
+ */
+static uint64_t
+_etui_disk_cache_file_hash(const char *filename, const unsigned char *base, size_t size)
+{
+    struct stat st;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    h = _etui_disk_cache_hash_u64(h, (uint64_t)size);
+    if (filename && (stat(filename, &st) == 0))
+    {
+        h = _etui_disk_cache_hash_u64(h, (uint64_t)st.st_dev);
+        h = _etui_disk_cache_hash_u64(h, (uint64_t)st.st_ino);
+        h = _etui_disk_cache_hash_u64(h, (uint64_t)st.st_mtime);
+    }
+
+    if (size <= 3 * ETUI_DISK_CACHE_HASH_CHUNK)
+        return _etui_disk_cache_hash(h, base, size);
+
+    h = _etui_disk_cache_hash(h, base, ETUI_DISK_CACHE_HASH_CHUNK);
+    h = _etui_disk_cache_hash(h, base + (size - ETUI_DISK_CACHE_HASH_CHUNK) / 2,
+                              ETUI_DISK_CACHE_HASH_CHUNK);
+    h = _etui_disk_cache_hash(h, base + size - ETUI_DISK_CACHE_HASH_CHUNK,
+                              ETUI_DISK_CACHE_HASH_CHUNK);
+
+    return h;
+}
+
+static Eina_Bool
+_etui_disk_cache_mkdir(const char *path)
+{
+#ifdef _WIN32
+    if ((_mkdir(path) == 0) || (errno == EEXIST))
+#else
+    if ((mkdir(path, S_IRWXU) == 0) || (errno == EEXIST))
+#endif
+        return EINA_TRUE;
+
+    return EINA_FALSE;
+}
+
+static void
+_etui_disk_cache_key(char *buf, size_t size, int page, Etui_Rotation rotation, double scale)
+{
+    snprintf(buf, size, "%d/%d/%d",
+             page, (int)rotation, (int)(scale * 1000.0 + 0.5));
+}
+
+/* width and height are checked when they are positive, and set */
+static unsigned int *
+_etui_disk_cache_read(Etui_Disk_Cache *dc, const char *key, int *width, int *height)
+{
+    Eet_Image_Encoding lossy;
+    unsigned int w;
+    unsigned int h;
+    int alpha;
+    int compress;
+    int quality;
+    void *data;
+
+    eina_lock_take(&dc->lock);
+    data = eet_data_image_read(dc->ef, key, &w, &h,
+                               &alpha, &compress, &quality, &lossy);
+    eina_lock_release(&dc->lock);
+
+    if (!data)
+        return NULL;
+
+    /* written by another version of the module, or corrupted */
+    if (((*width > 0) && ((unsigned int)*width != w)) ||
+        ((*height > 0) && ((unsigned int)*height != h)))
+    {
+        INF("rendering %s of %ux%u in %s instead of %dx%d",
+            key, w, h, dc->path, *width, *height);
+        free(data);
+        return NULL;
+    }
+
+    *width = (int)w;
+    *height = (int)h;
+
+    return (unsigned int *)data;
+}
+
+static int
+_etui_disk_cache_file_cmp(const void *d1, const void *d2)
+{
+    const Etui_Disk_Cache_File *f1 = d1;
+    const Etui_Disk_Cache_File *f2 = d2;
+
+    if (f1->mtime < f2->mtime)
+        return -1;
+    if (f1->mtime > f2->mtime)
+        return 1;
+    return 0;
+}
+
+static Eina_Bool
+_etui_disk_cache_opened_is(const char *path)
+{
+    const Eina_List *l;
+    const Etui_Disk_Cache *dc;
+
+    EINA_LIST_FOREACH(_etui_disk_cache_opened, l, dc)
+    {
+        if (strcmp(dc->path, path) == 0)
+            return EINA_TRUE;
+    }
+
+    return EINA_FALSE;
+}
+
+/*
+ * computes the size of the cache and removes the least recently used
+ * files until it fits in max, except the ones of the opened documents.
+ * Called with _etui_disk_cache_lock taken.
+ */
+static void
+_etui_disk_cache_trim(unsigned long long int max)
+{
+    Eina_Iterator *it;
+    Eina_File_Direct_Info *info;
+    Eina_Inarray *files;
+    Etui_Disk_Cache_File *f;
+    unsigned long long int total = 0;
+
+    files = eina_inarray_new(sizeof(Etui_Disk_Cache_File), 16);
+    if (!files)
+        return;
+
+    it = eina_file_direct_ls(_etui_disk_cache_dir);
+    if (!it)
+    {
+        eina_inarray_free(files);
+        return;
+    }
+
+    EINA_ITERATOR_FOREACH(it, info)
+    {
+        Etui_Disk_Cache_File file;
+        Eina_Stat st;
+
+        if (!eina_str_has_extension(info->path, ".eet") ||
+            (eina_file_statat(eina_iterator_container_get(it), info, &st) != 0))
+            continue;
+
+        file.path = strdup(info->path);
+        if (!file.path)
+            continue;
+
+        file.mtime = st.mtime;
+        file.size = st.size;
+        eina_inarray_push(files, &file);
+        total += st.size;
+    }
+    eina_iterator_free(it);
+
+    eina_inarray_sort(files, _etui_disk_cache_file_cmp);
+    EINA_INARRAY_FOREACH(files, f)
+    {
+        if ((total > max) &&
+            !_etui_disk_cache_opened_is(f->path) &&
+            (remove(f->path) == 0))
+        {
+            DBG("%s removed from the disk cache", f->path);
+            total -= f->size;
+        }
+        free(f->path);
+    }
+    eina_inarray_free(files);
+
+    _etui_disk_cache_used = total;
+    _etui_disk_cache_used_known = EINA_TRUE;
+}
+
+/* size is the number of bytes just written in the cache */
+static void
+_etui_disk_cache_used_add(int size)
+{
+    eina_lock_take(&_etui_disk_cache_lock);
+    if (!_etui_disk_cache_used_known)
+        _etui_disk_cache_trim(_etui_disk_cache_budget);
+    else
+        _etui_disk_cache_used += size;
+
+    if (_etui_disk_cache_used > _etui_disk_cache_budget)
+        _etui_disk_cache_trim((unsigned long long int)(_etui_disk_cache_budget * ETUI_DISK_CACHE_TRIM_RATIO));
+    eina_lock_release(&_etui_disk_cache_lock);
+}
+
+/**
+ * @endcond
+ */
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+Eina_Bool
+etui_disk_cache_init(void)
+{
+    char buf[PATH_MAX];
+    const char *cache_home;
+    int len;
+
+    if (!eet_init())
+        return EINA_FALSE;
+
+    if (!eina_lock_new(&_etui_disk_cache_lock))
+    {
+        eet_shutdown();
+        return EINA_FALSE;
+    }
+
+    cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home)
+        len = snprintf(buf, sizeof(buf), "%s", cache_home);
+    else
+        len = snprintf(buf, sizeof(buf), "%s/.cache",
+                       eina_environment_home_get());
+
+    /* the disk cache is disabled if its directory can not be created */
+    if ((len <= 0) || ((size_t)len + sizeof("/etui") > sizeof(buf)) ||
+        !_etui_disk_cache_mkdir(buf))
+    {
+        WRN("no cache directory, disk cache disabled");
+        return EINA_TRUE;
+    }
+
+    strcat(buf, "/etui");
+    if (!_etui_disk_cache_mkdir(buf))
+    {
+        WRN("can not create %s, disk cache disabled", buf);
+        return EINA_TRUE;
+    }
+
+    _etui_disk_cache_dir = strdup(buf);
+    INF("disk cache in %s", buf);
+
+    return EINA_TRUE;
+}
+
+void
+etui_disk_cache_shutdown(void)
+{
+    free(_etui_disk_cache_dir);
+    _etui_disk_cache_dir = NULL;
+    _etui_disk_cache_opened = eina_list_free(_etui_disk_cache_opened);
+    _etui_disk_cache_used_known = EINA_FALSE;
+    eina_lock_free(&_etui_disk_cache_lock);
+    eet_shutdown();
+}
+
+Etui_Disk_Cache *
+etui_disk_cache_new(const Etui_File *ef)
+{
+    char path[PATH_MAX];
+    Etui_Disk_Cache *dc;
+    const unsigned char *base;
+    char **list;
+    size_t size;
+    int count = 0;
+    int i;
+
+    if (!_etui_disk_cache_dir || (_etui_disk_cache_budget == 0))
+        return NULL;
+
+    base = etui_file_base_get(ef);
+    size = etui_file_size_get(ef);
+    if (!base || (size == 0))
+        return NULL;
+
+    snprintf(path, sizeof(path), "%s/%016llx.eet", _etui_disk_cache_dir,
+             (unsigned long long int)_etui_disk_cache_file_hash(etui_file_filename_get(ef),
+                                                                base, size));
+
+    dc = (Etui_Disk_Cache *)calloc(1, sizeof(Etui_Disk_Cache));
+    if (!dc)
+        return NULL;
+
+    dc->path = strdup(path);
+    if (!dc->path)
+        goto free_dc;
+
+    if (!eina_lock_new(&dc->lock))
+        goto free_path;
+
+    /* the file becomes the most recently used one, it may not exist yet */
+    utime(path, NULL);
+
+    if (!eina_lock_new(&dc->keys_lock))
+        goto free_lock;
+
+    dc->keys = eina_hash_string_superfast_new(NULL);
+    if (!dc->keys)
+        goto free_keys_lock;
+
+    dc->ef = eet_open(path, EET_FILE_MODE_READ_WRITE);
+    if (!dc->ef)
+    {
+        ERR("can not open disk cache %s", path);
+        goto free_keys;
+    }
+
+    list = eet_list(dc->ef, "*", &count);
+    for (i = 0; i < count; i++)
+        eina_hash_set(dc->keys, list[i], (void *)1);
+    free(list);
+
+    eina_lock_take(&_etui_disk_cache_lock);
+    _etui_disk_cache_opened = eina_list_append(_etui_disk_cache_opened, dc);
+    eina_lock_release(&_etui_disk_cache_lock);
+
+    DBG("disk cache %s opened for %s", path, etui_file_filename_get(ef));
+
+    return dc;
+
+  free_keys:
+    eina_hash_free(dc->keys);
+  free_keys_lock:
+    eina_lock_free(&dc->keys_lock);
+  free_lock:
+    eina_lock_free(&dc->lock);
+  free_path:
+    free(dc->path);
+  free_dc:
+    free(dc);
+
+    return NULL;
+}
+
+void
+etui_disk_cache_free(Etui_Disk_Cache *dc)
+{
+    if (!dc)
+        return;
+
+    eina_lock_take(&_etui_disk_cache_lock);
+    _etui_disk_cache_opened = eina_list_remove(_etui_disk_cache_opened, dc);
+    eina_lock_release(&_etui_disk_cache_lock);
+
+    eina_lock_take(&dc->lock);
+    eet_close(dc->ef);
+    eina_lock_release(&dc->lock);
+    eina_lock_free(&dc->lock);
+    eina_hash_free(dc->keys);
+    eina_lock_free(&dc->keys_lock);
+    free(dc->path);
+    free(dc);
+}
+
+/* does not read the file, so it can be called from the main loop */
+Eina_Bool
+etui_disk_cache_exists(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation)
+{
+    char key[64];
+    Eina_Bool res;
+
+    if (!dc)
+        return EINA_FALSE;
+
+    _etui_disk_cache_key(key, sizeof(key), page, rotation, scale);
+    eina_lock_take(&dc->keys_lock);
+    res = eina_hash_find(dc->keys, key) != NULL;
+    eina_lock_release(&dc->keys_lock);
+
+    return res;
+}
+
+/*
+ * Returns the pixels of the page rendered at scale, allocated with
+ * malloc(), or NULL if the rendering has not the size width x height.
+ */
+unsigned int *
+etui_disk_cache_find(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation, int width, int height)
+{
+    char key[64];
+
+    if (!dc || (width <= 0) || (height <= 0))
+        return NULL;
+
+    _etui_disk_cache_key(key, sizeof(key), page, rotation, scale);
+
+    return _etui_disk_cache_read(dc, key, &width, &height);
+}
+
+/*
+ * Returns the pixels of the page rendered at the smallest scale, whatever
+ * the scale, allocated with malloc(), or NULL.
+ */
+unsigned int *
+etui_disk_cache_thumb_find(Etui_Disk_Cache *dc, int page, Etui_Rotation rotation, int *width, int *height)
+{
+    char glob[64];
+    char key[64];
+    char **list;
+    int count = 0;
+    int scale_min = -1;
+    int i;
+
+    if (!dc)
+        return NULL;
+
+    /* any size */
+    *width = 0;
+    *height = 0;
+
+    snprintf(glob, sizeof(glob), "%d/%d/*", page, (int)rotation);
+    eina_lock_take(&dc->lock);
+    list = eet_list(dc->ef, glob, &count);
+    eina_lock_release(&dc->lock);
+
+    for (i = 0; i < count; i++)
+    {
+        const char *s;
+        int scale;
+
+        s = strrchr(list[i], '/');
+        scale = s ? atoi(s + 1) : 0;
+        if ((scale > 0) && ((scale_min < 0) || (scale < scale_min)))
+            scale_min = scale;
+    }
+    free(list);
+
+    if (scale_min < 0)
+        return NULL;
+
+    snprintf(key, sizeof(key), "%d/%d/%d", page, (int)rotation, scale_min);
+
+    return _etui_disk_cache_read(dc, key, width, height);
+}
+
+void
+etui_disk_cache_add(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation, const unsigned int *data, int width, int height)
+{
+    char key[64];
+    Eina_Bool thumb;
+    int size;
+
+    if (!dc || !data || (width <= 0) || (height <= 0))
+        return;
+
+    /* the document alone fills the cache */
+    if (dc->written >= _etui_disk_cache_budget)
+        return;
+
+    _etui_disk_cache_key(key, sizeof(key), page, rotation, scale);
+    thumb = ((size_t)width * height) <= ETUI_DISK_CACHE_THUMB_AREA;
+
+    eina_lock_take(&dc->lock);
+    if (thumb)
+        size = eet_data_image_write(dc->ef, key, data, width, height, 1,
+                                    0, ETUI_DISK_CACHE_THUMB_QUALITY,
+                                    EET_IMAGE_JPEG);
+    else
+        size = eet_data_image_write(dc->ef, key, data, width, height, 1,
+                                    EET_COMPRESSION_VERYFAST, 0,
+                                    EET_IMAGE_LOSSLESS);
+    if (size > 0)
+    {
+        dc->written += size;
+        dc->pending += size;
+    }
+
+    if (dc->pending > ETUI_DISK_CACHE_PENDING_MAX)
+    {
+        DBG("disk cache %s written", dc->path);
+        eet_close(dc->ef);
+        dc->ef = eet_open(dc->path, EET_FILE_MODE_READ_WRITE);
+        dc->pending = 0;
+        /* the next calls fail without crashing */
+        if (!dc->ef)
+            ERR("can not reopen disk cache %s", dc->path);
+    }
+    eina_lock_release(&dc->lock);
+
+    if (size > 0)
+    {
+        eina_lock_take(&dc->keys_lock);
+        eina_hash_set(dc->keys, key, (void *)1);
+        eina_lock_release(&dc->keys_lock);
+        _etui_disk_cache_used_add(size);
+    }
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+EAPI void
+etui_disk_cache_size_set(size_t size)
+{
+    _etui_disk_cache_budget = size;
+}
+
+EAPI size_t
+etui_disk_cache_size_get(void)
+{
+    return _etui_disk_cache_budget;
+}
@@ -0,0 +1,36 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ETUI_DISK_CACHE_H
+#define ETUI_DISK_CACHE_H
+
+
+#define ETUI_DISK_CACHE_SIZE_DEFAULT (512 * 1024 * 1024)
+
+typedef struct Etui_Disk_Cache_s Etui_Disk_Cache;
+
+Eina_Bool etui_disk_cache_init(void);
+void etui_disk_cache_shutdown(void);
+Etui_Disk_Cache *etui_disk_cache_new(const Etui_File *ef);
+void etui_disk_cache_free(Etui_Disk_Cache *dc);
+Eina_Bool etui_disk_cache_exists(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation);
+unsigned int *etui_disk_cache_find(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation, int width, int height);
+unsigned int *etui_disk_cache_thumb_find(Etui_Disk_Cache *dc, int page, Etui_Rotation rotation, int *width, int *height);
+void etui_disk_cache_add(Etui_Disk_Cache *dc, int page, double scale, Etui_Rotation rotation, const unsigned int *data, int width, int height);
+
+
+#endif /* ETUI_DISK_CACHE_H */
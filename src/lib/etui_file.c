@@ -18,6 +18,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <Eina.h>
 #include <Ecore.h> /* for Ecore_Thread in Etui_Module */
@@ -41,15 +42,53 @@ static inline char *realpath(const char *file, char *resolved)
 }
 #endif
 
+/* the format of a file is found from its first bytes only */
+#define ETUI_FILE_SNIFF_SIZE 4096
+
 struct Etui_File_s
 {
     char *filename;
     Eina_File *file;
-    Etui_Module *module;
-    void *base;
+    Etui_Module_Instance *instance; /* the module and its data for this file */
+    void *base; /* mapped before the module is initialised */
     size_t size;
+    Eina_File_Populate rule; /* access pattern of the module to base */
 };
 
+static Eina_File_Populate
+_etui_file_map_rule_get(const char *module_name)
+{
+    /* PostScript is read from the beginning to the end */
+    if (module_name && (strcmp(module_name, "ps") == 0))
+        return EINA_FILE_SEQUENTIAL;
+
+    /* cross reference tables and archive directories (ComicBook, EPUB) */
+    /* are read at random offsets */
+    return EINA_FILE_RANDOM;
+}
+
+/*
+ * the file is mapped without being read in advance, only the pages
+ * touched by the module are read, whatever the size of the file. It is
+ * mapped once, before the threads of the module can use it.
+ */
+static Eina_Bool
+_etui_file_map(Etui_File *ef, const char *module_name)
+{
+    Eina_File_Populate rule;
+
+    rule = _etui_file_map_rule_get(module_name);
+    if (ef->base && (rule == ef->rule))
+        return EINA_TRUE;
+
+    if (ef->base)
+        eina_file_map_free(ef->file, ef->base);
+    ef->rule = rule;
+    ef->base = eina_file_map_all(ef->file, ef->rule);
+
+    return ef->base != NULL;
+}
+
 /****** Comic Book ******/
 
 #ifdef ETUI_BUILD_CB
@@ -91,8 +130,8 @@ etui_file_is_cb(const char *filename,
         (base[1] == 'z') &&
         (base[2] == 0xbc) &&
         (base[3] == 0xaf) &&
-        (base[3] == 0x27) &&
-        (base[3] == 0x1c))
+        (base[4] == 0x27) &&
+        (base[5] == 0x1c))
     {
         INF("%s is a Comic Book (7z archive)", filename);
         return EINA_TRUE;
@@ -462,9 +501,9 @@ etui_file_is_tiff(const char *filename EINA_UNUSED,
  *============================================================================*/
 
 
-const Etui_Module *etui_file_module_get(const Etui_File *ef)
+const Etui_Module_Instance *etui_file_instance_get(const Etui_File *ef)
 {
-    return (ef) ? ef->module : NULL;
+    return (ef) ? ef->instance : NULL;
 }
 
 EAPI const void *
@@ -491,8 +530,10 @@ etui_file_new (const char *filename)
     char file[PATH_MAX];
     Etui_File *ef;
     Etui_Module *module;
-    void *module_data = NULL;
+    Etui_Module_Instance *instance = NULL;
     const char *module_name = NULL;
+    const unsigned char *sniff;
+    size_t sniff_size;
     char *res;
 
     if (!filename || !*filename)
@@ -519,25 +560,31 @@ etui_file_new (const char *filename)
     if (!ef->file)
         goto free_filename;
 
-    ef->base = eina_file_map_all(ef->file, EINA_FILE_POPULATE);
-    if (!ef->base)
-        goto close_file;
-
     ef->size = eina_file_size_get(ef->file);
 
-    if (etui_file_is_pdf(file, ef->base, ef->size))
+    /* only the beginning of the file is mapped to find its format */
+    sniff_size = ef->size;
+    if (sniff_size > ETUI_FILE_SNIFF_SIZE)
+        sniff_size = ETUI_FILE_SNIFF_SIZE;
+    sniff = eina_file_map_new(ef->file, EINA_FILE_SEQUENTIAL, 0, sniff_size);
+    if (!sniff)
+        goto close_file;
+
+    if (etui_file_is_pdf(file, sniff, sniff_size))
         module_name = "pdf";
-    else if (etui_file_is_ps(file, ef->base, ef->size))
+    else if (etui_file_is_ps(file, sniff, sniff_size))
         module_name = "ps";
-    else if (etui_file_is_djvu(file, ef->base, ef->size))
+    else if (etui_file_is_djvu(file, sniff, sniff_size))
         module_name = "djvu";
-    else if (etui_file_is_cb(file, ef->base, ef->size))
+    else if (etui_file_is_cb(file, sniff, sniff_size))
         module_name = "cb";
-    else if (etui_file_is_epub(file, ef->base, ef->size))
+    else if (etui_file_is_epub(file, sniff, sniff_size))
         module_name = "epub";
-    else if (etui_file_is_tiff(file, ef->base, ef->size))
+    else if (etui_file_is_tiff(file, sniff, sniff_size))
         module_name = "tiff";
 
+    eina_file_map_free(ef->file, (void *)sniff);
+
     /* FIXME: XPS, txt, DVI */
 
     INF("automagic module name: %s", module_name);
@@ -545,8 +592,9 @@ etui_file_new (const char *filename)
     module = etui_module_find(module_name);
     if (module)
     {
-        module_data = module->functions->init(ef);
-        if (!module_data)
+        if (_etui_file_map(ef, module_name))
+            instance = etui_module_instance_new(module, ef);
+        if (!instance)
         {
             etui_module_unload(module);
             module = NULL;
@@ -565,8 +613,10 @@ etui_file_new (const char *filename)
             module = etui_module_find(module_name);
             if (module)
             {
-                module_data = module->functions->init(ef);
-                if (!module_data)
+                instance = NULL;
+                if (_etui_file_map(ef, module_name))
+                    instance = etui_module_instance_new(module, ef);
+                if (!instance)
                 {
                     etui_module_unload(module);
                     module = NULL;
@@ -577,15 +627,15 @@ etui_file_new (const char *filename)
         }
     }
 
-    if (!module || !module_data)
+    if (!module || !instance)
     {
         ERR("Can not find an appropriate module for file %s", filename);
         goto close_file;
     }
 
-    module->data = module_data;
-
-    ef->module = module;
+    ef->instance = instance;
+    /* the threads may use the module after the file is freed */
+    instance->file = eina_file_dup(ef->file);
 
     return ef;
 
@@ -605,7 +655,8 @@ etui_file_free(Etui_File *ef)
     if (!ef)
         return;
 
-    etui_module_unload(ef->module);
+    /* the module is unloaded with the instance */
+    etui_module_instance_free(ef->instance);
     eina_file_close(ef->file);
     free(ef->filename);
     free(ef);
@@ -616,3 +667,133 @@ etui_file_filename_get(const Etui_File *ef)
 {
     return ef ? ef->filename : NULL;
 }
+
+EAPI const char *
+etui_file_module_name_get(const Etui_File *ef)
+{
+    return ef ? ef->instance->module->definition->name : NULL;
+}
+
+EAPI int
+etui_file_pages_count(const Etui_File *ef)
+{
+    Etui_Module_Instance *instance;
+    int count;
+
+    if (!ef)
+        return 0;
+
+    instance = ef->instance;
+    eina_lock_take(&instance->lock);
+    count = instance->module->functions->pages_count(instance->data);
+    eina_lock_release(&instance->lock);
+
+    return count;
+}
+
+EAPI Eina_Bool
+etui_file_page_raster_size_get(const Etui_File *ef, int page_num, double scale, Etui_Rotation rotation, int *width, int *height)
+{
+    Etui_Module_Instance *instance;
+    Eina_Bool res;
+    int w = 0;
+    int h = 0;
+
+    if (width) *width = 0;
+    if (height) *height = 0;
+
+    if (!ef)
+        return EINA_FALSE;
+
+    instance = ef->instance;
+    if (!instance->module->functions->page_raster_size)
+        return EINA_FALSE;
+
+    eina_lock_take(&instance->lock);
+    res = instance->module->functions->page_raster_size(instance->data,
+                                                        page_num, scale,
+                                                        rotation, &w, &h);
+    eina_lock_release(&instance->lock);
+
+    if (!res || (w <= 0) || (h <= 0))
+        return EINA_FALSE;
+
+    if (width) *width = w;
+    if (height) *height = h;
+
+    return EINA_TRUE;
+}
+
+/*
+ * renders a page without any canvas. buffer must hold height rows of
+ * stride bytes, where width and height are given by
+ * etui_file_page_raster_size_get(). The calls are serialised per file,
+ * so a worker pool must open one Etui_File per thread.
+ */
+EAPI Eina_Bool
+etui_file_page_render_to_buffer(const Etui_File *ef, int page_num, double scale, Etui_Rotation rotation, unsigned int *buffer, int stride)
+{
+    Etui_Module_Instance *instance;
+    unsigned int *pixels;
+    Eina_Bool res;
+    int w;
+    int h;
+    int i;
+
+    if (!ef || !buffer)
+        return EINA_FALSE;
+
+    instance = ef->instance;
+    if (!instance->module->functions->page_raster ||
+        !instance->module->functions->page_raster_size)
+    {
+        INF("module %s can not render without a canvas",
+            instance->module->definition->name);
+        return EINA_FALSE;
+    }
+
+    eina_lock_take(&instance->lock);
+
+    res = instance->module->functions->page_raster_size(instance->data,
+                                                        page_num, scale,
+                                                        rotation, &w, &h);
+    if (!res || (w <= 0) || (h <= 0) || ((size_t)stride < ((size_t)w * 4)))
+    {
+        eina_lock_release(&instance->lock);
+        return EINA_FALSE;
+    }
+
+    /* the modules write packed rows, so pad the rows afterwards if needed */
+    if ((size_t)stride == ((size_t)w * 4))
+        pixels = buffer;
+    else
+    {
+        pixels = (unsigned int *)malloc((size_t)w * (size_t)h * sizeof(unsigned int));
+        if (!pixels)
+        {
+            eina_lock_release(&instance->lock);
+            return EINA_FALSE;
+        }
+    }
+
+    res = instance->module->functions->page_raster(instance->data,
+                                                   page_num, scale, rotation,
+                                                   pixels, 0, 0, w, h,
+                                                   NULL);
+    eina_lock_release(&instance->lock);
+
+    /* the copy does not need the module */
+    if (pixels != buffer)
+    {
+        if (res)
+        {
+            for (i = 0; i < h; i++)
+                memcpy((unsigned char *)buffer + (size_t)i * (size_t)stride,
+                       pixels + (size_t)i * (size_t)w,
+                       (size_t)w * sizeof(unsigned int));
+        }
+        free(pixels);
+    }
+
+    return res;
+}
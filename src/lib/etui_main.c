@@ -25,6 +25,7 @@
 #include "Etui.h"
 #include "etui_private.h"
 #include "etui_module.h"
+#include "etui_disk_cache.h"
 
 /*============================================================================*
  *                                  Local                                     *
@@ -35,6 +36,7 @@
  */
 
 static int _etui_init_count = 0;
+static int _etui_page_threads = 0; /* 0 for one per CPU */
 
 /**
  * @endcond
@@ -92,14 +94,22 @@ etui_init(void)
         goto shutdown_evas;
     }
 
+    if (!etui_disk_cache_init())
+    {
+        ERR("Could not initialize the disk cache.");
+        goto shutdown_eio;
+    }
+
     if (!etui_module_init())
     {
         ERR("Could not initialize module system.");
-        goto shutdown_eio;
+        goto shutdown_disk_cache;
     }
 
     return _etui_init_count;
 
+  shutdown_disk_cache:
+    etui_disk_cache_shutdown();
   shutdown_eio:
     eio_shutdown();
   shutdown_evas:
@@ -126,6 +136,7 @@ etui_shutdown(void)
         return _etui_init_count;
 
     etui_module_shutdown();
+    etui_disk_cache_shutdown();
     eio_shutdown();
     evas_shutdown();
     ecore_shutdown();
@@ -135,3 +146,26 @@ etui_shutdown(void)
 
     return _etui_init_count;
 }
+
+/*
+ * The modules may render a page with several threads. A program rendering
+ * several documents or pages at once shares the CPUs between them.
+ */
+EAPI void
+etui_page_threads_set(int threads)
+{
+    _etui_page_threads = (threads > 0) ? threads : 0;
+}
+
+EAPI int
+etui_page_threads_get(void)
+{
+    int threads;
+
+    if (_etui_page_threads > 0)
+        return _etui_page_threads;
+
+    threads = eina_cpu_count();
+
+    return (threads > 0) ? threads : 1;
+}
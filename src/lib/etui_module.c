@@ -27,6 +27,8 @@
 #include "Etui.h"
 #include "etui_private.h"
 #include "etui_module.h"
+#include "etui_search.h"
+#include "etui_disk_cache.h"
 
 /*============================================================================*
  *                                  Local                                     *
@@ -56,6 +58,10 @@ ETUI_EINA_STATIC_MODULE_DEFINE(cb);
 ETUI_EINA_STATIC_MODULE_DEFINE(djvu);
 #endif
 
+#ifdef ETUI_BUILD_STATIC_EPUB
+ETUI_EINA_STATIC_MODULE_DEFINE(epub);
+#endif
+
 #ifdef ETUI_BUILD_STATIC_PDF
 ETUI_EINA_STATIC_MODULE_DEFINE(pdf);
 #endif
@@ -80,6 +86,9 @@ static const struct
 #ifdef ETUI_BUILD_STATIC_DJVU
     ETUI_EINA_STATIC_MODULE_USE(djvu),
 #endif
+#ifdef ETUI_BUILD_STATIC_EPUB
+    ETUI_EINA_STATIC_MODULE_USE(epub),
+#endif
 #ifdef ETUI_BUILD_STATIC_PDF
     ETUI_EINA_STATIC_MODULE_USE(pdf),
 #endif
@@ -314,7 +323,10 @@ etui_module_load(Etui_Module *em)
         return EINA_FALSE;
 
     if (em->loaded)
+    {
+        em->ref++;
         return EINA_TRUE;
+    }
 
     if (!em->definition)
         return EINA_FALSE;
@@ -323,6 +335,7 @@ etui_module_load(Etui_Module *em)
         return EINA_FALSE;
 
     em->loaded = 1;
+    em->ref = 1;
 
     return EINA_TRUE;
 }
@@ -333,10 +346,146 @@ etui_module_unload(Etui_Module *em)
     if (!em || !em->loaded || !em->definition)
         return;
 
+    /* the module is shared by all the documents of its format */
+    if (--em->ref > 0)
+        return;
+
     em->definition->func.close(em);
     em->loaded = 0;
 }
 
+Etui_Module_Instance *
+etui_module_instance_new(Etui_Module *em, const Etui_File *ef)
+{
+    Etui_Module_Instance *emi;
+
+    if (!em || !em->loaded)
+        return NULL;
+
+    emi = (Etui_Module_Instance *)calloc(1, sizeof(Etui_Module_Instance));
+    if (!emi)
+        return NULL;
+
+    if (!eina_lock_new(&emi->lock))
+        goto free_emi;
+
+    if (!eina_condition_new(&emi->priority_cond, &emi->lock))
+        goto free_lock;
+
+    emi->data = em->functions->init(ef);
+    if (!emi->data)
+        goto free_condition;
+
+    emi->module = em;
+    emi->ref = 1;
+
+    return emi;
+
+  free_condition:
+    eina_condition_free(&emi->priority_cond);
+  free_lock:
+    eina_lock_free(&emi->lock);
+  free_emi:
+    free(emi);
+
+    return NULL;
+}
+
+/* called when the file is freed, the threads still running are stopped */
+void
+etui_module_instance_free(Etui_Module_Instance *emi)
+{
+    if (!emi)
+        return;
+
+    if (emi->render)
+    {
+        emi->cancel.abort = 1;
+        ecore_thread_cancel(emi->render);
+    }
+
+    etui_module_instance_unref(emi);
+}
+
+Etui_Module_Instance *
+etui_module_instance_ref(Etui_Module_Instance *emi)
+{
+    emi->ref++;
+
+    return emi;
+}
+
+void
+etui_module_instance_unref(Etui_Module_Instance *emi)
+{
+    if (--emi->ref > 0)
+        return;
+
+    emi->module->functions->shutdown(emi->data);
+    etui_search_index_free(emi->search_index);
+    etui_disk_cache_free(emi->disk_cache);
+    eina_condition_free(&emi->priority_cond);
+    eina_lock_free(&emi->lock);
+    /* the module is shared by all the documents of its format */
+    etui_module_unload(emi->module);
+    if (emi->file)
+        eina_file_close(emi->file);
+    free(emi);
+}
+
+/*
+ * takes the lock in a thread. The main loop does not wait for the lock,
+ * it only tries to take it, and the threads wait while it has failed
+ */
+void
+etui_module_instance_lock_take(Etui_Module_Instance *emi)
+{
+    eina_lock_take(&emi->lock);
+    /* the wait is timed, priority is cleared without the lock */
+    while (emi->priority)
+        eina_condition_timedwait(&emi->priority_cond, 0.01);
+}
+
+/* takes the lock in the main loop, without waiting for the threads */
+Eina_Bool
+etui_module_instance_lock_take_try(Etui_Module_Instance *emi)
+{
+    if (eina_lock_take_try(&emi->lock) != EINA_LOCK_SUCCEED)
+    {
+        emi->priority = 1;
+        return EINA_FALSE;
+    }
+
+    if (emi->priority)
+    {
+        emi->priority = 0;
+        eina_condition_broadcast(&emi->priority_cond);
+    }
+
+    return EINA_TRUE;
+}
+
+/*
+ * opens the disk cache when the document is displayed, the other users
+ * of the file, like etui-render, do not need it
+ */
+void
+etui_module_instance_disk_cache_open(Etui_Module_Instance *emi, const Etui_File *ef)
+{
+    if (emi->disk_cache_opened)
+        return;
+
+    emi->disk_cache_opened = EINA_TRUE;
+
+    /*
+     * the pages of the modules without page_raster() may not be the same
+     * from a session to another (reflowed documents)
+     */
+    if (emi->module->functions->page_raster &&
+        emi->module->functions->page_raster_size)
+        emi->disk_cache = etui_disk_cache_new(ef);
+}
+
 Etui_Module *
 etui_module_find(const char *name)
 {
@@ -41,6 +41,33 @@
 typedef struct _Etui_Module_Func Etui_Module_Func;
 typedef struct _Etui_Module_Api Etui_Module_Api;
 typedef struct _Etui_Module Etui_Module;
+typedef struct _Etui_Module_Instance Etui_Module_Instance;
+typedef struct _Etui_Module_Cancel Etui_Module_Cancel;
+typedef struct _Etui_Module_Text Etui_Module_Text;
+
+/*
+ * set by the main loop when a rendering is superseded, polled by the
+ * modules while they rasterise so that they stop as soon as possible
+ */
+struct _Etui_Module_Cancel
+{
+    volatile int abort;
+};
+
+#define ETUI_MODULE_CANCELLED(c) ((c) && (c)->abort)
+
+/*
+ * text of a page, in reading order, with the box of each character at
+ * scale 1 and rotation 0. A character without box (a space added between
+ * two lines for example) has a box of size 0. Both arrays are allocated
+ * with malloc() by the module and freed by the library.
+ */
+struct _Etui_Module_Text
+{
+    Eina_Unicode *text;
+    Eina_Rectangle *boxes;
+    unsigned int length;
+};
 
 struct _Etui_Module_Func
 {
@@ -60,9 +87,16 @@ struct _Etui_Module_Func
     Eina_Bool         (*page_scale_set)(void *d, double scale);
     double            (*page_scale_get)(void *d);
     void              (*page_render_pre)(void *d);
-    void              (*page_render)(void *d);
+    /* cancel may be NULL */
+    void              (*page_render)(void *d, const Etui_Module_Cancel *cancel);
     void              (*page_render_end)(void *d);
     const void       *(*api_get)(void *d);
+    /* optional: render any page in a buffer, without changing the current page */
+    Eina_Bool         (*page_raster_size)(void *d, int num, double scale, Etui_Rotation rotation, int *width, int *height);
+    /* renders the region (x, y, width, height) of the page raster */
+    Eina_Bool         (*page_raster)(void *d, int num, double scale, Etui_Rotation rotation, unsigned int *buffer, int x, int y, int width, int height, const Etui_Module_Cancel *cancel);
+    /* optional: extract the text of any page, without changing the current page */
+    Eina_Bool         (*page_text_get)(void *d, int num, Etui_Module_Text *text, const Etui_Module_Cancel *cancel);
 };
 
 struct _Etui_Module_Api
@@ -81,9 +115,28 @@ struct _Etui_Module
     const Etui_Module_Api *definition;
     Etui_Module_Func *functions; /* functions exported by the module */
     int ref; /* how many refs */
+    unsigned char loaded : 1;
+};
+
+/*
+ * one per opened document. The threads rendering its pages hold a
+ * reference, so that it is freed when the last of them is done, after
+ * the file
+ */
+struct _Etui_Module_Instance
+{
+    Etui_Module *module;
     void *data; /* data returned by functions->init() */
+    Eina_File *file; /* keeps the mapping read by the module */
+    int ref; /* only used in the main loop */
     Ecore_Thread *render; /* render thread for functions->page_render*() */
-    unsigned char loaded : 1;
+    Etui_Module_Cancel cancel; /* cancellation of the render thread */
+    Eina_Lock lock; /* serialises the calls to functions between threads */
+    Eina_Condition priority_cond; /* on lock, waited by the threads while priority is set */
+    volatile int priority; /* the main loop waits for lock, the threads let it go first */
+    struct Etui_Search_Index_s *search_index; /* text of the pages, protected by lock */
+    struct Etui_Disk_Cache_s *disk_cache; /* pages rendered in previous sessions, may be NULL */
+    Eina_Bool disk_cache_opened; /* disk_cache is opened by the first smart object only */
 };
 
 Eina_Bool etui_module_init(void);
@@ -93,6 +146,14 @@ Eina_Bool etui_module_load(Etui_Module *em);
 void etui_module_unload(Etui_Module *em);
 
 Etui_Module *etui_module_find(const char *name);
+
+Etui_Module_Instance *etui_module_instance_new(Etui_Module *em, const Etui_File *ef);
+void etui_module_instance_free(Etui_Module_Instance *emi);
+Etui_Module_Instance *etui_module_instance_ref(Etui_Module_Instance *emi);
+void etui_module_instance_unref(Etui_Module_Instance *emi);
+void etui_module_instance_lock_take(Etui_Module_Instance *emi);
+Eina_Bool etui_module_instance_lock_take_try(Etui_Module_Instance *emi);
+void etui_module_instance_disk_cache_open(Etui_Module_Instance *emi, const Etui_File *ef);
 Eina_List *etui_module_list(void);
 
 EAPI Eina_Bool etui_module_register(const Etui_Module_Api *module);
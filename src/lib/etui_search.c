@@ -0,0 +1,322 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+#include <Eina.h>
+#include <Ecore.h> /* for Ecore_Thread in Etui_Module_Instance */
+
+#include "Etui.h"
+#include "etui_module.h"
+#include "etui_search.h"
+#include "etui_private.h"
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+/**
+ * @cond LOCAL
+ */
+
+/*
+ * The text of each page is extracted once, lowercased and with the
+ * whitespaces collapsed, so that a search only compares characters. The
+ * index is filled and read by the search threads while the instance lock
+ * is taken.
+ */
+
+typedef struct
+{
+    Eina_Unicode *text;
+    Eina_Rectangle *boxes; /* one box per character of text */
+    unsigned int length;
+    Eina_Bool indexed;
+} Etui_Search_Page;
+
+struct Etui_Search_Index_s
+{
+    Etui_Search_Page *pages;
+    int pages_nbr;
+};
+
+static Eina_Bool
+_etui_search_space_is(Eina_Unicode c)
+{
+    return (c == 0xa0) || iswspace((wint_t)c);
+}
+
+/*
+ * lowercases the text and replaces each run of whitespaces by a single
+ * space, in place. boxes may be NULL. Returns the new length.
+ */
+static unsigned int
+_etui_search_normalize(Eina_Unicode *text, Eina_Rectangle *boxes, unsigned int length)
+{
+    unsigned int i;
+    unsigned int j = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        Eina_Unicode c;
+
+        c = text[i];
+        if (_etui_search_space_is(c))
+        {
+            if ((j > 0) && (text[j - 1] == ' '))
+                continue;
+            c = ' ';
+        }
+        else
+            c = (Eina_Unicode)towlower((wint_t)c);
+
+        text[j] = c;
+        if (boxes)
+            boxes[j] = boxes[i];
+        j++;
+    }
+
+    return j;
+}
+
+/*
+ * adds the boxes of the characters of a hit, merged in one box per line
+ * of text
+ */
+static void
+_etui_search_hit_add(Eina_Inarray *hits, const Eina_Rectangle *chars, unsigned int nbr)
+{
+    Eina_Rectangle box;
+    Eina_Bool empty = EINA_TRUE;
+    unsigned int i;
+
+    for (i = 0; i < nbr; i++)
+    {
+        const Eina_Rectangle *r;
+
+        r = chars + i;
+        if ((r->w <= 0) || (r->h <= 0))
+            continue;
+
+        /* the character is not on the line of the current box */
+        if (!empty && ((r->y >= box.y + box.h) || (r->y + r->h <= box.y)))
+        {
+            eina_inarray_push(hits, &box);
+            empty = EINA_TRUE;
+        }
+
+        if (empty)
+        {
+            box = *r;
+            empty = EINA_FALSE;
+        }
+        else
+            eina_rectangle_union(&box, r);
+    }
+
+    if (!empty)
+        eina_inarray_push(hits, &box);
+}
+
+/**
+ * @endcond
+ */
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+Etui_Search_Index *
+etui_search_index_new(int pages_nbr)
+{
+    Etui_Search_Index *index;
+
+    if (pages_nbr <= 0)
+        return NULL;
+
+    index = (Etui_Search_Index *)calloc(1, sizeof(Etui_Search_Index));
+    if (!index)
+        return NULL;
+
+    index->pages = (Etui_Search_Page *)calloc(pages_nbr, sizeof(Etui_Search_Page));
+    if (!index->pages)
+    {
+        free(index);
+        return NULL;
+    }
+
+    index->pages_nbr = pages_nbr;
+
+    return index;
+}
+
+void
+etui_search_index_free(Etui_Search_Index *index)
+{
+    int i;
+
+    if (!index)
+        return;
+
+    for (i = 0; i < index->pages_nbr; i++)
+    {
+        free(index->pages[i].text);
+        free(index->pages[i].boxes);
+    }
+    free(index->pages);
+    free(index);
+}
+
+int
+etui_search_index_pages_count(const Etui_Search_Index *index)
+{
+    return index->pages_nbr;
+}
+
+Eina_Bool
+etui_search_index_page_exists(const Etui_Search_Index *index, int page)
+{
+    if ((page < 0) || (page >= index->pages_nbr))
+        return EINA_FALSE;
+
+    return index->pages[page].indexed;
+}
+
+/*
+ * The arrays of text are owned by the index. A page without text is
+ * indexed too, so that it is not extracted again.
+ */
+void
+etui_search_index_page_set(Etui_Search_Index *index, int page, Etui_Module_Text *text)
+{
+    Etui_Search_Page *p;
+
+    if ((page < 0) || (page >= index->pages_nbr))
+    {
+        free(text->text);
+        free(text->boxes);
+        return;
+    }
+
+    p = index->pages + page;
+    free(p->text);
+    free(p->boxes);
+    p->text = NULL;
+    p->boxes = NULL;
+    p->length = 0;
+    p->indexed = EINA_TRUE;
+
+    if (!text->text || !text->boxes || (text->length == 0))
+    {
+        free(text->text);
+        free(text->boxes);
+        return;
+    }
+
+    p->text = text->text;
+    p->boxes = text->boxes;
+    p->length = _etui_search_normalize(p->text, p->boxes, text->length);
+
+    DBG("page %d indexed, %u characters", page, p->length);
+}
+
+/*
+ * Returns the needle normalized like the indexed text, NULL if it has no
+ * character to search.
+ */
+Eina_Unicode *
+etui_search_needle_new(const char *needle, unsigned int *length)
+{
+    Eina_Unicode *n;
+    unsigned int start;
+    int len;
+
+    if (!needle || !*needle)
+        return NULL;
+
+    n = eina_unicode_utf8_to_unicode(needle, &len);
+    if (!n)
+        return NULL;
+
+    *length = _etui_search_normalize(n, NULL, len);
+
+    /* the leading and trailing spaces are not searched */
+    start = ((*length > 0) && (n[0] == ' ')) ? 1 : 0;
+    if ((*length > start) && (n[*length - 1] == ' '))
+        (*length)--;
+    *length -= start;
+    if (*length == 0)
+    {
+        free(n);
+        return NULL;
+    }
+
+    memmove(n, n + start, *length * sizeof(Eina_Unicode));
+    n[*length] = 0;
+
+    return n;
+}
+
+/*
+ * Returns the boxes of the occurrences of needle in the page, at scale 1
+ * and rotation 0, or NULL if there is none.
+ */
+Eina_Inarray *
+etui_search_index_find(const Etui_Search_Index *index, int page, const Eina_Unicode *needle, unsigned int length)
+{
+    const Etui_Search_Page *p;
+    Eina_Inarray *hits = NULL;
+    unsigned int i;
+
+    if ((page < 0) || (page >= index->pages_nbr))
+        return NULL;
+
+    p = index->pages + page;
+    if (p->length < length)
+        return NULL;
+
+    for (i = 0; i <= p->length - length; i++)
+    {
+        if ((p->text[i] != needle[0]) ||
+            memcmp(p->text + i, needle, length * sizeof(Eina_Unicode)))
+            continue;
+
+        if (!hits)
+        {
+            hits = eina_inarray_new(sizeof(Eina_Rectangle), 0);
+            if (!hits)
+                return NULL;
+        }
+
+        _etui_search_hit_add(hits, p->boxes + i, length);
+        /* occurrences do not overlap */
+        i += length - 1;
+    }
+
+    return hits;
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
@@ -0,0 +1,33 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ETUI_SEARCH_H
+#define ETUI_SEARCH_H
+
+
+typedef struct Etui_Search_Index_s Etui_Search_Index;
+
+Etui_Search_Index *etui_search_index_new(int pages_nbr);
+void etui_search_index_free(Etui_Search_Index *index);
+int etui_search_index_pages_count(const Etui_Search_Index *index);
+Eina_Bool etui_search_index_page_exists(const Etui_Search_Index *index, int page);
+void etui_search_index_page_set(Etui_Search_Index *index, int page, Etui_Module_Text *text);
+Eina_Unicode *etui_search_needle_new(const char *needle, unsigned int *length);
+Eina_Inarray *etui_search_index_find(const Etui_Search_Index *index, int page, const Eina_Unicode *needle, unsigned int length);
+
+
+#endif /* ETUI_SEARCH_H */
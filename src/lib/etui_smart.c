@@ -24,6 +24,9 @@
 #include "Etui.h"
 #include "etui_module.h"
 #include "etui_file.h"
+#include "etui_cache.h"
+#include "etui_search.h"
+#include "etui_disk_cache.h"
 #include "etui_private.h"
 
 /*============================================================================*
@@ -34,28 +37,288 @@
  * @cond LOCAL
  */
 
+#define ETUI_PREFETCH_AHEAD_DEFAULT 2
+#define ETUI_PREFETCH_BEHIND_DEFAULT 1
+
+/* scale of the preview, relative to the scale of the page */
+#define ETUI_PREVIEW_RATIO 0.25
+/* no preview is rendered for pages smaller than that, in pixels */
+#define ETUI_PREVIEW_AREA_MIN (1024 * 1024)
+
+/* interval between two tries to take the lock of the instance, in seconds */
+#define ETUI_PENDING_DELAY 0.005
+
+#define ETUI_TILE_SIZE 256
+/* added to the order of the tiles around the visible ones */
+#define ETUI_TILE_ORDER_BORDER (1 << 24)
+
 typedef struct Etui_Smart_Data_ Etui_Smart_Data;
+typedef struct Etui_Smart_Prefetch_ Etui_Smart_Prefetch;
+typedef struct Etui_Smart_Page_Raster_ Etui_Smart_Page_Raster;
+typedef struct Etui_Smart_Tile_ Etui_Smart_Tile;
+typedef struct Etui_Smart_Tile_Rect_ Etui_Smart_Tile_Rect;
+typedef struct Etui_Smart_Tile_Raster_ Etui_Smart_Tile_Raster;
+typedef struct Etui_Smart_Tiles_Job_ Etui_Smart_Tiles_Job;
+typedef struct Etui_Smart_Search_ Etui_Smart_Search;
+typedef struct Etui_Smart_Search_Hit_ Etui_Smart_Search_Hit;
+typedef struct Etui_Smart_Warm_ Etui_Smart_Warm;
+typedef struct Etui_Smart_Render_ Etui_Smart_Render;
+typedef struct Etui_Smart_Requests_ Etui_Smart_Requests;
 
 struct Etui_Smart_Data_
 {
     EINA_REFCOUNT;
 
     /* properties */
-    Etui_Module *module;
+    Etui_Module_Instance *instance;
 
     /* private */
+    Evas_Object *self;
     Evas_Object *frame;
     Evas_Object *obj;
+    Evas_Object *preview; /* shown until the page is rendered */
     /* mode */
     Etui_Mode mode;
+
+    /* rendered pages */
+    Etui_Cache *cache;
+    Etui_Cache_Entry *displayed; /* cache entry whose pixels are in obj */
+    struct
+    {
+        int page;
+        double scale;
+        Etui_Rotation rotation;
+        double preview_scale; /* 0 when no preview is rendered first */
+    } render_key; /* page being rendered by the thread */
+    Etui_Smart_Render *render_job; /* job of instance->render */
+    unsigned char render_pending : 1; /* page_render_pre() has been called, or render_disk set */
+    unsigned char render_disk : 1; /* the page is read from the disk cache, without the module */
+    unsigned char disk_skip : 1; /* the disk cache failed, the next update renders */
+    unsigned char update_pending : 1; /* page changed while rendering */
+    unsigned char preview_shown : 1;
+
+    /* set while a thread holds the instance lock, applied when it is free */
+    struct
+    {
+        int page;
+        double scale;
+        Etui_Rotation rotation;
+        Ecore_Timer *timer; /* tries to take the lock again */
+        unsigned char page_set : 1;
+        unsigned char scale_set : 1;
+        unsigned char rotation_set : 1;
+    } pending;
+
+    /* pages rendered in advance around the current one */
+    struct
+    {
+        int ahead;
+        int behind;
+        Ecore_Thread *thread;
+        Etui_Smart_Prefetch *job;
+    } prefetch;
+
+    /* page split in tiles, only the visible ones are rendered */
+    struct
+    {
+        Etui_Cache *cache;
+        Eina_List *tiles; /* Etui_Smart_Tile displayed */
+        int page;
+        double scale;
+        Etui_Rotation rotation;
+        int width; /* size of the page raster */
+        int height;
+        Eina_Rectangle geometry; /* page on the canvas */
+        Ecore_Thread *thread;
+        Etui_Smart_Tiles_Job *job;
+        unsigned char enabled : 1;
+        unsigned char valid : 1; /* page, scale, rotation and size are set */
+    } tiled;
+
+    /* text searched in all the pages */
+    struct
+    {
+        Ecore_Thread *thread;
+        Etui_Smart_Search *job;
+        Eina_Hash *hits; /* Etui_Smart_Search_Hit of the last search, by page */
+        Eina_List *rects; /* highlight of the hits of the displayed page */
+        unsigned char highlight : 1;
+    } search;
+
+    /* all the pages rendered in the disk cache */
+    struct
+    {
+        Ecore_Thread *thread;
+        Etui_Smart_Warm *job;
+    } warm;
+
+    /* pages rendered for the application, see etui_object_page_request() */
+    Eina_List *requests;
+    Etui_Smart_Requests *requests_worker; /* created by the first request */
+};
+
+/* the key is copied, the thread does not read sd */
+struct Etui_Smart_Render_
+{
+    Etui_Smart_Data *sd; /* NULL when the object is deleted */
+    Etui_Module_Instance *instance;
+    int page;
+    double scale;
+    Etui_Rotation rotation;
+    double preview_scale;
+    Etui_Smart_Page_Raster *disk; /* the page found in the disk cache by the thread */
+    size_t cache_budget; /* a page found on disk is displayed from the cache */
+    unsigned char thumb : 1; /* a preview is looked for in the disk cache */
+    unsigned char disk_only : 1; /* page_render_pre() has not been called */
+};
+
+/* a rendering written to the disk cache by a thread */
+typedef struct
+{
+    Etui_Module_Instance *instance;
+    int page;
+    double scale;
+    Etui_Rotation rotation;
+    unsigned int *data;
+    int width;
+    int height;
+} Etui_Smart_Disk_Write;
+
+struct Etui_Smart_Prefetch_
+{
+    Etui_Smart_Data *sd; /* NULL when the job is cancelled */
+    Etui_Module_Instance *instance;
+    double scale;
+    Etui_Rotation rotation;
+    int *pages;
+    int pages_nbr;
+    Etui_Module_Cancel cancel;
+};
+
+struct Etui_Smart_Page_Raster_
+{
+    int page;
+    int width;
+    int height;
+    unsigned int *data;
+};
+
+struct Etui_Smart_Tile_
+{
+    Evas_Object *obj;
+    Etui_Cache_Entry *entry; /* pixels of the tile */
+};
+
+struct Etui_Smart_Tile_Rect_
+{
+    int x;
+    int y;
+    int width;
+    int height;
+    int order; /* visible tiles first, the nearest to the center first */
+};
+
+struct Etui_Smart_Tile_Raster_
+{
+    Etui_Smart_Tile_Rect rect;
+    unsigned int *data;
+};
+
+struct Etui_Smart_Tiles_Job_
+{
+    Etui_Smart_Data *sd; /* NULL when the job is cancelled */
+    Etui_Module_Instance *instance;
+    int page;
+    double scale;
+    Etui_Rotation rotation;
+    /* queue of the tiles to render, protected by the instance lock */
+    Etui_Smart_Tile_Rect *rects;
+    int rects_nbr;
+    int next;
+    /* tiles already rendered by the job, only used by the thread */
+    Etui_Smart_Tile_Rect *done;
+    int done_nbr;
+    Etui_Module_Cancel cancel;
+};
+
+struct Etui_Smart_Search_
+{
+    Etui_Smart_Data *sd; /* NULL when the job is cancelled */
+    Etui_Module_Instance *instance;
+    Eina_Unicode *needle;
+    unsigned int length;
+    int page_start;
+    int pages_nbr;
+    Etui_Search_Hit_Cb hit_cb;
+    Etui_Search_End_Cb end_cb;
+    const void *data;
+    Etui_Module_Cancel cancel;
+};
+
+struct Etui_Smart_Search_Hit_
+{
+    int page;
+    int width; /* size of the page at scale 1 and rotation 0, 0 if unknown */
+    int height;
+    Eina_Inarray *boxes;
+};
+
+struct Etui_Smart_Warm_
+{
+    Etui_Smart_Data *sd; /* NULL when the job is cancelled */
+    Etui_Module_Instance *instance;
+    double scale;
+    Etui_Rotation rotation;
+    int pages_nbr;
+    Etui_Module_Cancel cancel;
+};
+
+/* renders the requests of an object one after the other */
+struct Etui_Smart_Requests_
+{
+    Etui_Smart_Data *sd; /* NULL when the object is deleted */
+    Etui_Module_Instance *instance;
+    Eina_Lock lock; /* protects todo and running */
+    Eina_List *todo; /* requests not rendered yet, the oldest first */
+    Eina_Bool running; /* a thread takes the requests from todo */
+    int threads; /* threads not ended yet, only used in the main loop */
+};
+
+struct Etui_Page_Request_s
+{
+    Etui_Smart_Data *sd; /* NULL when the request is cancelled */
+    int page;
+    double scale;
+    Etui_Rotation rotation;
+    Etui_Page_Cb cb;
+    const void *data;
+    Etui_Cache_Entry *entry; /* page found in the cache, pinned until job runs */
+    Ecore_Job *job;
+    Etui_Smart_Page_Raster *raster; /* set by the worker */
+    Etui_Module_Cancel cancel;
 };
 
 static Evas_Smart *_etui_smart = NULL;
 
 static void _etui_smart_page_render(void *data, Ecore_Thread *thread);
+static void _etui_smart_page_render_notify(void *data, Ecore_Thread *thread, void *msg_data);
 static void _etui_smart_page_render_end(void *data, Ecore_Thread *thread);
-static void _etui_smart_page_render_cancel(void *data, Ecore_Thread *thread);
 static void _etui_smart_page_eval(Etui_Smart_Data *sd);
+static void _etui_smart_page_update(Etui_Smart_Data *sd, Eina_Bool locked);
+static void _etui_smart_preview_set(Etui_Smart_Data *sd, const unsigned int *data, int width, int height);
+static void _etui_smart_prefetch_start(Etui_Smart_Data *sd);
+static void _etui_smart_prefetch_cancel(Etui_Smart_Data *sd);
+static void _etui_smart_pending_apply(Etui_Smart_Data *sd);
+static void _etui_smart_search_cancel(Etui_Smart_Data *sd);
+static void _etui_smart_search_hits_clear(Etui_Smart_Data *sd);
+static void _etui_smart_highlight_update(Etui_Smart_Data *sd);
+static void _etui_smart_warm_cancel(Etui_Smart_Data *sd);
+static void _etui_smart_requests_cancel(Etui_Smart_Data *sd);
+static Eina_Bool _etui_smart_tiled_is(const Etui_Smart_Data *sd);
+static void _etui_smart_tiles_page_set(Etui_Smart_Data *sd, Eina_Bool locked);
+static void _etui_smart_tiles_update(Etui_Smart_Data *sd);
+static void _etui_smart_tiles_cancel(Etui_Smart_Data *sd);
+static void _etui_smart_tiles_clear(Etui_Smart_Data *sd);
 
 /* internal smart object routines */
 
@@ -78,7 +341,7 @@ static void _etui_smart_page_eval(Etui_Smart_Data *sd);
     if (!o) goto _err;                                    \
     smart = evas_object_smart_data_get(o);                \
     if (!smart) goto _err;                                \
-    if (!smart->module)                                   \
+    if (!smart->instance)                                 \
     {                                                     \
         ERR("Module unvailable: "                         \
             "etui_objectfile_set() has not been called"); \
@@ -91,6 +354,13 @@ static void _etui_smart_page_eval(Etui_Smart_Data *sd);
 
 #define ETUI_OBJ_NAME "etui_object"
 
+/* event_info of "page,rendered" is a pointer to the page number */
+static const Evas_Smart_Cb_Description _etui_smart_callbacks[] =
+{
+    { "page,rendered", "i" },
+    { NULL, NULL }
+};
+
 /* static void */
 /* _mouse_move(void *data, Evas *ev EINA_UNUSED, Evas_Object *obj, void *event_info) */
 /* { */
@@ -132,6 +402,7 @@ _etui_smart_add(Evas_Object *obj)
 {
     Etui_Smart_Data *sd;
     Evas_Object *frame;
+    Evas_Object *preview;
 
     sd = calloc(1, sizeof(Etui_Smart_Data));
     EINA_SAFETY_ON_NULL_RETURN(sd);
@@ -144,10 +415,85 @@ _etui_smart_add(Evas_Object *obj)
     evas_object_show(frame);
     sd->frame = frame;
 
+    preview = evas_object_image_filled_add(evas_object_evas_get(obj));
+    evas_object_smart_member_add(preview, obj);
+    evas_object_image_alpha_set(preview, EINA_FALSE);
+    evas_object_clip_set(preview, frame);
+    sd->preview = preview;
+
+    sd->cache = etui_cache_new(ETUI_CACHE_SIZE_DEFAULT);
+    if (!sd->cache)
+    {
+        evas_object_del(preview);
+        evas_object_del(frame);
+        free(sd);
+        return;
+    }
+
+    sd->tiled.cache = etui_cache_new(ETUI_CACHE_SIZE_DEFAULT);
+    if (!sd->tiled.cache)
+    {
+        etui_cache_free(sd->cache);
+        evas_object_del(preview);
+        evas_object_del(frame);
+        free(sd);
+        return;
+    }
+
+    sd->self = obj;
     sd->mode = ETUI_MODE_FREE;
+    sd->prefetch.ahead = ETUI_PREFETCH_AHEAD_DEFAULT;
+    sd->prefetch.behind = ETUI_PREFETCH_BEHIND_DEFAULT;
     evas_object_smart_data_set(obj, sd);
 }
 
+/*
+ * Stops the jobs which use the instance of the object and releases its
+ * image, before the object is deleted or its file changes.
+ */
+static void
+_etui_smart_instance_detach(Etui_Smart_Data *sd)
+{
+    if (sd->pending.timer)
+    {
+        ecore_timer_del(sd->pending.timer);
+        sd->pending.timer = NULL;
+        sd->instance->priority = 0;
+    }
+    sd->pending.page_set = 0;
+    sd->pending.rotation_set = 0;
+    sd->pending.scale_set = 0;
+    sd->update_pending = 0;
+    sd->render_pending = 0;
+
+    _etui_smart_search_cancel(sd);
+    _etui_smart_search_hits_clear(sd);
+    _etui_smart_warm_cancel(sd);
+    _etui_smart_requests_cancel(sd);
+    _etui_smart_prefetch_cancel(sd);
+    _etui_smart_tiles_clear(sd);
+    if (sd->render_job)
+    {
+        /*
+         * the module renders in its image until the thread stops, it
+         * is deleted by the end or cancel callback of the job
+         */
+        sd->render_job->sd = NULL;
+        sd->render_job = NULL;
+        sd->instance->cancel.abort = 1;
+        ecore_thread_cancel(sd->instance->render);
+        evas_object_smart_member_del(sd->obj);
+        evas_object_hide(sd->obj);
+    }
+    else if (sd->obj)
+        sd->instance->module->functions->evas_object_del(sd->instance->data);
+    sd->obj = NULL;
+
+    /* the file may have been freed already, the last reference frees it */
+    etui_module_instance_unref(sd->instance);
+    sd->instance = NULL;
+}
+
 static void
 _etui_smart_del(Evas_Object *obj)
 {
@@ -158,10 +504,10 @@ _etui_smart_del(Evas_Object *obj)
 
     EINA_REFCOUNT_UNREF(sd)
     {
-        if (sd->module->render)
-            ecore_thread_cancel(sd->module->render);
-        if (sd->obj)
-            sd->module->functions->evas_object_del(sd->module->data);
+        if (sd->instance)
+            _etui_smart_instance_detach(sd);
+        etui_cache_free(sd->tiled.cache);
+        etui_cache_free(sd->cache);
         free(sd);
     }
 }
@@ -198,21 +544,35 @@ static void
 _etui_smart_show(Evas_Object *obj)
 {
     Etui_Smart_Data *sd;
+    Etui_Smart_Tile *tile;
+    Eina_List *l;
 
     sd = evas_object_smart_data_get(obj);
     EINA_SAFETY_ON_NULL_RETURN(sd);
-    evas_object_show(sd->obj);
-
+    if (_etui_smart_tiled_is(sd))
+    {
+        EINA_LIST_FOREACH(sd->tiled.tiles, l, tile)
+            evas_object_show(tile->obj);
+    }
+    else
+        evas_object_show(sd->obj);
+    if (sd->preview_shown)
+        evas_object_show(sd->preview);
 }
 
 static void
 _etui_smart_hide(Evas_Object *obj)
 {
     Etui_Smart_Data *sd;
+    Etui_Smart_Tile *tile;
+    Eina_List *l;
 
     sd = evas_object_smart_data_get(obj);
     EINA_SAFETY_ON_NULL_RETURN(sd);
     evas_object_hide(sd->obj);
+    evas_object_hide(sd->preview);
+    EINA_LIST_FOREACH(sd->tiled.tiles, l, tile)
+        evas_object_hide(tile->obj);
 }
 
 static void
@@ -253,11 +613,68 @@ _etui_smart_calculate(Evas_Object *obj)
 
     sd = evas_object_smart_data_get(obj);
     EINA_SAFETY_ON_NULL_RETURN(sd);
-    if (!sd->module->render)
-      sd->module->render = ecore_thread_run(_etui_smart_page_render,
-                                            _etui_smart_page_render_end,
-                                            _etui_smart_page_render_cancel,
-                                            sd);
+    if (sd->render_pending && !sd->instance->render)
+    {
+        Etui_Smart_Render *job;
+        Etui_Cache_Entry *entry;
+        Eina_Bool thumb = EINA_FALSE;
+        int width;
+        int height;
+
+        sd->render_key.page = sd->instance->module->functions->page_get(sd->instance->data);
+        sd->render_key.scale = sd->instance->module->functions->page_scale_get(sd->instance->data);
+        sd->render_key.rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+        sd->render_key.preview_scale = 0.0;
+        sd->render_pending = 0;
+
+        /*
+         * the page rendered at another scale is shown at once, otherwise
+         * a low resolution preview is rendered first. A page read from the
+         * disk cache has no preview.
+         */
+        entry = etui_cache_page_find(sd->cache,
+                                     sd->render_key.page,
+                                     sd->render_key.rotation);
+        if (entry)
+            _etui_smart_preview_set(sd, entry->data, entry->width, entry->height);
+        else if (!sd->render_disk)
+        {
+            thumb = !!sd->instance->disk_cache;
+            if (sd->instance->module->functions->page_raster &&
+                sd->instance->module->functions->page_raster_size)
+            {
+                evas_object_image_size_get(sd->obj, &width, &height);
+                if (((size_t)width * height) >= ETUI_PREVIEW_AREA_MIN)
+                    sd->render_key.preview_scale = sd->render_key.scale * ETUI_PREVIEW_RATIO;
+            }
+        }
+
+        job = calloc(1, sizeof(Etui_Smart_Render));
+        if (!job)
+        {
+            ERR("can not render page %d", sd->render_key.page);
+            return;
+        }
+
+        job->sd = sd;
+        job->instance = etui_module_instance_ref(sd->instance);
+        job->page = sd->render_key.page;
+        job->scale = sd->render_key.scale;
+        job->rotation = sd->render_key.rotation;
+        job->preview_scale = sd->render_key.preview_scale;
+        job->thumb = thumb;
+        job->disk_only = sd->render_disk;
+        job->cache_budget = etui_cache_budget_get(sd->cache);
+        sd->render_disk = 0;
+
+        sd->render_job = job;
+        sd->instance->cancel.abort = 0;
+        sd->instance->render = ecore_thread_feedback_run(_etui_smart_page_render,
+                                                         _etui_smart_page_render_notify,
+                                                         _etui_smart_page_render_end,
+                                                         _etui_smart_page_render_end,
+                                                         job, EINA_FALSE);
+    }
 }
 
 static void
@@ -278,7 +695,7 @@ _etui_smart_init(void)
         sc.color_set = _etui_smart_color_set;
         sc.clip_set = _etui_smart_clip_set;
         sc.clip_unset = _etui_smart_clip_unset;
-/*         sc.callbacks = _etui_smart_callbacks; */
+        sc.callbacks = _etui_smart_callbacks;
         sc.calculate = _etui_smart_calculate;
     }
     _etui_smart = evas_smart_class_new(&sc);
@@ -287,36 +704,1825 @@ _etui_smart_init(void)
 /* private calls */
 
 static void
-_etui_smart_page_render(void *data, Ecore_Thread *thread EINA_UNUSED)
+_etui_smart_image_detach(Etui_Smart_Data *sd)
 {
-    Etui_Smart_Data *sd;
+    if (!sd->displayed)
+        return;
 
-    sd = data;
-    if (!sd)
+    /*
+     * the image uses the pixels of a cache entry, give it back a buffer
+     * of its own so that the module does not render into the cache
+     */
+    evas_object_image_data_set(sd->obj, NULL);
+    evas_object_image_size_set(sd->obj, 1, 1);
+    etui_cache_entry_unpin(sd->cache, sd->displayed);
+    sd->displayed = NULL;
+}
+
+static void
+_etui_smart_image_cached_set(Etui_Smart_Data *sd, Etui_Cache_Entry *entry)
+{
+    if (sd->displayed == entry)
+        return;
+
+    evas_object_image_size_set(sd->obj, entry->width, entry->height);
+    evas_object_image_data_set(sd->obj, entry->data);
+    evas_object_image_data_update_add(sd->obj, 0, 0, entry->width, entry->height);
+
+    etui_cache_entry_pin(entry);
+    if (sd->displayed)
+        etui_cache_entry_unpin(sd->cache, sd->displayed);
+    sd->displayed = entry;
+}
+
+static void
+_etui_smart_preview_set(Etui_Smart_Data *sd, const unsigned int *data, int width, int height)
+{
+    evas_object_image_size_set(sd->preview, width, height);
+    evas_object_image_data_copy_set(sd->preview, (void *)data);
+    evas_object_image_data_update_add(sd->preview, 0, 0, width, height);
+    sd->preview_shown = 1;
+    if (evas_object_visible_get(sd->self))
+        evas_object_show(sd->preview);
+}
+
+static void
+_etui_smart_preview_unset(Etui_Smart_Data *sd)
+{
+    if (!sd->preview_shown)
+        return;
+
+    evas_object_hide(sd->preview);
+    evas_object_image_data_set(sd->preview, NULL);
+    evas_object_image_size_set(sd->preview, 1, 1);
+    sd->preview_shown = 0;
+}
+
+/* renders a whole page in a new buffer, the instance lock must be held */
+static Etui_Smart_Page_Raster *
+_etui_smart_page_raster(Etui_Module_Instance *instance, int page, double scale, Etui_Rotation rotation, const Etui_Module_Cancel *cancel)
+{
+    Etui_Smart_Page_Raster *p;
+    Eina_Bool res;
+
+    p = calloc(1, sizeof(Etui_Smart_Page_Raster));
+    if (!p)
+        return NULL;
+
+    p->page = page;
+    res = instance->module->functions->page_raster_size(instance->data,
+                                                        page, scale, rotation,
+                                                        &p->width, &p->height);
+    if (res && (p->width > 0) && (p->height > 0))
+    {
+        p->data = malloc((size_t)p->width * p->height * sizeof(unsigned int));
+        if (p->data)
+            res = instance->module->functions->page_raster(instance->data,
+                                                           page, scale, rotation,
+                                                           p->data, 0, 0,
+                                                           p->width, p->height,
+                                                           cancel);
+        else
+            res = EINA_FALSE;
+    }
+    else
+        res = EINA_FALSE;
+
+    if (!res)
+    {
+        free(p->data);
+        free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+static void
+_etui_smart_disk_write_run(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    Etui_Smart_Disk_Write *w = data;
+
+    etui_disk_cache_add(w->instance->disk_cache, w->page, w->scale, w->rotation,
+                        w->data, w->width, w->height);
+}
+
+static void
+_etui_smart_disk_write_free(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    Etui_Smart_Disk_Write *w = data;
+
+    etui_module_instance_unref(w->instance);
+    free(w->data);
+    free(w);
+}
+
+/* the pixels are copied, they are compressed and written by a thread */
+static void
+_etui_smart_disk_cache_add(Etui_Module_Instance *instance, int page, double scale, Etui_Rotation rotation, const unsigned int *data, int width, int height)
+{
+    Etui_Smart_Disk_Write *w;
+
+    if (!instance->disk_cache)
+        return;
+
+    w = calloc(1, sizeof(Etui_Smart_Disk_Write));
+    if (!w)
+        return;
+
+    w->data = malloc((size_t)width * height * sizeof(unsigned int));
+    if (!w->data)
+    {
+        free(w);
+        return;
+    }
+
+    memcpy(w->data, data, (size_t)width * height * sizeof(unsigned int));
+    w->instance = etui_module_instance_ref(instance);
+    w->page = page;
+    w->scale = scale;
+    w->rotation = rotation;
+    w->width = width;
+    w->height = height;
+    ecore_thread_run(_etui_smart_disk_write_run,
+                     _etui_smart_disk_write_free,
+                     _etui_smart_disk_write_free,
+                     w);
+}
+
+static void
+_etui_smart_page_cache_add(Etui_Smart_Data *sd)
+{
+    void *data;
+    int width;
+    int height;
+
+    evas_object_image_size_get(sd->obj, &width, &height);
+    data = evas_object_image_data_get(sd->obj, EINA_FALSE);
+    if (!data)
+        return;
+
+    etui_cache_add(sd->cache,
+                   sd->render_key.page,
+                   sd->render_key.scale,
+                   sd->render_key.rotation,
+                   0, 0, data, width, height);
+    _etui_smart_disk_cache_add(sd->instance,
+                               sd->render_key.page,
+                               sd->render_key.scale,
+                               sd->render_key.rotation,
+                               data, width, height);
+}
+
+/*
+ * the page rendered in a previous session, without rendering it. The
+ * module only gives the size of the page, which the rendering must have.
+ * The instance lock must not be held.
+ */
+static Etui_Smart_Page_Raster *
+_etui_smart_page_disk_find(Etui_Module_Instance *instance, int page, double scale, Etui_Rotation rotation)
+{
+    Etui_Smart_Page_Raster *p;
+    Eina_Bool res;
+
+    if (!instance->disk_cache ||
+        !etui_disk_cache_exists(instance->disk_cache, page, scale, rotation))
+        return NULL;
+
+    p = calloc(1, sizeof(Etui_Smart_Page_Raster));
+    if (!p)
+        return NULL;
+
+    p->page = page;
+    etui_module_instance_lock_take(instance);
+    res = instance->module->functions->page_raster_size(instance->data,
+                                                        page, scale, rotation,
+                                                        &p->width, &p->height);
+    eina_lock_release(&instance->lock);
+    if (res)
+        p->data = etui_disk_cache_find(instance->disk_cache, page, scale, rotation,
+                                       p->width, p->height);
+    if (!p->data)
+    {
+        free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+/*
+ * Called when the page, the scale or the rotation of the module changed.
+ * A page already rendered is taken from the cache, otherwise a new
+ * rendering is prepared and started in _etui_smart_calculate(). locked
+ * is set when the instance lock is already held by the caller.
+ */
+static void
+_etui_smart_page_update(Etui_Smart_Data *sd, Eina_Bool locked)
+{
+    Etui_Cache_Entry *entry;
+    double scale;
+    Etui_Rotation rotation;
+    int page;
+    int count;
+
+    /* the pages around the previous one are not needed anymore */
+    _etui_smart_prefetch_cancel(sd);
+
+    if (_etui_smart_tiled_is(sd))
+    {
+        /* the page is not rendered as a whole, only its visible tiles */
+        evas_object_hide(sd->obj);
+        _etui_smart_tiles_page_set(sd, locked);
+        sd->render_pending = 0;
+        _etui_smart_page_eval(sd);
+        return;
+    }
+
+    if (sd->instance->render)
+    {
+        /*
+         * the image buffer is used by the render thread, stop it and
+         * wait for it
+         */
+        sd->instance->cancel.abort = 1;
+        sd->update_pending = 1;
+        return;
+    }
+
+    page = sd->instance->module->functions->page_get(sd->instance->data);
+    scale = sd->instance->module->functions->page_scale_get(sd->instance->data);
+    rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+    /* the disk cache is read by the render thread */
+    entry = etui_cache_find(sd->cache, page, scale, rotation, 0, 0);
+    if (entry)
+    {
+        DBG("page %d found in cache", entry->page);
+        _etui_smart_image_cached_set(sd, entry);
+        sd->render_pending = 0;
+        _etui_smart_page_eval(sd);
+        _etui_smart_prefetch_start(sd);
+        return;
+    }
+
+    _etui_smart_image_detach(sd);
+
+    /*
+     * a page of the disk cache is read by the render thread, without
+     * page_render_pre() which loads the page in the module
+     */
+    sd->render_disk = 0;
+    if (!sd->disk_skip &&
+        etui_disk_cache_exists(sd->instance->disk_cache, page, scale, rotation))
+    {
+        DBG("page %d found in disk cache", page);
+        sd->render_disk = 1;
+        sd->render_pending = 1;
+        return;
+    }
+    sd->disk_skip = 0;
+
+    page = sd->instance->module->functions->page_get(sd->instance->data);
+    count = sd->instance->module->functions->pages_count(sd->instance->data);
+    if (!locked)
+        eina_lock_take(&sd->instance->lock);
+    sd->instance->module->functions->page_render_pre(sd->instance->data);
+    if (!locked)
+        eina_lock_release(&sd->instance->lock);
+    sd->render_pending = 1;
+
+    /*
+     * a reflowable document paginates its content when it is rendered,
+     * the cached pages may not have the same numbers anymore
+     */
+    if ((page != sd->instance->module->functions->page_get(sd->instance->data)) ||
+        (count != sd->instance->module->functions->pages_count(sd->instance->data)))
+    {
+        DBG("pages renumbered, cache cleared");
+        etui_cache_clear(sd->cache);
+        _etui_smart_tiles_clear(sd);
+        etui_cache_clear(sd->tiled.cache);
+    }
+}
+
+/* the minimum size of the object follows the size of the page */
+static void
+_etui_smart_size_hints_update(Etui_Smart_Data *sd)
+{
+    Evas_Coord w, h;
+
+    evas_object_geometry_get(sd->obj, NULL, NULL, &w, &h);
+    switch (sd->mode)
+    {
+       case ETUI_MODE_FREE:
+          evas_object_size_hint_min_set(sd->self, w, h);
+          break;
+       case ETUI_MODE_FIT_WIDTH:
+          evas_object_size_hint_min_set(sd->self, 0, h);
+          break;
+       case ETUI_MODE_FIT_HEIGHT:
+          evas_object_size_hint_min_set(sd->self, w, 0);
+          break;
+       case ETUI_MODE_FIT_AUTO:
+       case ETUI_MODE_UNKNOWN:
+          evas_object_size_hint_min_set(sd->self, 0, 0);
+          break;
+    }
+}
+
+/*
+ * Stops the threads which use the current page before its page, scale
+ * or rotation is changed, so that they release the lock early.
+ */
+static void
+_etui_smart_pending_cancel(Etui_Smart_Data *sd)
+{
+    if (sd->instance->render)
+    {
+        sd->instance->cancel.abort = 1;
+        sd->update_pending = 1;
+    }
+    _etui_smart_prefetch_cancel(sd);
+    _etui_smart_tiles_cancel(sd);
+}
+
+static Eina_Bool
+_etui_smart_pending_timer_cb(void *data)
+{
+    Etui_Smart_Data *sd = data;
+
+    sd->pending.timer = NULL;
+    _etui_smart_pending_apply(sd);
+
+    return ECORE_CALLBACK_CANCEL;
+}
+
+/*
+ * Gives the pending page, scale and rotation to the module. The main
+ * loop does not wait for a thread which holds the lock, it tries again
+ * a bit later, or when the render thread ends.
+ */
+static void
+_etui_smart_pending_apply(Etui_Smart_Data *sd)
+{
+    const Etui_Module_Func *f = sd->instance->module->functions;
+    Eina_Bool changed = EINA_FALSE;
+    Eina_Bool scaled = EINA_FALSE;
+
+    if (!etui_module_instance_lock_take_try(sd->instance))
+    {
+        if (!sd->pending.timer)
+            sd->pending.timer = ecore_timer_add(ETUI_PENDING_DELAY,
+                                                _etui_smart_pending_timer_cb,
+                                                sd);
+        return;
+    }
+
+    if (sd->pending.timer)
+    {
+        ecore_timer_del(sd->pending.timer);
+        sd->pending.timer = NULL;
+    }
+
+    if (sd->pending.page_set && f->page_set(sd->instance->data, sd->pending.page))
+        changed = EINA_TRUE;
+    if (sd->pending.rotation_set && f->page_rotation_set(sd->instance->data, sd->pending.rotation))
+        changed = EINA_TRUE;
+    if (sd->pending.scale_set && f->page_scale_set(sd->instance->data, sd->pending.scale))
+        changed = scaled = EINA_TRUE;
+    sd->pending.page_set = 0;
+    sd->pending.rotation_set = 0;
+    sd->pending.scale_set = 0;
+
+    if (sd->update_pending)
+    {
+        /* a change made while the render thread was running */
+        sd->update_pending = 0;
+        changed = EINA_TRUE;
+    }
+    if (changed)
+        _etui_smart_page_update(sd, EINA_TRUE);
+    eina_lock_release(&sd->instance->lock);
+
+    if (scaled)
+    {
+        _etui_smart_page_eval(sd);
+        _etui_smart_size_hints_update(sd);
+    }
+    if (changed)
+        evas_object_smart_changed(sd->self);
+}
+
+static void
+_etui_smart_prefetch_job_free(Etui_Smart_Prefetch *job)
+{
+    if (job->sd)
+    {
+        job->sd->prefetch.thread = NULL;
+        job->sd->prefetch.job = NULL;
+    }
+    free(job->pages);
+    etui_module_instance_unref(job->instance);
+    free(job);
+}
+
+static void
+_etui_smart_prefetch_run(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Prefetch *job;
+    int i;
+
+    job = data;
+    for (i = 0; i < job->pages_nbr; i++)
+    {
+        Etui_Smart_Page_Raster *p;
+
+        if (ecore_thread_check(thread))
+            return;
+
+        p = _etui_smart_page_disk_find(job->instance, job->pages[i],
+                                       job->scale, job->rotation);
+        if (!p)
+        {
+            etui_module_instance_lock_take(job->instance);
+            if (ecore_thread_check(thread))
+            {
+                eina_lock_release(&job->instance->lock);
+                return;
+            }
+
+            p = _etui_smart_page_raster(job->instance, job->pages[i],
+                                        job->scale, job->rotation,
+                                        &job->cancel);
+            eina_lock_release(&job->instance->lock);
+        }
+
+        if (p)
+            ecore_thread_feedback(thread, p);
+    }
+}
+
+static void
+_etui_smart_prefetch_notify(void *data, Ecore_Thread *thread, void *msg_data)
+{
+    Etui_Smart_Prefetch *job;
+    Etui_Smart_Page_Raster *p;
+
+    job = data;
+    p = msg_data;
+
+    if (job->sd && !ecore_thread_check(thread))
+    {
+        DBG("page %d prefetched", p->page);
+        etui_cache_take(job->sd->cache, p->page, job->scale, job->rotation,
+                        0, 0, p->data, p->width, p->height);
+    }
+    else
+        free(p->data);
+    free(p);
+}
+
+static void
+_etui_smart_prefetch_end(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    _etui_smart_prefetch_job_free(data);
+}
+
+static void
+_etui_smart_prefetch_start(Etui_Smart_Data *sd)
+{
+    Etui_Smart_Prefetch *job;
+    int page;
+    int count;
+    int i;
+
+    if (!sd->instance->module->functions->page_raster ||
+        !sd->instance->module->functions->page_raster_size)
+        return;
+
+    if (sd->prefetch.thread || ((sd->prefetch.ahead + sd->prefetch.behind) <= 0))
+        return;
+
+    /* whole pages are too large when they are tiled */
+    if (_etui_smart_tiled_is(sd))
+        return;
+
+    if (etui_cache_budget_get(sd->cache) == 0)
+        return;
+
+    job = calloc(1, sizeof(Etui_Smart_Prefetch));
+    if (!job)
+        return;
+
+    job->pages = malloc((sd->prefetch.ahead + sd->prefetch.behind) * sizeof(int));
+    if (!job->pages)
+    {
+        free(job);
+        return;
+    }
+
+    job->sd = sd;
+    job->instance = sd->instance;
+    job->scale = sd->instance->module->functions->page_scale_get(sd->instance->data);
+    job->rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+
+    page = sd->instance->module->functions->page_get(sd->instance->data);
+    count = sd->instance->module->functions->pages_count(sd->instance->data);
+
+    /* next pages first, they are the most likely to be displayed */
+    for (i = 1; i <= sd->prefetch.ahead; i++)
+    {
+        if ((page + i < count) &&
+            !etui_cache_exists(sd->cache, page + i, job->scale, job->rotation, 0, 0))
+            job->pages[job->pages_nbr++] = page + i;
+    }
+    for (i = 1; i <= sd->prefetch.behind; i++)
+    {
+        if ((page - i >= 0) &&
+            !etui_cache_exists(sd->cache, page - i, job->scale, job->rotation, 0, 0))
+            job->pages[job->pages_nbr++] = page - i;
+    }
+
+    if (job->pages_nbr == 0)
+    {
+        free(job->pages);
+        free(job);
+        return;
+    }
+
+    etui_module_instance_ref(job->instance);
+    sd->prefetch.job = job;
+    sd->prefetch.thread = ecore_thread_feedback_run(_etui_smart_prefetch_run,
+                                                    _etui_smart_prefetch_notify,
+                                                    _etui_smart_prefetch_end,
+                                                    _etui_smart_prefetch_end,
+                                                    job, EINA_FALSE);
+}
+
+static void
+_etui_smart_prefetch_cancel(Etui_Smart_Data *sd)
+{
+    if (!sd->prefetch.thread)
+        return;
+
+    /* the job is freed by the thread end or cancel callback */
+    sd->prefetch.job->sd = NULL;
+    sd->prefetch.job->cancel.abort = 1;
+    ecore_thread_cancel(sd->prefetch.thread);
+    sd->prefetch.thread = NULL;
+    sd->prefetch.job = NULL;
+}
+
+static void
+_etui_smart_search_hit_free(void *data)
+{
+    Etui_Smart_Search_Hit *hit = data;
+
+    eina_inarray_free(hit->boxes);
+    free(hit);
+}
+
+static void
+_etui_smart_highlight_clear(Etui_Smart_Data *sd)
+{
+    Evas_Object *o;
+
+    EINA_LIST_FREE(sd->search.rects, o)
+        evas_object_del(o);
+}
+
+/*
+ * Covers the boxes of the hits of the displayed page, which are at scale
+ * 1 and rotation 0, with translucent rectangles. The page image covers
+ * the whole page, whatever the mode.
+ */
+static void
+_etui_smart_highlight_update(Etui_Smart_Data *sd)
+{
+    const Etui_Smart_Search_Hit *hit;
+    const Eina_Rectangle *box;
+    Etui_Rotation rotation;
+    Evas_Coord ox, oy, ow, oh;
+    double fx, fy;
+    int page;
+
+    _etui_smart_highlight_clear(sd);
+
+    if (!sd->search.highlight || !sd->search.hits || !sd->obj)
+        return;
+
+    page = sd->instance->module->functions->page_get(sd->instance->data);
+    hit = eina_hash_find(sd->search.hits, &page);
+    if (!hit || (hit->width <= 0) || (hit->height <= 0))
+        return;
+
+    rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+    evas_object_geometry_get(sd->obj, &ox, &oy, &ow, &oh);
+    if ((rotation == ETUI_ROTATION_90) || (rotation == ETUI_ROTATION_270))
+    {
+        fx = ow / (double)hit->height;
+        fy = oh / (double)hit->width;
+    }
+    else
+    {
+        fx = ow / (double)hit->width;
+        fy = oh / (double)hit->height;
+    }
+
+    EINA_INARRAY_FOREACH(hit->boxes, box)
+    {
+        Eina_Rectangle b;
+        Evas_Object *o;
+
+        /* the rotations are clockwise */
+        switch (rotation)
+        {
+           case ETUI_ROTATION_90:
+              EINA_RECTANGLE_SET(&b, hit->height - box->y - box->h, box->x, box->h, box->w);
+              break;
+           case ETUI_ROTATION_180:
+              EINA_RECTANGLE_SET(&b, hit->width - box->x - box->w, hit->height - box->y - box->h, box->w, box->h);
+              break;
+           case ETUI_ROTATION_270:
+              EINA_RECTANGLE_SET(&b, box->y, hit->width - box->x - box->w, box->h, box->w);
+              break;
+           case ETUI_ROTATION_0:
+           default:
+              b = *box;
+              break;
+        }
+
+        o = evas_object_rectangle_add(evas_object_evas_get(sd->self));
+        evas_object_smart_member_add(o, sd->self);
+        evas_object_clip_set(o, sd->frame);
+        evas_object_pass_events_set(o, EINA_TRUE);
+        /* premultiplied yellow */
+        evas_object_color_set(o, 96, 96, 0, 96);
+        evas_object_move(o, ox + (Evas_Coord)(b.x * fx), oy + (Evas_Coord)(b.y * fy));
+        evas_object_resize(o, (Evas_Coord)(b.w * fx + 0.5) + 1, (Evas_Coord)(b.h * fy + 0.5) + 1);
+        evas_object_raise(o);
+        evas_object_show(o);
+        sd->search.rects = eina_list_append(sd->search.rects, o);
+    }
+}
+
+static void
+_etui_smart_search_hits_clear(Etui_Smart_Data *sd)
+{
+    _etui_smart_highlight_clear(sd);
+    if (sd->search.hits)
+        eina_hash_free(sd->search.hits);
+    sd->search.hits = NULL;
+}
+
+static void
+_etui_smart_search_job_free(Etui_Smart_Search *job)
+{
+    if (job->sd)
+    {
+        job->sd->search.thread = NULL;
+        job->sd->search.job = NULL;
+    }
+    free(job->needle);
+    etui_module_instance_unref(job->instance);
+    free(job);
+}
+
+/*
+ * The pages are searched from page_start to the end of the document, then
+ * from its beginning. The text of a page is extracted only the first time
+ * it is searched, the next searches only read the index.
+ */
+static void
+_etui_smart_search_run(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Search *job;
+    int i;
+
+    job = data;
+    for (i = 0; i < job->pages_nbr; i++)
+    {
+        Etui_Search_Index *index;
+        Etui_Smart_Search_Hit *hit;
+        Eina_Inarray *boxes;
+        int page;
+
+        page = (job->page_start + i) % job->pages_nbr;
+
+        etui_module_instance_lock_take(job->instance);
+        if (ecore_thread_check(thread))
+        {
+            eina_lock_release(&job->instance->lock);
+            return;
+        }
+
+        index = job->instance->search_index;
+        if (!etui_search_index_page_exists(index, page))
+        {
+            Etui_Module_Text text;
+
+            if (!job->instance->module->functions->page_text_get(job->instance->data,
+                                                                 page, &text,
+                                                                 &job->cancel))
+            {
+                if (ETUI_MODULE_CANCELLED(&job->cancel))
+                {
+                    eina_lock_release(&job->instance->lock);
+                    return;
+                }
+                /* not extracted again */
+                text.text = NULL;
+                text.boxes = NULL;
+                text.length = 0;
+            }
+            etui_search_index_page_set(index, page, &text);
+        }
+
+        boxes = etui_search_index_find(index, page, job->needle, job->length);
+        if (!boxes)
+        {
+            eina_lock_release(&job->instance->lock);
+            continue;
+        }
+
+        hit = calloc(1, sizeof(Etui_Smart_Search_Hit));
+        if (!hit)
+        {
+            eina_lock_release(&job->instance->lock);
+            eina_inarray_free(boxes);
+            continue;
+        }
+
+        /* needed to highlight the boxes at any scale and rotation */
+        if (job->instance->module->functions->page_raster_size &&
+            !job->instance->module->functions->page_raster_size(job->instance->data,
+                                                                page, 1.0,
+                                                                ETUI_ROTATION_0,
+                                                                &hit->width,
+                                                                &hit->height))
+        {
+            hit->width = 0;
+            hit->height = 0;
+        }
+        eina_lock_release(&job->instance->lock);
+
+        hit->page = page;
+        hit->boxes = boxes;
+        ecore_thread_feedback(thread, hit);
+    }
+}
+
+static void
+_etui_smart_search_notify(void *data, Ecore_Thread *thread, void *msg_data)
+{
+    Etui_Smart_Search *job;
+    Etui_Smart_Search_Hit *hit;
+
+    job = data;
+    hit = msg_data;
+
+    if (job->sd && !ecore_thread_check(thread))
+    {
+        Etui_Smart_Data *sd = job->sd;
+
+        DBG("text found page %d", hit->page);
+        /* kept for the highlight, before the callback can start another search */
+        if (sd->search.hits && eina_hash_add(sd->search.hits, &hit->page, hit))
+        {
+            job->hit_cb((void *)job->data, sd->self, hit->page, hit->boxes);
+            _etui_smart_highlight_update(sd);
+            return;
+        }
+        job->hit_cb((void *)job->data, sd->self, hit->page, hit->boxes);
+    }
+    eina_inarray_free(hit->boxes);
+    free(hit);
+}
+
+static void
+_etui_smart_search_end(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    Etui_Smart_Search *job;
+    Etui_Smart_Data *sd;
+    Etui_Search_End_Cb end_cb;
+    const void *cb_data;
+
+    job = data;
+    sd = job->sd;
+    end_cb = job->end_cb;
+    cb_data = job->data;
+    _etui_smart_search_job_free(job);
+    /* a new search can be started from the callback */
+    if (sd && end_cb)
+        end_cb((void *)cb_data, sd->self, EINA_FALSE);
+}
+
+static void
+_etui_smart_search_cancelled(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    _etui_smart_search_job_free(data);
+}
+
+static void
+_etui_smart_search_cancel(Etui_Smart_Data *sd)
+{
+    Etui_Smart_Search *job;
+    Etui_Search_End_Cb end_cb;
+    const void *data;
+
+    if (!sd->search.thread)
+        return;
+
+    /* the job is freed by the thread cancel callback, maybe right now */
+    job = sd->search.job;
+    end_cb = job->end_cb;
+    data = job->data;
+    job->sd = NULL;
+    job->cancel.abort = 1;
+    ecore_thread_cancel(sd->search.thread);
+    sd->search.thread = NULL;
+    sd->search.job = NULL;
+
+    if (end_cb)
+        end_cb((void *)data, sd->self, EINA_TRUE);
+}
+
+static void
+_etui_smart_warm_job_free(Etui_Smart_Warm *job)
+{
+    if (job->sd)
+    {
+        job->sd->warm.thread = NULL;
+        job->sd->warm.job = NULL;
+    }
+    etui_module_instance_unref(job->instance);
+    free(job);
+}
+
+/* the pages already in the disk cache are skipped */
+static void
+_etui_smart_warm_run(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Warm *job;
+    int i;
+
+    job = data;
+    for (i = 0; i < job->pages_nbr; i++)
+    {
+        Etui_Smart_Page_Raster *p;
+
+        if (ecore_thread_check(thread))
+            return;
+
+        if (etui_disk_cache_exists(job->instance->disk_cache, i,
+                                   job->scale, job->rotation))
+            continue;
+
+        etui_module_instance_lock_take(job->instance);
+        if (ecore_thread_check(thread))
+        {
+            eina_lock_release(&job->instance->lock);
+            return;
+        }
+
+        p = _etui_smart_page_raster(job->instance, i,
+                                    job->scale, job->rotation,
+                                    &job->cancel);
+        eina_lock_release(&job->instance->lock);
+
+        if (p)
+        {
+            etui_disk_cache_add(job->instance->disk_cache, p->page,
+                                job->scale, job->rotation,
+                                p->data, p->width, p->height);
+            free(p->data);
+            free(p);
+        }
+    }
+}
+
+static void
+_etui_smart_warm_end(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    _etui_smart_warm_job_free(data);
+}
+
+static void
+_etui_smart_warm_cancel(Etui_Smart_Data *sd)
+{
+    if (!sd->warm.thread)
+        return;
+
+    /* the job is freed by the thread cancel callback */
+    sd->warm.job->sd = NULL;
+    sd->warm.job->cancel.abort = 1;
+    ecore_thread_cancel(sd->warm.thread);
+    sd->warm.thread = NULL;
+    sd->warm.job = NULL;
+}
+
+static void
+_etui_smart_request_free(Etui_Page_Request *req)
+{
+    if (req->raster)
+    {
+        free(req->raster->data);
+        free(req->raster);
+    }
+    free(req);
+}
+
+static void
+_etui_smart_requests_run(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Requests *w;
+
+    w = data;
+    while (1)
+    {
+        Etui_Page_Request *req;
+
+        eina_lock_take(&w->lock);
+        req = eina_list_data_get(w->todo);
+        if (!req)
+        {
+            /* the next request starts a new thread */
+            w->running = EINA_FALSE;
+            eina_lock_release(&w->lock);
+            return;
+        }
+        w->todo = eina_list_remove_list(w->todo, w->todo);
+        eina_lock_release(&w->lock);
+
+        req->raster = _etui_smart_page_disk_find(w->instance, req->page,
+                                                 req->scale, req->rotation);
+        if (!req->raster)
+        {
+            etui_module_instance_lock_take(w->instance);
+            if (!req->cancel.abort)
+                req->raster = _etui_smart_page_raster(w->instance, req->page,
+                                                      req->scale, req->rotation,
+                                                      &req->cancel);
+            eina_lock_release(&w->instance->lock);
+
+            if (req->raster)
+                etui_disk_cache_add(w->instance->disk_cache, req->page,
+                                    req->scale, req->rotation, req->raster->data,
+                                    req->raster->width, req->raster->height);
+        }
+
+        ecore_thread_feedback(thread, req);
+    }
+}
+
+static void
+_etui_smart_requests_notify(void *data EINA_UNUSED, Ecore_Thread *thread EINA_UNUSED, void *msg_data)
+{
+    Etui_Page_Request *req;
+    Etui_Smart_Data *sd;
+    Etui_Smart_Page_Raster *p;
+
+    req = msg_data;
+    sd = req->sd;
+    if (!sd)
+    {
+        _etui_smart_request_free(req);
+        return;
+    }
+
+    sd->requests = eina_list_remove(sd->requests, req);
+    p = req->raster;
+    if (!p)
+    {
+        req->cb((void *)req->data, sd->self, req->page, NULL, 0, 0);
+        _etui_smart_request_free(req);
+        return;
+    }
+
+    /* the pixels are given to the cache after the callback */
+    req->cb((void *)req->data, sd->self, req->page,
+            p->data, p->width, p->height);
+    etui_cache_take(sd->cache, p->page, req->scale, req->rotation,
+                    0, 0, p->data, p->width, p->height);
+    free(p);
+    req->raster = NULL;
+    _etui_smart_request_free(req);
+}
+
+static void
+_etui_smart_requests_worker_free(Etui_Smart_Requests *w)
+{
+    etui_module_instance_unref(w->instance);
+    eina_lock_free(&w->lock);
+    free(w);
+}
+
+/* also called when the thread is cancelled */
+static void
+_etui_smart_requests_end(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    Etui_Smart_Requests *w;
+
+    w = data;
+    w->threads--;
+    if (!w->sd && (w->threads == 0))
+        _etui_smart_requests_worker_free(w);
+}
+
+/* the page found in the cache is given to cb from the main loop too */
+static void
+_etui_smart_request_job_cb(void *data)
+{
+    Etui_Page_Request *req;
+    Etui_Smart_Data *sd;
+
+    req = data;
+    sd = req->sd;
+    req->job = NULL;
+    sd->requests = eina_list_remove(sd->requests, req);
+    req->cb((void *)req->data, sd->self, req->page,
+            req->entry->data, req->entry->width, req->entry->height);
+    etui_cache_entry_unpin(sd->cache, req->entry);
+    _etui_smart_request_free(req);
+}
+
+static Eina_Bool
+_etui_smart_request_queue(Etui_Smart_Data *sd, Etui_Page_Request *req)
+{
+    Etui_Smart_Requests *w;
+    Eina_Bool start;
+
+    w = sd->requests_worker;
+    if (!w)
+    {
+        w = calloc(1, sizeof(Etui_Smart_Requests));
+        if (!w)
+            return EINA_FALSE;
+
+        if (!eina_lock_new(&w->lock))
+        {
+            free(w);
+            return EINA_FALSE;
+        }
+
+        w->sd = sd;
+        w->instance = etui_module_instance_ref(sd->instance);
+        sd->requests_worker = w;
+    }
+
+    eina_lock_take(&w->lock);
+    w->todo = eina_list_append(w->todo, req);
+    start = !w->running;
+    w->running = EINA_TRUE;
+    eina_lock_release(&w->lock);
+
+    if (!start)
+        return EINA_TRUE;
+
+    if (!ecore_thread_feedback_run(_etui_smart_requests_run,
+                                   _etui_smart_requests_notify,
+                                   _etui_smart_requests_end,
+                                   _etui_smart_requests_end,
+                                   w, EINA_FALSE))
+    {
+        eina_lock_take(&w->lock);
+        w->todo = eina_list_remove(w->todo, req);
+        w->running = EINA_FALSE;
+        eina_lock_release(&w->lock);
+        return EINA_FALSE;
+    }
+    w->threads++;
+
+    return EINA_TRUE;
+}
+
+static void
+_etui_smart_request_cancel(Etui_Page_Request *req)
+{
+    Etui_Smart_Data *sd;
+    Etui_Smart_Requests *w;
+    Eina_List *l = NULL;
+
+    sd = req->sd;
+    sd->requests = eina_list_remove(sd->requests, req);
+
+    if (req->job)
+    {
+        ecore_job_del(req->job);
+        etui_cache_entry_unpin(sd->cache, req->entry);
+        _etui_smart_request_free(req);
+        return;
+    }
+
+    w = sd->requests_worker;
+    eina_lock_take(&w->lock);
+    l = eina_list_data_find_list(w->todo, req);
+    if (l)
+        w->todo = eina_list_remove_list(w->todo, l);
+    eina_lock_release(&w->lock);
+
+    if (l)
+    {
+        _etui_smart_request_free(req);
+        return;
+    }
+
+    /* being rendered, freed when the worker gives it back */
+    req->sd = NULL;
+    req->cancel.abort = 1;
+}
+
+static void
+_etui_smart_requests_cancel(Etui_Smart_Data *sd)
+{
+    Etui_Smart_Requests *w;
+
+    while (sd->requests)
+        _etui_smart_request_cancel(eina_list_data_get(sd->requests));
+
+    /* the worker may use another instance than the next file */
+    w = sd->requests_worker;
+    if (!w)
+        return;
+
+    sd->requests_worker = NULL;
+    w->sd = NULL;
+    if (w->threads == 0)
+        _etui_smart_requests_worker_free(w);
+}
+
+static Eina_Bool
+_etui_smart_tiled_is(const Etui_Smart_Data *sd)
+{
+    return sd->tiled.enabled && sd->instance &&
+        sd->instance->module->functions->page_raster &&
+        sd->instance->module->functions->page_raster_size;
+}
+
+static void
+_etui_smart_tile_move(Etui_Smart_Data *sd, Etui_Smart_Tile *tile)
+{
+    double fx;
+    double fy;
+    Evas_Coord x0;
+    Evas_Coord y0;
+    Evas_Coord x1;
+    Evas_Coord y1;
+
+    fx = sd->tiled.geometry.w / (double)sd->tiled.width;
+    fy = sd->tiled.geometry.h / (double)sd->tiled.height;
+
+    /* both edges are rounded, so that there is no gap between two tiles */
+    x0 = sd->tiled.geometry.x + (Evas_Coord)(tile->entry->x * fx + 0.5);
+    y0 = sd->tiled.geometry.y + (Evas_Coord)(tile->entry->y * fy + 0.5);
+    x1 = sd->tiled.geometry.x + (Evas_Coord)((tile->entry->x + tile->entry->width) * fx + 0.5);
+    y1 = sd->tiled.geometry.y + (Evas_Coord)((tile->entry->y + tile->entry->height) * fy + 0.5);
+    evas_object_move(tile->obj, x0, y0);
+    evas_object_resize(tile->obj, x1 - x0, y1 - y0);
+}
+
+static void
+_etui_smart_tile_add(Etui_Smart_Data *sd, Etui_Cache_Entry *entry)
+{
+    Etui_Smart_Tile *tile;
+
+    tile = calloc(1, sizeof(Etui_Smart_Tile));
+    if (!tile)
+        return;
+
+    tile->obj = evas_object_image_filled_add(evas_object_evas_get(sd->self));
+    if (!tile->obj)
+    {
+        free(tile);
+        return;
+    }
+
+    evas_object_image_alpha_set(tile->obj, EINA_FALSE);
+    evas_object_image_size_set(tile->obj, entry->width, entry->height);
+    evas_object_image_data_set(tile->obj, entry->data);
+    evas_object_image_data_update_add(tile->obj, 0, 0, entry->width, entry->height);
+    evas_object_smart_member_add(tile->obj, sd->self);
+    evas_object_clip_set(tile->obj, sd->frame);
+
+    etui_cache_entry_pin(entry);
+    tile->entry = entry;
+
+    _etui_smart_tile_move(sd, tile);
+    if (evas_object_visible_get(sd->self))
+        evas_object_show(tile->obj);
+
+    sd->tiled.tiles = eina_list_append(sd->tiled.tiles, tile);
+}
+
+static void
+_etui_smart_tile_free(Etui_Smart_Data *sd, Etui_Smart_Tile *tile)
+{
+    /* the pixels belong to the cache */
+    evas_object_image_data_set(tile->obj, NULL);
+    evas_object_del(tile->obj);
+    etui_cache_entry_unpin(sd->tiled.cache, tile->entry);
+    free(tile);
+}
+
+static Eina_Bool
+_etui_smart_tiles_job_done(const Etui_Smart_Tiles_Job *job, const Etui_Smart_Tile_Rect *rect)
+{
+    int i;
+
+    for (i = 0; i < job->done_nbr; i++)
+    {
+        if ((job->done[i].x == rect->x) && (job->done[i].y == rect->y))
+            return EINA_TRUE;
+    }
+
+    return EINA_FALSE;
+}
+
+static void
+_etui_smart_tiles_job_free(Etui_Smart_Tiles_Job *job)
+{
+    if (job->sd)
+    {
+        job->sd->tiled.thread = NULL;
+        job->sd->tiled.job = NULL;
+    }
+    free(job->rects);
+    free(job->done);
+    etui_module_instance_unref(job->instance);
+    free(job);
+}
+
+static void
+_etui_smart_tiles_run(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Tiles_Job *job;
+
+    job = data;
+    for (;;)
+    {
+        Etui_Smart_Tile_Raster *t;
+        Etui_Smart_Tile_Rect *done;
+        Eina_Bool res;
+
+        etui_module_instance_lock_take(job->instance);
+
+        /* the queue may have been replaced since the previous tile */
+        while ((job->next < job->rects_nbr) &&
+               _etui_smart_tiles_job_done(job, &job->rects[job->next]))
+            job->next++;
+
+        if (ecore_thread_check(thread) || (job->next >= job->rects_nbr))
+        {
+            eina_lock_release(&job->instance->lock);
+            return;
+        }
+
+        t = calloc(1, sizeof(Etui_Smart_Tile_Raster));
+        done = realloc(job->done, (job->done_nbr + 1) * sizeof(Etui_Smart_Tile_Rect));
+        if (!t || !done)
+        {
+            eina_lock_release(&job->instance->lock);
+            free(t);
+            return;
+        }
+
+        t->rect = job->rects[job->next++];
+        job->done = done;
+        job->done[job->done_nbr++] = t->rect;
+
+        t->data = malloc((size_t)t->rect.width * t->rect.height * sizeof(unsigned int));
+        if (t->data)
+            res = job->instance->module->functions->page_raster(job->instance->data,
+                                                                job->page,
+                                                                job->scale,
+                                                                job->rotation,
+                                                                t->data,
+                                                                t->rect.x,
+                                                                t->rect.y,
+                                                                t->rect.width,
+                                                                t->rect.height,
+                                                                &job->cancel);
+        else
+            res = EINA_FALSE;
+        eina_lock_release(&job->instance->lock);
+
+        if (!res)
+        {
+            free(t->data);
+            free(t);
+            continue;
+        }
+
+        ecore_thread_feedback(thread, t);
+    }
+}
+
+static void
+_etui_smart_tiles_notify(void *data, Ecore_Thread *thread, void *msg_data)
+{
+    Etui_Smart_Tiles_Job *job;
+    Etui_Smart_Tile_Raster *t;
+
+    job = data;
+    t = msg_data;
+
+    if (job->sd && !ecore_thread_check(thread))
+    {
+        if (etui_cache_take(job->sd->tiled.cache,
+                            job->page, job->scale, job->rotation,
+                            t->rect.x, t->rect.y,
+                            t->data, t->rect.width, t->rect.height))
+            _etui_smart_tiles_update(job->sd);
+    }
+    else
+        free(t->data);
+    free(t);
+}
+
+static void
+_etui_smart_tiles_end(void *data, Ecore_Thread *thread EINA_UNUSED)
+{
+    Etui_Smart_Tiles_Job *job;
+    Etui_Smart_Data *sd;
+    Eina_Bool queued;
+
+    job = data;
+    sd = job->sd;
+    /* tiles queued after the thread found the queue empty */
+    queued = job->next < job->rects_nbr;
+    _etui_smart_tiles_job_free(job);
+
+    if (sd && queued)
+        _etui_smart_tiles_update(sd);
+}
+
+static void
+_etui_smart_tiles_cancel(Etui_Smart_Data *sd)
+{
+    if (!sd->tiled.thread)
+        return;
+
+    /* the job is freed by the thread end or cancel callback */
+    sd->tiled.job->sd = NULL;
+    sd->tiled.job->cancel.abort = 1;
+    ecore_thread_cancel(sd->tiled.thread);
+    sd->tiled.thread = NULL;
+    sd->tiled.job = NULL;
+}
+
+/* rects is owned by the rendering job */
+static void
+_etui_smart_tiles_queue(Etui_Smart_Data *sd, Etui_Smart_Tile_Rect *rects, int rects_nbr)
+{
+    Etui_Smart_Tiles_Job *job;
+
+    if (sd->tiled.thread)
+    {
+        /* the running job renders the new queue instead of the old one */
+        job = sd->tiled.job;
+        eina_lock_take(&sd->instance->lock);
+        free(job->rects);
+        job->rects = rects;
+        job->rects_nbr = rects_nbr;
+        job->next = 0;
+        eina_lock_release(&sd->instance->lock);
+        return;
+    }
+
+    if (rects_nbr == 0)
+    {
+        free(rects);
+        return;
+    }
+
+    job = calloc(1, sizeof(Etui_Smart_Tiles_Job));
+    if (!job)
+    {
+        free(rects);
+        return;
+    }
+
+    job->sd = sd;
+    job->instance = etui_module_instance_ref(sd->instance);
+    job->page = sd->tiled.page;
+    job->scale = sd->tiled.scale;
+    job->rotation = sd->tiled.rotation;
+    job->rects = rects;
+    job->rects_nbr = rects_nbr;
+
+    sd->tiled.job = job;
+    sd->tiled.thread = ecore_thread_feedback_run(_etui_smart_tiles_run,
+                                                 _etui_smart_tiles_notify,
+                                                 _etui_smart_tiles_end,
+                                                 _etui_smart_tiles_end,
+                                                 job, EINA_FALSE);
+}
+
+static void
+_etui_smart_tiles_clear(Etui_Smart_Data *sd)
+{
+    Etui_Smart_Tile *tile;
+
+    _etui_smart_tiles_cancel(sd);
+    EINA_LIST_FREE(sd->tiled.tiles, tile)
+        _etui_smart_tile_free(sd, tile);
+    sd->tiled.valid = 0;
+}
+
+/*
+ * Called when the page, the scale or the rotation of the module changed.
+ * The tiles of the previous page are released, they stay in the cache.
+ */
+static void
+_etui_smart_tiles_page_set(Etui_Smart_Data *sd, Eina_Bool locked)
+{
+    Etui_Rotation rotation;
+    double scale;
+    int page;
+    Eina_Bool res;
+
+    page = sd->instance->module->functions->page_get(sd->instance->data);
+    scale = sd->instance->module->functions->page_scale_get(sd->instance->data);
+    rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+
+    if (sd->tiled.valid &&
+        (sd->tiled.page == page) &&
+        (sd->tiled.rotation == rotation) &&
+        EINA_DBL_EQ(sd->tiled.scale, scale))
+        return;
+
+    _etui_smart_tiles_clear(sd);
+
+    if (!locked)
+        eina_lock_take(&sd->instance->lock);
+    res = sd->instance->module->functions->page_raster_size(sd->instance->data,
+                                                            page, scale, rotation,
+                                                            &sd->tiled.width,
+                                                            &sd->tiled.height);
+    if (!locked)
+        eina_lock_release(&sd->instance->lock);
+    if (!res || (sd->tiled.width <= 0) || (sd->tiled.height <= 0))
+    {
+        ERR("can not get the size of page %d", page);
+        return;
+    }
+
+    sd->tiled.page = page;
+    sd->tiled.scale = scale;
+    sd->tiled.rotation = rotation;
+    sd->tiled.valid = 1;
+}
+
+/* part of the canvas where the object can be seen */
+static void
+_etui_smart_tiles_viewport_get(const Etui_Smart_Data *sd, Eina_Rectangle *view)
+{
+    Evas_Object *clip;
+    Eina_Rectangle r;
+
+    evas_output_viewport_get(evas_object_evas_get(sd->self),
+                             &view->x, &view->y, &view->w, &view->h);
+
+    for (clip = sd->frame; clip; clip = evas_object_clip_get(clip))
+    {
+        evas_object_geometry_get(clip, &r.x, &r.y, &r.w, &r.h);
+        if (!eina_rectangle_intersection(view, &r))
+        {
+            view->w = 0;
+            view->h = 0;
+            return;
+        }
+    }
+}
+
+static int
+_etui_smart_tile_rect_cmp(const void *p1, const void *p2)
+{
+    return ((const Etui_Smart_Tile_Rect *)p1)->order -
+        ((const Etui_Smart_Tile_Rect *)p2)->order;
+}
+
+/*
+ * Displays the tiles which intersect the viewport and the ones around
+ * them, and queues the rendering of the missing ones, visible tiles
+ * first. The other tiles are released, they stay in the cache.
+ */
+static void
+_etui_smart_tiles_update(Etui_Smart_Data *sd)
+{
+    Eina_Rectangle view;
+    Etui_Smart_Tile_Rect *rects = NULL;
+    Etui_Smart_Tile *tile;
+    Eina_List *l;
+    Eina_List *l_next;
+    unsigned char *shown = NULL;
+    int rects_nbr = 0;
+    int tiles_w;
+    int tiles_h;
+    int vx0, vy0, vx1, vy1; /* visible tiles */
+    int x0, y0, x1, y1; /* visible tiles and their border */
+    int tx;
+    int ty;
+
+    if (!sd->tiled.valid)
+        return;
+
+    tiles_w = (sd->tiled.width + ETUI_TILE_SIZE - 1) / ETUI_TILE_SIZE;
+    tiles_h = (sd->tiled.height + ETUI_TILE_SIZE - 1) / ETUI_TILE_SIZE;
+
+    _etui_smart_tiles_viewport_get(sd, &view);
+    if ((sd->tiled.geometry.w > 0) && (sd->tiled.geometry.h > 0) &&
+        (view.w > 0) && (view.h > 0) &&
+        eina_rectangle_intersection(&view, &sd->tiled.geometry))
+    {
+        double fx;
+        double fy;
+
+        /* from the canvas to the page raster */
+        fx = sd->tiled.width / (double)sd->tiled.geometry.w;
+        fy = sd->tiled.height / (double)sd->tiled.geometry.h;
+
+        vx0 = (int)((view.x - sd->tiled.geometry.x) * fx) / ETUI_TILE_SIZE;
+        vy0 = (int)((view.y - sd->tiled.geometry.y) * fy) / ETUI_TILE_SIZE;
+        vx1 = (int)((view.x + view.w - sd->tiled.geometry.x) * fx - 1) / ETUI_TILE_SIZE;
+        vy1 = (int)((view.y + view.h - sd->tiled.geometry.y) * fy - 1) / ETUI_TILE_SIZE;
+        if (vx0 < 0) vx0 = 0;
+        if (vy0 < 0) vy0 = 0;
+        if (vx1 >= tiles_w) vx1 = tiles_w - 1;
+        if (vy1 >= tiles_h) vy1 = tiles_h - 1;
+
+        x0 = (vx0 > 0) ? vx0 - 1 : 0;
+        y0 = (vy0 > 0) ? vy0 - 1 : 0;
+        x1 = (vx1 < tiles_w - 1) ? vx1 + 1 : tiles_w - 1;
+        y1 = (vy1 < tiles_h - 1) ? vy1 + 1 : tiles_h - 1;
+
+        shown = calloc((x1 - x0 + 1) * (y1 - y0 + 1), sizeof(unsigned char));
+        rects = malloc((x1 - x0 + 1) * (y1 - y0 + 1) * sizeof(Etui_Smart_Tile_Rect));
+        if (!shown || !rects)
+        {
+            free(shown);
+            free(rects);
+            return;
+        }
+    }
+    else
+    {
+        /* the page is not visible, no tile is needed */
+        vx0 = vy0 = x0 = y0 = 0;
+        vx1 = vy1 = x1 = y1 = -1;
+    }
+
+    EINA_LIST_FOREACH_SAFE(sd->tiled.tiles, l, l_next, tile)
+    {
+        tx = tile->entry->x / ETUI_TILE_SIZE;
+        ty = tile->entry->y / ETUI_TILE_SIZE;
+        if ((tx < x0) || (tx > x1) || (ty < y0) || (ty > y1))
+        {
+            sd->tiled.tiles = eina_list_remove_list(sd->tiled.tiles, l);
+            _etui_smart_tile_free(sd, tile);
+            continue;
+        }
+
+        shown[(ty - y0) * (x1 - x0 + 1) + (tx - x0)] = 1;
+        _etui_smart_tile_move(sd, tile);
+    }
+
+    for (ty = y0; ty <= y1; ty++)
+    {
+        for (tx = x0; tx <= x1; tx++)
+        {
+            Etui_Cache_Entry *entry;
+            Etui_Smart_Tile_Rect *r;
+            int dx;
+            int dy;
+
+            if (shown[(ty - y0) * (x1 - x0 + 1) + (tx - x0)])
+                continue;
+
+            entry = etui_cache_find(sd->tiled.cache,
+                                    sd->tiled.page,
+                                    sd->tiled.scale,
+                                    sd->tiled.rotation,
+                                    tx * ETUI_TILE_SIZE,
+                                    ty * ETUI_TILE_SIZE);
+            if (entry)
+            {
+                _etui_smart_tile_add(sd, entry);
+                continue;
+            }
+
+            r = rects + rects_nbr++;
+            r->x = tx * ETUI_TILE_SIZE;
+            r->y = ty * ETUI_TILE_SIZE;
+            r->width = sd->tiled.width - r->x;
+            if (r->width > ETUI_TILE_SIZE) r->width = ETUI_TILE_SIZE;
+            r->height = sd->tiled.height - r->y;
+            if (r->height > ETUI_TILE_SIZE) r->height = ETUI_TILE_SIZE;
+
+            /* twice the distance to the center of the visible tiles */
+            dx = 2 * tx - (vx0 + vx1);
+            dy = 2 * ty - (vy0 + vy1);
+            r->order = dx * dx + dy * dy;
+            if ((tx < vx0) || (tx > vx1) || (ty < vy0) || (ty > vy1))
+                r->order += ETUI_TILE_ORDER_BORDER;
+        }
+    }
+    free(shown);
+
+    if (rects_nbr > 1)
+        qsort(rects, rects_nbr, sizeof(Etui_Smart_Tile_Rect),
+              _etui_smart_tile_rect_cmp);
+
+    _etui_smart_tiles_queue(sd, rects, rects_nbr);
+}
+
+static void
+_etui_smart_page_render(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Render *job;
+
+    job = data;
+
+    /* the page rendered in a previous session is displayed by the end callback */
+    if (job->disk_only)
+    {
+        job->disk = _etui_smart_page_disk_find(job->instance, job->page,
+                                               job->scale, job->rotation);
+        if (job->disk &&
+            (((size_t)job->disk->width * job->disk->height * sizeof(unsigned int)) > job->cache_budget))
+        {
+            free(job->disk->data);
+            free(job->disk);
+            job->disk = NULL;
+        }
+        return;
+    }
+
+    if (job->thumb)
+    {
+        Etui_Smart_Page_Raster *p;
+
+        p = calloc(1, sizeof(Etui_Smart_Page_Raster));
+        if (p)
+        {
+            p->page = job->page;
+            p->data = etui_disk_cache_thumb_find(job->instance->disk_cache,
+                                                 job->page, job->rotation,
+                                                 &p->width, &p->height);
+            if (p->data)
+            {
+                ecore_thread_feedback(thread, p);
+                job->preview_scale = 0.0;
+            }
+            else
+                free(p);
+        }
+    }
+
+    etui_module_instance_lock_take(job->instance);
+    if (job->preview_scale > 0.0)
+    {
+        Etui_Smart_Page_Raster *p;
+
+        p = _etui_smart_page_raster(job->instance,
+                                    job->page,
+                                    job->preview_scale,
+                                    job->rotation,
+                                    &job->instance->cancel);
+        if (p)
+        {
+            /* kept as a thumbnail */
+            etui_disk_cache_add(job->instance->disk_cache, p->page,
+                                job->preview_scale, job->rotation,
+                                p->data, p->width, p->height);
+            ecore_thread_feedback(thread, p);
+        }
+    }
+    job->instance->module->functions->page_render(job->instance->data,
+                                                  &job->instance->cancel);
+    eina_lock_release(&job->instance->lock);
+}
+
+static void
+_etui_smart_page_render_notify(void *data, Ecore_Thread *thread, void *msg_data)
+{
+    Etui_Smart_Render *job;
+    Etui_Smart_Page_Raster *p;
+
+    job = data;
+    p = msg_data;
+
+    if (job->sd && !ecore_thread_check(thread))
+    {
+        DBG("preview of page %d", p->page);
+        _etui_smart_preview_set(job->sd, p->data, p->width, p->height);
+    }
+    free(p->data);
+    free(p);
+}
+
+/* also called when the thread is cancelled, page_render_pre() has been called */
+static void
+_etui_smart_page_render_end(void *data, Ecore_Thread *thread)
+{
+    Etui_Smart_Render *job;
+    Etui_Smart_Data *sd;
+    Etui_Module_Instance *instance;
+    Etui_Smart_Page_Raster *disk;
+    Eina_Bool rendered = EINA_FALSE;
+    int page;
+
+    job = data;
+    sd = job->sd;
+    instance = job->instance;
+    disk = job->disk;
+
+    if (!job->disk_only)
+    {
+        eina_lock_take(&instance->lock);
+        instance->module->functions->page_render_end(instance->data);
+        eina_lock_release(&instance->lock);
+    }
+    if (instance->render == thread)
+        instance->render = NULL;
+
+    if (!sd)
+    {
+        /* the object is deleted, see _etui_smart_del() */
+        instance->module->functions->evas_object_del(instance->data);
+        instance->cancel.abort = 0;
+        etui_module_instance_unref(instance);
+        if (disk)
+        {
+            free(disk->data);
+            free(disk);
+        }
+        free(job);
         return;
+    }
 
-    sd->module->functions->page_render(sd->module->data);
-}
+    sd->render_job = NULL;
+    etui_module_instance_unref(instance);
 
-static void
-_etui_smart_page_render_end(void *data, Ecore_Thread *thread EINA_UNUSED)
-{
-    Etui_Smart_Data *sd;
+    _etui_smart_preview_unset(sd);
+    if (disk)
+    {
+        Etui_Cache_Entry *entry;
+
+        /* the module has not rendered anything, the page is taken as is */
+        DBG("page %d found in disk cache", disk->page);
+        page = disk->page;
+        entry = etui_cache_take(sd->cache, disk->page, job->scale, job->rotation,
+                                0, 0, disk->data, disk->width, disk->height);
+        if (entry && !sd->instance->cancel.abort)
+        {
+            _etui_smart_image_cached_set(sd, entry);
+            rendered = EINA_TRUE;
+        }
+        free(disk);
+    }
+    else if (job->disk_only)
+    {
+        /* not in the disk cache, or not usable, the module renders it */
+        if (!sd->instance->cancel.abort)
+        {
+            sd->disk_skip = 1;
+            sd->update_pending = 1;
+        }
+    }
+    /* a stopped rendering leaves an incomplete image */
+    else if (!sd->instance->cancel.abort)
+    {
+        page = sd->render_key.page;
+        _etui_smart_page_cache_add(sd);
+        rendered = EINA_TRUE;
+    }
+    sd->instance->cancel.abort = 0;
+    free(job);
 
-    sd = data;
-    if (!sd)
-        return;
+    if (sd->pending.timer)
+    {
+        /* the lock is free now */
+        ecore_timer_del(sd->pending.timer);
+        sd->pending.timer = NULL;
+        _etui_smart_pending_apply(sd);
+    }
+    else if (sd->update_pending)
+    {
+        sd->update_pending = 0;
+        _etui_smart_page_update(sd, EINA_FALSE);
+        evas_object_smart_changed(sd->self);
+    }
+    else
+        _etui_smart_prefetch_start(sd);
 
-    sd->module->functions->page_render_end(sd->module->data);
-    sd->module->render = NULL;
     _etui_smart_page_eval(sd);
-}
-
-static void
-_etui_smart_page_render_cancel(void *data EINA_UNUSED, Ecore_Thread *thread EINA_UNUSED)
-{
 
+    /* last, the callback may delete the object */
+    if (rendered)
+        evas_object_smart_callback_call(sd->self, "page,rendered", &page);
 }
+
 #if 0
 static void
 _etui_smart_resize_cb(void *data, Evas *e EINA_UNUSED, Evas_Object *obj, void *event_info EINA_UNUSED)
@@ -340,7 +2546,7 @@ _etui_smart_page_eval(Etui_Smart_Data *sd)
    double scale = 1.0;
 
    evas_object_geometry_get(sd->frame, &x, &y, &w, &h);
-   sd->module->functions->page_size_get(sd->module->data, &ow, &oh);
+   sd->instance->module->functions->page_size_get(sd->instance->data, &ow, &oh);
    switch (sd->mode)
      {
       case ETUI_MODE_FIT_WIDTH:
@@ -371,7 +2577,7 @@ _etui_smart_page_eval(Etui_Smart_Data *sd)
          break;
       default:
       case ETUI_MODE_FREE:
-         scale = sd->module->functions->page_scale_get(sd->module->data);
+         scale = sd->instance->module->functions->page_scale_get(sd->instance->data);
          ow = scale * ow;
          oh = scale * oh;
          break;
@@ -380,9 +2586,17 @@ _etui_smart_page_eval(Etui_Smart_Data *sd)
    oy = ((h - oh) / 2.0) + (double)y + 0.5;
    fprintf(stderr, "EVAL FRAME(%d, %d, %d, %d), OBJ(%d, %d, %d, %d) scaling %f\n",
            x, y, w, h, ox, oy, ow, oh, scale);
-   // sd->module->functions->page_scale_set(sd->module->data, scale);
+   // sd->instance->module->functions->page_scale_set(sd->instance->data, scale);
    evas_object_move(sd->obj, ox, oy);
    evas_object_resize(sd->obj, ow, oh);
+   evas_object_move(sd->preview, ox, oy);
+   evas_object_resize(sd->preview, ow, oh);
+   if (_etui_smart_tiled_is(sd))
+     {
+        EINA_RECTANGLE_SET(&sd->tiled.geometry, ox, oy, ow, oh);
+        _etui_smart_tiles_update(sd);
+     }
+   _etui_smart_highlight_update(sd);
 }
 
 /**
@@ -419,11 +2633,25 @@ etui_object_file_set(Evas_Object *obj, const Etui_File *ef)
     ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
     INF("file set");
 
-    sd->module = (Etui_Module *)etui_file_module_get(ef);
-    sd->obj = sd->module->functions->evas_object_add(sd->module->data,
-                                                     evas_object_evas_get(obj));
+    if (sd->instance)
+    {
+        /* the jobs of the previous file must not reach the new one */
+        _etui_smart_image_detach(sd);
+        _etui_smart_instance_detach(sd);
+    }
+    etui_cache_clear(sd->cache);
+    etui_cache_clear(sd->tiled.cache);
+    _etui_smart_preview_unset(sd);
+
+    /* released by _etui_smart_instance_detach() */
+    sd->instance = etui_module_instance_ref((Etui_Module_Instance *)etui_file_instance_get(ef));
+    etui_module_instance_disk_cache_open(sd->instance, ef);
+    sd->obj = sd->instance->module->functions->evas_object_add(sd->instance->data,
+                                                               evas_object_evas_get(obj));
     evas_object_smart_member_add(sd->obj, obj);
     evas_object_clip_set(sd->obj, sd->frame);
+    /* the preview covers the page while it is rendered */
+    evas_object_raise(sd->preview);
     /*
     evas_object_event_callback_add(sd->obj, EVAS_CALLBACK_RESIZE,
                                    _etui_smart_resize_cb, sd);
@@ -440,7 +2668,7 @@ etui_object_module_name_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->definition->name;
+    return sd->instance->module->definition->name;
 
   _err:
     return NULL;
@@ -453,7 +2681,7 @@ etui_object_info_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->info_get(sd->module->data);
+    return sd->instance->module->functions->info_get(sd->instance->data);
 
   _err:
     return NULL;
@@ -466,7 +2694,7 @@ etui_object_title_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->title_get(sd->module->data);
+    return sd->instance->module->functions->title_get(sd->instance->data);
 
   _err:
     return NULL;
@@ -479,7 +2707,7 @@ etui_object_document_pages_count(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->pages_count(sd->module->data);
+    return sd->instance->module->functions->pages_count(sd->instance->data);
 
   _err:
     return -1;
@@ -492,7 +2720,7 @@ etui_object_toc_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->toc_get(sd->module->data);
+    return sd->instance->module->functions->toc_get(sd->instance->data);
 
   _err:
     return NULL;
@@ -506,11 +2734,16 @@ etui_object_page_set(Evas_Object *obj, int page_num)
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
     INF("page set %d", page_num);
-    if (sd->module->functions->page_set(sd->module->data, page_num))
-    {
-        sd->module->functions->page_render_pre(sd->module->data);
-        evas_object_smart_changed(obj);
-    }
+    if ((page_num < 0) ||
+        (page_num >= sd->instance->module->functions->pages_count(sd->instance->data)) ||
+        (page_num == etui_object_page_get(obj)))
+        return;
+
+    sd->pending.page = page_num;
+    sd->pending.page_set = 1;
+    /* no lock before the threads are stopped, a page turn does not wait */
+    _etui_smart_pending_cancel(sd);
+    _etui_smart_pending_apply(sd);
 
   _err:
     return;
@@ -524,7 +2757,10 @@ etui_object_page_get(Evas_Object *obj)
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
     INF("page get");
 
-    return sd->module->functions->page_get(sd->module->data);
+    if (sd->pending.page_set)
+        return sd->pending.page;
+
+    return sd->instance->module->functions->page_get(sd->instance->data);
 
   _err:
     return -1;
@@ -538,7 +2774,7 @@ etui_object_page_size_get(Evas_Object *obj, int *width, int *height)
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
     INF("page size get");
 
-    sd->module->functions->page_size_get(sd->module->data, width, height);
+    sd->instance->module->functions->page_size_get(sd->instance->data, width, height);
 
     return;
 
@@ -554,11 +2790,13 @@ etui_object_page_rotation_set(Evas_Object *obj, Etui_Rotation rotation)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    if (sd->module->functions->page_rotation_set(sd->module->data, rotation))
-    {
-        sd->module->functions->page_render_pre(sd->module->data);
-        evas_object_smart_changed(obj);
-    }
+    if (rotation == etui_object_page_rotation_get(obj))
+        return;
+
+    sd->pending.rotation = rotation;
+    sd->pending.rotation_set = 1;
+    _etui_smart_pending_cancel(sd);
+    _etui_smart_pending_apply(sd);
 
   _err:
     return;
@@ -571,7 +2809,10 @@ etui_object_page_rotation_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->page_rotation_get(sd->module->data);
+    if (sd->pending.rotation_set)
+        return sd->pending.rotation;
+
+    return sd->instance->module->functions->page_rotation_get(sd->instance->data);
 
   _err:
     return ETUI_ROTATION_0;
@@ -581,34 +2822,17 @@ EAPI void
 etui_object_page_scale_set(Evas_Object *obj, double scale)
 {
     Etui_Smart_Data *sd;
-    Evas_Coord w, h;
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
     fprintf(stderr, " %s 1\n", __FUNCTION__);
-    if (sd->module->functions->page_scale_set(sd->module->data, scale))
-    {
-        sd->module->functions->page_render_pre(sd->module->data);
-        _etui_smart_page_eval(sd);
-        evas_object_geometry_get(sd->obj, NULL, NULL, &w, &h);
-        switch (sd->mode)
-        {
-           case ETUI_MODE_FREE:
-              evas_object_size_hint_min_set(obj, w, h);
-              break;
-           case ETUI_MODE_FIT_WIDTH:
-              evas_object_size_hint_min_set(obj, 0, h);
-              break;
-           case ETUI_MODE_FIT_HEIGHT:
-              evas_object_size_hint_min_set(obj, w, 0);
-              break;
-           case ETUI_MODE_FIT_AUTO:
-           case ETUI_MODE_UNKNOWN:
-              evas_object_size_hint_min_set(obj, 0, 0);
-              break;
-        }
-        evas_object_smart_changed(obj);
-    }
+    if (EINA_DBL_EQ(scale, etui_object_page_scale_get(obj)))
+        return;
+
+    sd->pending.scale = scale;
+    sd->pending.scale_set = 1;
+    _etui_smart_pending_cancel(sd);
+    _etui_smart_pending_apply(sd);
     fprintf(stderr, " %s 2\n", __FUNCTION__);
 
   _err:
@@ -622,7 +2846,10 @@ etui_object_page_scale_get(const Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->page_scale_get(sd->module->data);
+    if (sd->pending.scale_set)
+        return sd->pending.scale;
+
+    return sd->instance->module->functions->page_scale_get(sd->instance->data);
 
   _err:
     return -1.0;
@@ -664,8 +2891,401 @@ etui_object_api_get(Evas_Object *obj)
 
     ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
 
-    return sd->module->functions->api_get(sd->module->data);
+    return sd->instance->module->functions->api_get(sd->instance->data);
+
+  _err:
+    return NULL;
+}
+
+EAPI void
+etui_object_cache_size_set(Evas_Object *obj, size_t size)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    etui_cache_budget_set(sd->cache, size);
+    etui_cache_budget_set(sd->tiled.cache, size);
+
+  _err:
+    return;
+}
+
+EAPI size_t
+etui_object_cache_size_get(const Evas_Object *obj)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    return etui_cache_budget_get(sd->cache);
+
+  _err:
+    return 0;
+}
+
+EAPI void
+etui_object_cache_stats_get(const Evas_Object *obj, unsigned int *hits, unsigned int *misses, size_t *size)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    etui_cache_stats_get(sd->cache, hits, misses, size);
+
+    return;
+
+  _err:
+    if (hits) *hits = 0;
+    if (misses) *misses = 0;
+    if (size) *size = 0;
+}
+
+EAPI void
+etui_object_prefetch_set(Evas_Object *obj, int ahead, int behind)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    if (ahead < 0) ahead = 0;
+    if (behind < 0) behind = 0;
+    if ((sd->prefetch.ahead == ahead) && (sd->prefetch.behind == behind))
+        return;
+
+    sd->prefetch.ahead = ahead;
+    sd->prefetch.behind = behind;
+
+    if (sd->instance)
+    {
+        _etui_smart_prefetch_cancel(sd);
+        if (!sd->instance->render && !sd->render_pending)
+            _etui_smart_prefetch_start(sd);
+    }
+
+  _err:
+    return;
+}
+
+EAPI void
+etui_object_prefetch_get(const Evas_Object *obj, int *ahead, int *behind)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    if (ahead) *ahead = sd->prefetch.ahead;
+    if (behind) *behind = sd->prefetch.behind;
+
+    return;
+
+  _err:
+    if (ahead) *ahead = 0;
+    if (behind) *behind = 0;
+}
+
+EAPI void
+etui_object_tiled_set(Evas_Object *obj, Eina_Bool on)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    on = !!on;
+    if (sd->tiled.enabled == on)
+        return;
+
+    sd->tiled.enabled = on;
+    if (!sd->instance)
+        return;
+
+    if (!on)
+    {
+        _etui_smart_tiles_clear(sd);
+        if (evas_object_visible_get(obj))
+            evas_object_show(sd->obj);
+    }
+
+    _etui_smart_page_update(sd, EINA_FALSE);
+    evas_object_smart_changed(obj);
+
+  _err:
+    return;
+}
+
+EAPI Eina_Bool
+etui_object_tiled_get(const Evas_Object *obj)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    return sd->tiled.enabled;
+
+  _err:
+    return EINA_FALSE;
+}
+
+/*
+ * Searches needle in all the pages, from page_start, in a thread. hit_cb
+ * is called in the main loop for each page with an occurrence, end_cb
+ * when all the pages are searched or when the search is cancelled. A
+ * search in progress is cancelled first.
+ */
+EAPI Eina_Bool
+etui_object_search_run(Evas_Object *obj, const char *needle, int page_start, Etui_Search_Hit_Cb hit_cb, Etui_Search_End_Cb end_cb, const void *data)
+{
+    Etui_Smart_Data *sd;
+    Etui_Smart_Search *job;
+    int count;
+
+    ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
+
+    _etui_smart_search_cancel(sd);
+    _etui_smart_search_hits_clear(sd);
+
+    if (!hit_cb || !sd->instance->module->functions->page_text_get)
+        return EINA_FALSE;
+
+    count = sd->instance->module->functions->pages_count(sd->instance->data);
+    if (count <= 0)
+        return EINA_FALSE;
+
+    job = calloc(1, sizeof(Etui_Smart_Search));
+    if (!job)
+        return EINA_FALSE;
+
+    job->needle = etui_search_needle_new(needle, &job->length);
+    if (!job->needle)
+    {
+        free(job);
+        return EINA_FALSE;
+    }
+
+    /* the index is shared by all the objects displaying the file */
+    eina_lock_take(&sd->instance->lock);
+    if (sd->instance->search_index &&
+        (etui_search_index_pages_count(sd->instance->search_index) != count))
+    {
+        etui_search_index_free(sd->instance->search_index);
+        sd->instance->search_index = NULL;
+    }
+    if (!sd->instance->search_index)
+        sd->instance->search_index = etui_search_index_new(count);
+    eina_lock_release(&sd->instance->lock);
+
+    if (!sd->instance->search_index)
+    {
+        free(job->needle);
+        free(job);
+        return EINA_FALSE;
+    }
+
+    sd->search.hits = eina_hash_int32_new(_etui_smart_search_hit_free);
+
+    job->sd = sd;
+    job->instance = etui_module_instance_ref(sd->instance);
+    job->page_start = ((page_start >= 0) && (page_start < count)) ? page_start : 0;
+    job->pages_nbr = count;
+    job->hit_cb = hit_cb;
+    job->end_cb = end_cb;
+    job->data = data;
+
+    sd->search.job = job;
+    sd->search.thread = ecore_thread_feedback_run(_etui_smart_search_run,
+                                                  _etui_smart_search_notify,
+                                                  _etui_smart_search_end,
+                                                  _etui_smart_search_cancelled,
+                                                  job, EINA_FALSE);
+
+    return EINA_TRUE;
+
+  _err:
+    return EINA_FALSE;
+}
+
+/*
+ * Shows the boxes found by the last search on the displayed page, or
+ * hides them. They are hidden by default.
+ */
+EAPI void
+etui_object_search_highlight_set(Evas_Object *obj, Eina_Bool on)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    if (sd->search.highlight == !!on)
+        return;
+
+    sd->search.highlight = !!on;
+    _etui_smart_highlight_update(sd);
+
+  _err:
+    return;
+}
+
+EAPI Eina_Bool
+etui_object_search_highlight_get(const Evas_Object *obj)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    return sd->search.highlight;
+
+  _err:
+    return EINA_FALSE;
+}
+
+EAPI void
+etui_object_search_cancel(Evas_Object *obj)
+{
+    Etui_Smart_Data *sd;
+
+    ETUI_SMART_OBJ_GET(sd, obj, ETUI_OBJ_NAME);
+
+    _etui_smart_search_cancel(sd);
+
+  _err:
+    return;
+}
+
+/*
+ * Renders all the pages at scale in the disk cache, in a thread, so that
+ * they are displayed at once the next time the document is opened. A
+ * small scale fills it with thumbnails.
+ */
+EAPI Eina_Bool
+etui_object_disk_cache_warm(Evas_Object *obj, double scale)
+{
+    Etui_Smart_Data *sd;
+    Etui_Smart_Warm *job;
+
+    ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
+
+    _etui_smart_warm_cancel(sd);
+
+    if (!sd->instance->disk_cache || (scale <= 0.0))
+        return EINA_FALSE;
+
+    job = calloc(1, sizeof(Etui_Smart_Warm));
+    if (!job)
+        return EINA_FALSE;
+
+    job->sd = sd;
+    job->instance = etui_module_instance_ref(sd->instance);
+    job->scale = scale;
+    job->rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+    job->pages_nbr = sd->instance->module->functions->pages_count(sd->instance->data);
+
+    sd->warm.job = job;
+    sd->warm.thread = ecore_thread_run(_etui_smart_warm_run,
+                                       _etui_smart_warm_end,
+                                       _etui_smart_warm_end,
+                                       job);
+
+    return EINA_TRUE;
+
+  _err:
+    return EINA_FALSE;
+}
+
+/* size of the page rendered at scale, with the rotation of the object */
+EAPI Eina_Bool
+etui_object_page_raster_size_get(Evas_Object *obj, int page_num, double scale, int *width, int *height)
+{
+    Etui_Smart_Data *sd;
+    Eina_Bool res;
+
+    if (width) *width = 0;
+    if (height) *height = 0;
+
+    ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
+
+    if (!sd->instance->module->functions->page_raster_size)
+        return EINA_FALSE;
+
+    eina_lock_take(&sd->instance->lock);
+    res = sd->instance->module->functions->page_raster_size(sd->instance->data,
+                                                            page_num, scale,
+                                                            sd->instance->module->functions->page_rotation_get(sd->instance->data),
+                                                            width, height);
+    eina_lock_release(&sd->instance->lock);
+
+    return res;
+
+  _err:
+    return EINA_FALSE;
+}
+
+/*
+ * Renders any page, without changing the displayed one, so that an
+ * application can show several pages at once. The renderings share the
+ * caches of the object. cb is always called later in the main loop,
+ * unless the returned request is cancelled first, also when the page is
+ * found in the cache. The requests of an object are rendered by one
+ * thread, in their order. NULL is returned on error only.
+ */
+EAPI Etui_Page_Request *
+etui_object_page_request(Evas_Object *obj, int page_num, double scale, Etui_Page_Cb cb, const void *data)
+{
+    Etui_Smart_Data *sd;
+    Etui_Page_Request *req;
+    Etui_Cache_Entry *entry;
+    Etui_Rotation rotation;
+
+    ETUI_SMART_OBJ_GET_ERROR(sd, obj, ETUI_OBJ_NAME);
+
+    if (!cb || (scale <= 0.0) ||
+        !sd->instance->module->functions->page_raster ||
+        !sd->instance->module->functions->page_raster_size)
+        return NULL;
+
+    req = calloc(1, sizeof(Etui_Page_Request));
+    if (!req)
+        return NULL;
+
+    rotation = sd->instance->module->functions->page_rotation_get(sd->instance->data);
+    req->sd = sd;
+    req->page = page_num;
+    req->scale = scale;
+    req->rotation = rotation;
+    req->cb = cb;
+    req->data = data;
+
+    /* the disk cache is read by the worker */
+    entry = etui_cache_find(sd->cache, page_num, scale, rotation, 0, 0);
+    if (entry)
+    {
+        req->job = ecore_job_add(_etui_smart_request_job_cb, req);
+        if (!req->job)
+        {
+            free(req);
+            return NULL;
+        }
+        req->entry = entry;
+        etui_cache_entry_pin(entry);
+    }
+    else if (!_etui_smart_request_queue(sd, req))
+    {
+        free(req);
+        return NULL;
+    }
+
+    sd->requests = eina_list_append(sd->requests, req);
+
+    return req;
 
   _err:
     return NULL;
 }
+
+EAPI void
+etui_object_page_request_cancel(Etui_Page_Request *req)
+{
+    if (!req || !req->sd)
+        return;
+
+    _etui_smart_request_cancel(req);
+}
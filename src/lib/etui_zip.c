@@ -0,0 +1,460 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <zlib.h>
+
+#include <Eina.h>
+
+#include "Etui.h"
+#include "etui_zip.h"
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+/**
+ * @cond LOCAL
+ */
+
+/*
+ * this file is compiled in the modules reading ZIP archives, which do not
+ * see the log domain of the library
+ */
+#define ERR(...) EINA_LOG_ERR(__VA_ARGS__)
+#define INF(...) EINA_LOG_INFO(__VA_ARGS__)
+
+#define ETUI_ZIP_SIG_LOCAL 0x04034b50
+#define ETUI_ZIP_SIG_CENTRAL 0x02014b50
+#define ETUI_ZIP_SIG_EOCD 0x06054b50
+#define ETUI_ZIP_SIG_EOCD64 0x06064b50
+#define ETUI_ZIP_SIG_EOCD64_LOCATOR 0x07064b50
+
+#define ETUI_ZIP_EOCD_SIZE 22
+#define ETUI_ZIP_CENTRAL_SIZE 46
+#define ETUI_ZIP_LOCAL_SIZE 30
+
+/*
+ * deflate can not expand data more than 1032 times, a larger size in the
+ * central directory is a corrupted or malicious one
+ */
+#define ETUI_ZIP_DEFLATE_RATIO_MAX 1032
+
+struct Etui_Zip_s
+{
+    const unsigned char *base;
+    size_t size;
+    Etui_Zip_Entry *entries;
+    unsigned int entries_nbr;
+    Eina_Hash *names;
+};
+
+static inline unsigned int
+_etui_zip_uint32_get(const unsigned char *ptr)
+{
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((unsigned int)ptr[3] << 24);
+}
+
+static inline unsigned short
+_etui_zip_uint16_get(const unsigned char *ptr)
+{
+    return ptr[0] | (ptr[1] << 8);
+}
+
+static inline unsigned long long
+_etui_zip_uint64_get(const unsigned char *ptr)
+{
+    return (unsigned long long)_etui_zip_uint32_get(ptr) |
+        ((unsigned long long)_etui_zip_uint32_get(ptr + 4) << 32);
+}
+
+static const unsigned char *
+_etui_zip_eocd_find(const Etui_Zip *zip)
+{
+    const unsigned char *iter;
+    const unsigned char *last;
+
+    if (zip->size < ETUI_ZIP_EOCD_SIZE)
+        return NULL;
+
+    /* the end of central directory record is followed by a comment */
+    /* of at most 65535 bytes, so search backward from the end */
+    iter = zip->base + zip->size - ETUI_ZIP_EOCD_SIZE;
+    last = (zip->size > (ETUI_ZIP_EOCD_SIZE + 0xffff)) ?
+        zip->base + zip->size - (ETUI_ZIP_EOCD_SIZE + 0xffff) :
+        zip->base;
+
+    while (iter >= last)
+    {
+        if (_etui_zip_uint32_get(iter) == ETUI_ZIP_SIG_EOCD)
+            return iter;
+        if (iter == last)
+            break;
+        iter--;
+    }
+
+    return NULL;
+}
+
+static void
+_etui_zip_entry_zip64_fill(Etui_Zip_Entry *entry,
+                           const unsigned char *extra, size_t extra_len,
+                           Eina_Bool has_size, Eina_Bool has_csize,
+                           Eina_Bool has_offset)
+{
+    while (extra_len >= 4)
+    {
+        unsigned short id;
+        unsigned short len;
+
+        id = _etui_zip_uint16_get(extra);
+        len = _etui_zip_uint16_get(extra + 2);
+        if ((size_t)len + 4 > extra_len)
+            return;
+
+        if (id == 0x0001)
+        {
+            const unsigned char *p = extra + 4;
+            const unsigned char *end = p + len;
+
+            /* the values are only present for the 0xffffffff fields */
+            if (has_size && (p + 8 <= end))
+            {
+                entry->size = (size_t)_etui_zip_uint64_get(p);
+                p += 8;
+            }
+            if (has_csize && (p + 8 <= end))
+            {
+                entry->size_compressed = (size_t)_etui_zip_uint64_get(p);
+                p += 8;
+            }
+            if (has_offset && (p + 8 <= end))
+                entry->offset = (size_t)_etui_zip_uint64_get(p);
+            return;
+        }
+
+        extra += len + 4;
+        extra_len -= len + 4;
+    }
+}
+
+static Eina_Bool
+_etui_zip_central_directory_read(Etui_Zip *zip)
+{
+    const unsigned char *eocd;
+    const unsigned char *iter;
+    const unsigned char *end;
+    unsigned long long entries_nbr;
+    unsigned long long cd_offset;
+    unsigned long long cd_size;
+    unsigned int i;
+
+    eocd = _etui_zip_eocd_find(zip);
+    if (!eocd)
+        return EINA_FALSE;
+
+    entries_nbr = _etui_zip_uint16_get(eocd + 10);
+    cd_size = _etui_zip_uint32_get(eocd + 12);
+    cd_offset = _etui_zip_uint32_get(eocd + 16);
+
+    if ((entries_nbr == 0xffff) ||
+        (cd_size == 0xffffffff) ||
+        (cd_offset == 0xffffffff))
+    {
+        const unsigned char *locator;
+        const unsigned char *eocd64;
+        unsigned long long eocd64_offset;
+
+        /* ZIP64 archive */
+        if ((size_t)(eocd - zip->base) < 20)
+            return EINA_FALSE;
+
+        locator = eocd - 20;
+        if (_etui_zip_uint32_get(locator) != ETUI_ZIP_SIG_EOCD64_LOCATOR)
+            return EINA_FALSE;
+
+        eocd64_offset = _etui_zip_uint64_get(locator + 8);
+        if (eocd64_offset + 56 > zip->size)
+            return EINA_FALSE;
+
+        eocd64 = zip->base + eocd64_offset;
+        if (_etui_zip_uint32_get(eocd64) != ETUI_ZIP_SIG_EOCD64)
+            return EINA_FALSE;
+
+        entries_nbr = _etui_zip_uint64_get(eocd64 + 32);
+        cd_size = _etui_zip_uint64_get(eocd64 + 40);
+        cd_offset = _etui_zip_uint64_get(eocd64 + 48);
+    }
+
+    if ((cd_offset > zip->size) || (cd_size > zip->size - cd_offset))
+        return EINA_FALSE;
+
+    if (entries_nbr > cd_size / ETUI_ZIP_CENTRAL_SIZE)
+        return EINA_FALSE;
+
+    zip->entries = (Etui_Zip_Entry *)calloc(entries_nbr ? entries_nbr : 1,
+                                            sizeof(Etui_Zip_Entry));
+    if (!zip->entries)
+        return EINA_FALSE;
+
+    iter = zip->base + cd_offset;
+    end = iter + cd_size;
+    for (i = 0; i < entries_nbr; i++)
+    {
+        Etui_Zip_Entry *entry;
+        unsigned short name_len;
+        unsigned short extra_len;
+        unsigned short comment_len;
+        unsigned short flags;
+
+        if ((iter + ETUI_ZIP_CENTRAL_SIZE > end) ||
+            (_etui_zip_uint32_get(iter) != ETUI_ZIP_SIG_CENTRAL))
+            return EINA_FALSE;
+
+        flags = _etui_zip_uint16_get(iter + 8);
+        name_len = _etui_zip_uint16_get(iter + 28);
+        extra_len = _etui_zip_uint16_get(iter + 30);
+        comment_len = _etui_zip_uint16_get(iter + 32);
+
+        if (iter + ETUI_ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len > end)
+            return EINA_FALSE;
+
+        entry = zip->entries + i;
+        entry->method = _etui_zip_uint16_get(iter + 10);
+        entry->size_compressed = _etui_zip_uint32_get(iter + 20);
+        entry->size = _etui_zip_uint32_get(iter + 24);
+        entry->offset = _etui_zip_uint32_get(iter + 42);
+        entry->is_encrypted = !!(flags & 1);
+
+        if ((entry->size == 0xffffffff) ||
+            (entry->size_compressed == 0xffffffff) ||
+            (entry->offset == 0xffffffff))
+            _etui_zip_entry_zip64_fill(entry,
+                                       iter + ETUI_ZIP_CENTRAL_SIZE + name_len,
+                                       extra_len,
+                                       entry->size == 0xffffffff,
+                                       entry->size_compressed == 0xffffffff,
+                                       entry->offset == 0xffffffff);
+
+        entry->name = (char *)malloc(name_len + 1);
+        if (!entry->name)
+            return EINA_FALSE;
+        memcpy(entry->name, iter + ETUI_ZIP_CENTRAL_SIZE, name_len);
+        entry->name[name_len] = '\0';
+        entry->is_dir = (name_len > 0) && (entry->name[name_len - 1] == '/');
+
+        zip->entries_nbr++;
+        eina_hash_add(zip->names, entry->name, entry);
+
+        iter += ETUI_ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+    }
+
+    return EINA_TRUE;
+}
+
+/**
+ * @endcond
+ */
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+Etui_Zip *
+etui_zip_new(const void *base, size_t size)
+{
+    Etui_Zip *zip;
+
+    if (!base || (size < ETUI_ZIP_LOCAL_SIZE) ||
+        (_etui_zip_uint32_get(base) != ETUI_ZIP_SIG_LOCAL))
+        return NULL;
+
+    zip = (Etui_Zip *)calloc(1, sizeof(Etui_Zip));
+    if (!zip)
+        return NULL;
+
+    zip->base = (const unsigned char *)base;
+    zip->size = size;
+    zip->names = eina_hash_string_superfast_new(NULL);
+    if (!zip->names)
+        goto free_zip;
+
+    if (!_etui_zip_central_directory_read(zip))
+    {
+        INF("Can not read the ZIP central directory");
+        etui_zip_free(zip);
+        return NULL;
+    }
+
+    return zip;
+
+  free_zip:
+    free(zip);
+
+    return NULL;
+}
+
+void
+etui_zip_free(Etui_Zip *zip)
+{
+    unsigned int i;
+
+    if (!zip)
+        return;
+
+    for (i = 0; i < zip->entries_nbr; i++)
+        free(zip->entries[i].name);
+    free(zip->entries);
+    eina_hash_free(zip->names);
+    free(zip);
+}
+
+unsigned int
+etui_zip_entries_count(const Etui_Zip *zip)
+{
+    return zip ? zip->entries_nbr : 0;
+}
+
+const Etui_Zip_Entry *
+etui_zip_entry_get(const Etui_Zip *zip, unsigned int idx)
+{
+    if (!zip || (idx >= zip->entries_nbr))
+        return NULL;
+
+    return zip->entries + idx;
+}
+
+const Etui_Zip_Entry *
+etui_zip_entry_find(const Etui_Zip *zip, const char *name)
+{
+    if (!zip || !name)
+        return NULL;
+
+    return eina_hash_find(zip->names, name);
+}
+
+/*
+ * only the stored and deflated entries can be read, the other methods
+ * (bzip2, LZMA, ...) need another decoder, like libarchive
+ */
+Eina_Bool
+etui_zip_entry_readable(const Etui_Zip_Entry *entry)
+{
+    if (!entry || entry->is_dir || entry->is_encrypted)
+        return EINA_FALSE;
+
+    return (entry->method == 0) || (entry->method == 8);
+}
+
+void *
+etui_zip_entry_data_get(const Etui_Zip *zip, const Etui_Zip_Entry *entry, size_t *size)
+{
+    const unsigned char *local;
+    const unsigned char *src;
+    unsigned char *data;
+    size_t offset;
+
+    if (size) *size = 0;
+
+    if (!zip || !etui_zip_entry_readable(entry))
+    {
+        if (entry && !entry->is_dir)
+            INF("ZIP compression method %d not supported for %s",
+                entry->method, entry->name);
+        return NULL;
+    }
+
+    if (entry->offset > zip->size - ETUI_ZIP_LOCAL_SIZE)
+        return NULL;
+
+    local = zip->base + entry->offset;
+    if (_etui_zip_uint32_get(local) != ETUI_ZIP_SIG_LOCAL)
+        return NULL;
+
+    /* the extra field of the local header may differ from the central one */
+    offset = entry->offset + ETUI_ZIP_LOCAL_SIZE +
+        _etui_zip_uint16_get(local + 26) +
+        _etui_zip_uint16_get(local + 28);
+    if ((offset > zip->size) ||
+        (entry->size_compressed > zip->size - offset))
+        return NULL;
+
+    src = zip->base + offset;
+
+    /* the size is not trusted before the allocation */
+    if (((entry->method == 0) && (entry->size != entry->size_compressed)) ||
+        ((entry->method == 8) &&
+         (entry->size / ETUI_ZIP_DEFLATE_RATIO_MAX > entry->size_compressed)))
+    {
+        ERR("Size of ZIP entry %s too large for its compressed size", entry->name);
+        return NULL;
+    }
+
+    /* + 1 so that an empty entry is not a NULL allocation */
+    data = (unsigned char *)malloc(entry->size + 1);
+    if (!data)
+        return NULL;
+
+    switch (entry->method)
+    {
+        case 0:
+            memcpy(data, src, entry->size);
+            break;
+        case 8:
+        {
+            z_stream stream;
+            int ret;
+
+            memset(&stream, 0, sizeof(z_stream));
+            /* raw deflate data, no zlib header */
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+                goto free_data;
+
+            stream.next_in = (Bytef *)src;
+            stream.avail_in = (uInt)entry->size_compressed;
+            stream.next_out = data;
+            stream.avail_out = (uInt)entry->size;
+            ret = inflate(&stream, Z_FINISH);
+            inflateEnd(&stream);
+            if ((ret != Z_STREAM_END) || (stream.total_out != entry->size))
+            {
+                ERR("Can not inflate ZIP entry %s", entry->name);
+                goto free_data;
+            }
+            break;
+        }
+    }
+
+    if (size) *size = entry->size;
+
+    return data;
+
+  free_data:
+    free(data);
+
+    return NULL;
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
@@ -0,0 +1,45 @@
+/* Etui - Multi-document rendering library using the EFL
+ * Copyright (C) 2013-2017 Vincent Torri
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ETUI_ZIP_H
+#define ETUI_ZIP_H
+
+
+typedef struct Etui_Zip_s Etui_Zip;
+typedef struct Etui_Zip_Entry_s Etui_Zip_Entry;
+
+struct Etui_Zip_Entry_s
+{
+    char *name;
+    size_t offset; /* offset of the local file header */
+    size_t size_compressed;
+    size_t size;
+    unsigned short method; /* 0: stored, 8: deflated */
+    unsigned int is_dir : 1;
+    unsigned int is_encrypted : 1;
+};
+
+Etui_Zip *etui_zip_new(const void *base, size_t size);
+void etui_zip_free(Etui_Zip *zip);
+unsigned int etui_zip_entries_count(const Etui_Zip *zip);
+const Etui_Zip_Entry *etui_zip_entry_get(const Etui_Zip *zip, unsigned int idx);
+const Etui_Zip_Entry *etui_zip_entry_find(const Etui_Zip *zip, const char *name);
+Eina_Bool etui_zip_entry_readable(const Etui_Zip_Entry *entry);
+void *etui_zip_entry_data_get(const Etui_Zip *zip, const Etui_Zip_Entry *entry, size_t *size);
+
+
+#endif /* ETUI_ZIP_H */
@@ -22,7 +22,9 @@ etui_modules_cb_LTLIBRARIES = src/modules/cb/module.la
 
 src_modules_cb_module_la_SOURCES = \
 src/modules/cb/etui_module_cb.c \
-src/modules/cb/etui_module_cb.h
+src/modules/cb/etui_module_cb.h \
+src/lib/etui_zip.c \
+src/lib/etui_zip.h
 
 src_modules_cb_module_la_CPPFLAGS = \
 -I$(top_srcdir)/src/lib \
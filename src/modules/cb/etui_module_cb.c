@@ -17,6 +17,7 @@
 
 #include <config.h>
 
+#include <stdlib.h> /* qsort() */
 #include <strings.h> /* strcasecmp() */
 
 #include <Eina.h>
@@ -31,6 +32,7 @@
 #include "Etui.h"
 #include "etui_module.h"
 #include "etui_file.h"
+#include "etui_zip.h"
 #include "etui_module_cb.h"
 
 /*============================================================================*
@@ -71,6 +73,27 @@
 #endif
 #define CRIT(...) EINA_LOG_DOM_CRIT(_etui_module_cb_log_domain, __VA_ARGS__)
 
+/*
+ * pages at most that far from the read one are kept when the decoder goes
+ * through them, a solid archive is decoded from its beginning to go back
+ */
+#define ETUI_CB_ARCHIVE_STASH_PAGES 4
+
+typedef struct
+{
+    int page; /* -1 if the slot is free */
+    unsigned char *data;
+    size_t size;
+} Etui_Cb_Stash;
+
+typedef struct
+{
+    char *name;
+    const Etui_Zip_Entry *zip_entry; /* NULL if the entry is read by libarchive */
+    unsigned int ordinal; /* position of the entry in the archive */
+    size_t size;
+} Etui_Cb_Entry;
+
 typedef struct
 {
     /* specific EFL stuff for the module */
@@ -93,8 +116,22 @@ typedef struct
         Eina_File *file;
         const void *data;
         size_t size;
+        Etui_Cb_Entry *entries; /* sorted by name, one per page */
+        Etui_Zip *zip;
     } doc;
 
+#ifdef HAVE_LIBARCHIVE
+    /* libarchive decoder kept between pages, for RAR, 7z and tar */
+    struct
+    {
+        struct archive *a;
+        unsigned int next; /* ordinal of the next header to be read */
+        int *pages; /* page of each ordinal, -1 if it is not a page */
+        unsigned int ordinals_nbr;
+        Etui_Cb_Stash stash[2 * ETUI_CB_ARCHIVE_STASH_PAGES];
+    } archive;
+#endif
+
     /* Current page */
     struct
     {
@@ -112,28 +149,165 @@ static int _etui_module_cb_log_domain = -1;
 static int
 _etui_cb_sort_cb(const void *d1, const void *d2)
 {
-    return strcasecmp((const char *)d1, (const char *)d2);
+    return strcasecmp(((const Etui_Cb_Entry *)d1)->name,
+                      ((const Etui_Cb_Entry *)d2)->name);
 }
 
 static Eina_Bool
-_etui_cb_is_valid(Etui_Module_Data *md)
+_etui_cb_entry_add(Etui_Module_Data *md, const char *name,
+                   const Etui_Zip_Entry *zip_entry,
+                   unsigned int ordinal, size_t size)
+{
+    Etui_Cb_Entry *entry;
+
+    if ((md->doc.page_nbr % 64) == 0)
+    {
+        Etui_Cb_Entry *tmp;
+
+        tmp = (Etui_Cb_Entry *)realloc(md->doc.entries,
+                                       (md->doc.page_nbr + 64) * sizeof(Etui_Cb_Entry));
+        if (!tmp)
+            return EINA_FALSE;
+        md->doc.entries = tmp;
+    }
+
+    entry = md->doc.entries + md->doc.page_nbr;
+    entry->name = strdup(name);
+    if (!entry->name)
+        return EINA_FALSE;
+
+    entry->zip_entry = zip_entry;
+    entry->ordinal = ordinal;
+    entry->size = size;
+    md->doc.page_nbr++;
+
+    return EINA_TRUE;
+}
+
+static void
+_etui_cb_entries_free(Etui_Module_Data *md)
+{
+    int i;
+
+    for (i = 0; i < md->doc.page_nbr; i++)
+        free(md->doc.entries[i].name);
+    free(md->doc.entries);
+    md->doc.entries = NULL;
+    md->doc.page_nbr = 0;
+}
+
+#ifdef HAVE_LIBARCHIVE
+static int
+_etui_cb_offset_sort_cb(const void *d1, const void *d2)
 {
+    size_t o1 = *(const size_t *)d1;
+    size_t o2 = *(const size_t *)d2;
+
+    return (o1 > o2) - (o1 < o2);
+}
+
+/*
+ * libarchive reads the entries of a ZIP file in the order of their data,
+ * the ordinal of an entry is the number of sorted offsets before its own
+ */
+static unsigned int
+_etui_cb_zip_archive_ordinal(const size_t *offsets, unsigned int count, size_t offset)
+{
+    unsigned int first = 0;
+
+    while (count > 0)
+    {
+        unsigned int half = count / 2;
+
+        if (offsets[first + half] < offset)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+            count = half;
+    }
+
+    return first;
+}
+#endif
+
+static Eina_Bool
+_etui_cb_index_zip(Etui_Module_Data *md)
+{
+#ifdef HAVE_LIBARCHIVE
+    size_t *offsets = NULL;
+#endif
+    unsigned int count;
+    unsigned int i;
     Eina_Bool res = EINA_FALSE;
+
+    md->doc.zip = etui_zip_new(md->doc.data, md->doc.size);
+    if (!md->doc.zip)
+        return EINA_FALSE;
+
+    md->doc.cb_type = ETUI_CB_CBZ;
+
+    count = etui_zip_entries_count(md->doc.zip);
+    for (i = 0; i < count; i++)
+    {
+        const Etui_Zip_Entry *ze;
+
+        ze = etui_zip_entry_get(md->doc.zip, i);
+        if (ze->is_dir || ze->is_encrypted)
+            continue;
+
+        if (!etui_zip_entry_readable(ze))
+        {
 #ifdef HAVE_LIBARCHIVE
-    struct archive *a;
-    struct archive_entry *entry;
-    char *file_name;
-    Eina_List *list = NULL;
-    Eina_List *l;
-    int r;
+            unsigned int j;
 
-    /* md is valid */
+            /* sorted once, at the first entry needing them */
+            if (!offsets)
+            {
+                offsets = (size_t *)malloc(count * sizeof(size_t));
+                if (!offsets)
+                    goto free_offsets;
+                for (j = 0; j < count; j++)
+                    offsets[j] = etui_zip_entry_get(md->doc.zip, j)->offset;
+                qsort(offsets, count, sizeof(size_t), _etui_cb_offset_sort_cb);
+            }
 
-    /* cbz, cbr, cb7, cbt */
+            /* bzip2, LZMA, ... */
+            if (!_etui_cb_entry_add(md, ze->name, NULL,
+                                    _etui_cb_zip_archive_ordinal(offsets, count, ze->offset),
+                                    ze->size))
+                goto free_offsets;
+#else
+            INF("ZIP compression method %d not supported for %s",
+                ze->method, ze->name);
+#endif
+            continue;
+        }
+
+        if (!_etui_cb_entry_add(md, ze->name, ze, i, ze->size))
+            goto free_offsets;
+    }
+
+    res = EINA_TRUE;
+
+  free_offsets:
+#ifdef HAVE_LIBARCHIVE
+    free(offsets);
+#endif
+
+    return res;
+}
+
+#ifdef HAVE_LIBARCHIVE
+static struct archive *
+_etui_cb_archive_open(Etui_Module_Data *md)
+{
+    struct archive *a;
 
     a = archive_read_new();
     if (!a)
-        return EINA_FALSE;
+        return NULL;
 
     if (archive_read_support_filter_all(a) != ARCHIVE_OK)
         goto free_archive;
@@ -150,11 +324,38 @@ _etui_cb_is_valid(Etui_Module_Data *md)
     if (archive_read_support_format_tar(a) != ARCHIVE_OK)
         goto free_archive;
 
-    r = archive_read_open_memory(a, (void *)md->doc.data, md->doc.size);
-    if (r != ARCHIVE_OK)
+    if (archive_read_open_memory(a, (void *)md->doc.data, md->doc.size) != ARCHIVE_OK)
         goto free_archive;
 
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+    return a;
+
+  free_archive:
+    archive_read_free(a);
+
+    return NULL;
+}
+
+static void
+_etui_cb_archive_close(Etui_Module_Data *md)
+{
+    if (md->archive.a)
+        archive_read_free(md->archive.a);
+    md->archive.a = NULL;
+    md->archive.next = 0;
+}
+
+static Eina_Bool
+_etui_cb_index_archive(Etui_Module_Data *md)
+{
+    struct archive *a;
+    struct archive_entry *entry;
+    unsigned int ordinal;
+
+    a = _etui_cb_archive_open(md);
+    if (!a)
+        return EINA_FALSE;
+
+    for (ordinal = 0; archive_read_next_header(a, &entry) == ARCHIVE_OK; ordinal++)
     {
         if (archive_format(a) == ARCHIVE_FORMAT_ZIP)
             md->doc.cb_type = ETUI_CB_CBZ;
@@ -165,38 +366,315 @@ _etui_cb_is_valid(Etui_Module_Data *md)
         else if ((archive_format(a) & ARCHIVE_FORMAT_TAR) == ARCHIVE_FORMAT_TAR)
             md->doc.cb_type = ETUI_CB_CBT;
         else
-            goto skip;
+            continue;
 
         if (archive_entry_filetype(entry) == AE_IFREG)
         {
-            file_name = strdup(archive_entry_pathname(entry));
-            if (file_name)
-                list = eina_list_append(list, file_name);
+            size_t size;
+
+            size = archive_entry_size_is_set(entry) ?
+                (size_t)archive_entry_size(entry) : 0;
+            if (!_etui_cb_entry_add(md, archive_entry_pathname(entry),
+                                    NULL, ordinal, size))
+            {
+                archive_read_free(a);
+                return EINA_FALSE;
+            }
         }
 
-      skip:
-        archive_read_data_skip(a);
+        /* only the headers are needed, the data is skipped */
     }
 
     archive_read_free(a);
 
-    eina_array_step_set(&md->doc.toc, sizeof(Eina_Array), 4);
-    list = eina_list_sort(list, eina_list_count(list), _etui_cb_sort_cb);
-    EINA_LIST_FOREACH(list, l, file_name)
-        eina_array_push(&md->doc.toc, file_name);
-    eina_list_free(list);
+    return EINA_TRUE;
+}
+
+/* page of each ordinal, for the pages read by libarchive */
+static Eina_Bool
+_etui_cb_archive_pages_set(Etui_Module_Data *md)
+{
+    unsigned int i;
+    int page;
+
+    md->archive.ordinals_nbr = 0;
+    for (page = 0; page < md->doc.page_nbr; page++)
+    {
+        if (!md->doc.entries[page].zip_entry &&
+            (md->doc.entries[page].ordinal >= md->archive.ordinals_nbr))
+            md->archive.ordinals_nbr = md->doc.entries[page].ordinal + 1;
+    }
+
+    for (i = 0; i < 2 * ETUI_CB_ARCHIVE_STASH_PAGES; i++)
+        md->archive.stash[i].page = -1;
+
+    if (md->archive.ordinals_nbr == 0)
+        return EINA_TRUE;
+
+    md->archive.pages = (int *)malloc(md->archive.ordinals_nbr * sizeof(int));
+    if (!md->archive.pages)
+        return EINA_FALSE;
+
+    for (i = 0; i < md->archive.ordinals_nbr; i++)
+        md->archive.pages[i] = -1;
+    for (page = 0; page < md->doc.page_nbr; page++)
+    {
+        if (!md->doc.entries[page].zip_entry)
+            md->archive.pages[md->doc.entries[page].ordinal] = page;
+    }
 
     return EINA_TRUE;
+}
 
-  free_archive:
-    archive_read_free(a);
+static void
+_etui_cb_archive_stash_free(Etui_Module_Data *md)
+{
+    unsigned int i;
+
+    for (i = 0; i < 2 * ETUI_CB_ARCHIVE_STASH_PAGES; i++)
+    {
+        free(md->archive.stash[i].data);
+        md->archive.stash[i].data = NULL;
+        md->archive.stash[i].page = -1;
+    }
+    free(md->archive.pages);
+    md->archive.pages = NULL;
+    md->archive.ordinals_nbr = 0;
+}
+
+/* reads the data of the current entry of the decoder */
+static unsigned char *
+_etui_cb_archive_entry_read(Etui_Module_Data *md, const Etui_Cb_Entry *e, size_t *size)
+{
+    unsigned char *data;
+    size_t alloc;
+    size_t len;
+
+    /* the size may be unknown in the headers (streamed archives) */
+    alloc = e->size ? e->size : 65536;
+    data = (unsigned char *)malloc(alloc);
+    if (!data)
+        return NULL;
+
+    len = 0;
+    while (1)
+    {
+        ssize_t res;
+
+        if (len == alloc)
+        {
+            unsigned char *tmp;
+
+            tmp = (unsigned char *)realloc(data, alloc * 2);
+            if (!tmp)
+                goto free_data;
+            data = tmp;
+            alloc *= 2;
+        }
+
+        res = archive_read_data(md->archive.a, data + len, alloc - len);
+        if (res == 0)
+            break;
+        if (res < 0)
+        {
+            ERR("Can not read Comic Book entry %s", e->name);
+            goto free_data;
+        }
+        len += res;
+    }
+
+    *size = len;
+
+    return data;
+
+  free_data:
+    free(data);
+
+    return NULL;
+}
+
+/*
+ * keeps the page decoded on the way to page_num, in place of the page
+ * the farthest from page_num if there is no free slot
+ */
+static void
+_etui_cb_archive_stash_add(Etui_Module_Data *md, int page, int page_num)
+{
+    Etui_Cb_Stash *slot = NULL;
+    unsigned int i;
+    int dist;
+
+    dist = abs(page - page_num);
+    if (dist > ETUI_CB_ARCHIVE_STASH_PAGES)
+        return;
+
+    for (i = 0; i < 2 * ETUI_CB_ARCHIVE_STASH_PAGES; i++)
+    {
+        Etui_Cb_Stash *st = md->archive.stash + i;
+
+        if (st->page < 0)
+        {
+            slot = st;
+            break;
+        }
+        if (abs(st->page - page_num) > dist)
+        {
+            dist = abs(st->page - page_num);
+            slot = st;
+        }
+    }
+
+    if (!slot)
+        return;
+
+    free(slot->data);
+    slot->page = -1;
+    slot->data = _etui_cb_archive_entry_read(md, md->doc.entries + page,
+                                             &slot->size);
+    if (slot->data)
+        slot->page = page;
+}
+
+/*
+ * Move the persistent decoder to the entry of page_num and read it.
+ * Going forward reuses the decoder state, which matters for solid
+ * RAR and 7z archives where each entry depends on the previous ones.
+ * The archive is only reopened when going backward, and the pages
+ * around page_num which are decoded on the way are kept, as the order
+ * of the archive may not be the order of the pages.
+ */
+static void *
+_etui_cb_archive_data_get(Etui_Module_Data *md, int page_num, size_t *size)
+{
+    struct archive_entry *entry;
+    const Etui_Cb_Entry *e;
+    unsigned char *data;
+    unsigned int i;
+
+    for (i = 0; i < 2 * ETUI_CB_ARCHIVE_STASH_PAGES; i++)
+    {
+        Etui_Cb_Stash *st = md->archive.stash + i;
+
+        if (st->page == page_num)
+        {
+            /* the caller frees the data */
+            data = st->data;
+            *size = st->size;
+            st->data = NULL;
+            st->page = -1;
+            return data;
+        }
+    }
+
+    e = md->doc.entries + page_num;
+    if (md->archive.a && (e->ordinal < md->archive.next))
+        _etui_cb_archive_close(md);
+
+    if (!md->archive.a)
+    {
+        md->archive.a = _etui_cb_archive_open(md);
+        if (!md->archive.a)
+            return NULL;
+        md->archive.next = 0;
+    }
+
+    while (md->archive.next <= e->ordinal)
+    {
+        unsigned int ordinal;
+
+        if (archive_read_next_header(md->archive.a, &entry) != ARCHIVE_OK)
+        {
+            _etui_cb_archive_close(md);
+            return NULL;
+        }
+        ordinal = md->archive.next++;
+
+        if ((ordinal < e->ordinal) && (ordinal < md->archive.ordinals_nbr) &&
+            (md->archive.pages[ordinal] >= 0))
+            _etui_cb_archive_stash_add(md, md->archive.pages[ordinal], page_num);
+    }
+
+    data = _etui_cb_archive_entry_read(md, e, size);
+    if (!data)
+        _etui_cb_archive_close(md);
+
+    return data;
+}
 #endif /* HAVE_LIBARCHIVE */
 
-    /* cba */
+static void *
+_etui_cb_entry_data_get(Etui_Module_Data *md, int page_num, size_t *size)
+{
+    const Etui_Cb_Entry *e;
 
-    INF("ACE Comic Books not supported yet.");
+    e = md->doc.entries + page_num;
+    if (e->zip_entry)
+        return etui_zip_entry_data_get(md->doc.zip, e->zip_entry, size);
 
-    return res;
+#ifdef HAVE_LIBARCHIVE
+    return _etui_cb_archive_data_get(md, page_num, size);
+#else
+    return NULL;
+#endif
+}
+
+static Eina_Bool
+_etui_cb_is_valid(Etui_Module_Data *md)
+{
+    Eina_Bool res;
+    int i;
+
+    /* md is valid */
+
+    /* cbz: read the central directory directly from the mapped file */
+
+    res = _etui_cb_index_zip(md);
+
+    /* cbr, cb7, cbt, and zip files with an unreadable central directory */
+
+#ifdef HAVE_LIBARCHIVE
+    if (!res)
+    {
+        _etui_cb_entries_free(md);
+        etui_zip_free(md->doc.zip);
+        md->doc.zip = NULL;
+
+        res = _etui_cb_index_archive(md);
+    }
+#endif /* HAVE_LIBARCHIVE */
+
+    if (!res)
+    {
+        /* cba */
+
+        INF("ACE Comic Books not supported yet.");
+
+        _etui_cb_entries_free(md);
+        etui_zip_free(md->doc.zip);
+        md->doc.zip = NULL;
+        return EINA_FALSE;
+    }
+
+    /* the index is sorted once, page numbers are indices in it */
+    if (md->doc.page_nbr > 0)
+        qsort(md->doc.entries, md->doc.page_nbr, sizeof(Etui_Cb_Entry),
+              _etui_cb_sort_cb);
+
+#ifdef HAVE_LIBARCHIVE
+    if (!_etui_cb_archive_pages_set(md))
+    {
+        _etui_cb_entries_free(md);
+        etui_zip_free(md->doc.zip);
+        md->doc.zip = NULL;
+        return EINA_FALSE;
+    }
+#endif /* HAVE_LIBARCHIVE */
+
+    eina_array_step_set(&md->doc.toc, sizeof(Eina_Array), 4);
+    for (i = 0; i < md->doc.page_nbr; i++)
+        eina_array_push(&md->doc.toc, md->doc.entries[i].name);
+
+    return EINA_TRUE;
 }
 
 /* Virtual functions */
@@ -214,6 +692,11 @@ _etui_cb_init(const Etui_File *ef)
 
     md->doc.data = etui_file_base_get(ef);
     md->doc.size = etui_file_size_get(ef);
+    if (!md->doc.data)
+    {
+        ERR("Can not map Comic Book archive %s", etui_file_filename_get(ef));
+        goto free_md;
+    }
 
     if (!_etui_cb_is_valid(md))
     {
@@ -225,16 +708,22 @@ _etui_cb_init(const Etui_File *ef)
     if (!md->doc.info)
     {
         ERR("Could not allocate memory for information structure");
-        goto free_md;
+        goto free_entries;
     }
 
-    md->doc.page_nbr = eina_array_count(&md->doc.toc);
     md->page.page_num = -1;
     md->page.rotation = ETUI_ROTATION_0;
     md->page.scale = 1.0f;
 
     return md;
 
+  free_entries:
+    eina_array_flush(&md->doc.toc);
+    _etui_cb_entries_free(md);
+    etui_zip_free(md->doc.zip);
+#ifdef HAVE_LIBARCHIVE
+    _etui_cb_archive_stash_free(md);
+#endif
   free_md:
     free(md);
 
@@ -259,18 +748,15 @@ _etui_cb_shutdown(void *d)
         case ETUI_CB_CBR:
         case ETUI_CB_CB7:
         case ETUI_CB_CBT:
-        {
-            char *file_name;
-            Eina_Array_Iterator iterator;
-            unsigned int i;
-
-            EINA_ARRAY_ITER_NEXT(&md->doc.toc, i, file_name, iterator)
-            {
-                free(file_name);
-            }
+            /* the toc only references the names of the entries */
             eina_array_flush(&md->doc.toc);
+            _etui_cb_entries_free(md);
+            etui_zip_free(md->doc.zip);
+#ifdef HAVE_LIBARCHIVE
+            _etui_cb_archive_close(md);
+            _etui_cb_archive_stash_free(md);
+#endif
             break;
-        }
         case ETUI_CB_CBA:
             break;
         default:
@@ -489,69 +975,25 @@ _etui_cb_page_render_pre(void *d)
         case ETUI_CB_CB7:
         case ETUI_CB_CBT:
         {
-#ifdef HAVE_LIBARCHIVE
-            struct archive *a;
-            struct archive_entry *entry;
-            char *file_name;
-            void *data = NULL;
+            void *data;
             size_t size = 0;
-            int r;
+            int width;
+            int height;
 
-            a = archive_read_new();
-            if (!a)
-                break;
-
-            if (archive_read_support_filter_all(a) != ARCHIVE_OK)
-                goto free_archive;
-
-            if (archive_read_support_format_zip(a) != ARCHIVE_OK)
-                goto free_archive;
-
-            if (archive_read_support_format_rar(a) != ARCHIVE_OK)
-                goto free_archive;
-
-            if (archive_read_support_format_7zip(a) != ARCHIVE_OK)
-                goto free_archive;
-
-            if (archive_read_support_format_tar(a) != ARCHIVE_OK)
-                goto free_archive;
-
-            r = archive_read_open_memory(a, (void *)md->doc.data, md->doc.size);
-            if (r != ARCHIVE_OK)
-                goto free_archive;
-
-            file_name = eina_array_data_get(&md->doc.toc, md->page.page_num);
-
-            while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+            data = _etui_cb_entry_data_get(md, md->page.page_num, &size);
+            if (!data)
             {
-                if (archive_entry_filetype(entry) == AE_IFREG)
-                {
-                    if (strcasecmp(file_name, archive_entry_pathname(entry)) == 0)
-                    {
-                        ssize_t res;
-
-                        size = archive_entry_size(entry);
-                        data = malloc(size);
-                        if (!data)
-                            goto free_archive;
-
-                        res = archive_read_data(a, data, size);
-                        if ((res != ARCHIVE_OK) && (res != ARCHIVE_WARN))
-                            break;
-                    }
-                }
-
-                archive_read_data_skip(a);
+                ERR("Can not extract page %d from the Comic Book archive",
+                    md->page.page_num);
+                break;
             }
 
-            archive_read_free(a);
-
-            if (!data)
-                break;
+            /* the image data is copied by Evas */
             evas_object_image_memfile_set(md->efl.obj,
                                           data,
                                           size,
                                           NULL, NULL);
+            free(data);
             if (evas_object_image_load_error_get(md->efl.obj) != EVAS_LOAD_ERROR_NONE)
             {
                 ERR("Comic Book image format not supported");
@@ -568,11 +1010,6 @@ _etui_cb_page_render_pre(void *d)
 
             evas_object_resize(md->efl.obj, width, height);
             break;
-
-          free_archive:
-            archive_read_free(a);
-#endif
-            break;
         }
         case ETUI_CB_CBA:
             break;
@@ -580,7 +1017,7 @@ _etui_cb_page_render_pre(void *d)
 }
 
 static void
-_etui_cb_page_render(void *d)
+_etui_cb_page_render(void *d, const Etui_Module_Cancel *cancel EINA_UNUSED)
 {
     if (!d)
         return;
@@ -628,7 +1065,10 @@ static Etui_Module_Func _etui_module_func_cb =
     /* .page_render_pre   */ _etui_cb_page_render_pre,
     /* .page_render       */ _etui_cb_page_render,
     /* .page_render_end   */ _etui_cb_page_render_end,
-    /* .api_get           */ NULL
+    /* .api_get           */ NULL,
+    /* .page_raster_size  */ NULL,
+    /* .page_raster       */ NULL,
+    /* .page_text_get     */ NULL
 };
 
 /**
@@ -671,7 +1111,7 @@ module_open(Etui_Module *em)
 }
 
 static void
-module_close(Etui_Module *em)
+module_close(Etui_Module *em EINA_UNUSED)
 {
     if (_etui_module_cb_init_count > 1)
     {
@@ -686,8 +1126,7 @@ module_close(Etui_Module *em)
 
     DBG("shutdown cb module");
 
-    /* shutdown module here */
-    em->functions->shutdown(em->data);
+    /* documents are shut down by etui_file_free() */
 
     /* shutdown external libraries here */
 
@@ -66,6 +66,9 @@
 #endif
 #define CRIT(...) EINA_LOG_DOM_CRIT(_etui_module_djvu_log_domain, __VA_ARGS__)
 
+/* pages are rendered in bands of ETUI_DJVU_BAND_HEIGHT rows, cancellation is checked between them */
+#define ETUI_DJVU_BAND_HEIGHT 128
+
 typedef struct
 {
     /* specific EFL stuff for the module */
@@ -131,6 +134,67 @@ _etui_djvu_messages_cb(ddjvu_context_t *ctx, int wait)
     }
 }
 
+/* Etui rotations are clockwise, DjVu ones are counter-clockwise */
+static int
+_etui_djvu_rotation_get(Etui_Rotation rotation)
+{
+    return (4 - (rotation / 90)) & 3;
+}
+
+/*
+ * Bitonal pages only have a mask: rendering the mask alone skips the
+ * empty background and foreground layers.
+ */
+static ddjvu_render_mode_t
+_etui_djvu_render_mode_get(ddjvu_page_t *page)
+{
+    if (ddjvu_page_get_type(page) == DDJVU_PAGETYPE_BITONAL)
+        return DDJVU_RENDER_BLACK;
+
+    return DDJVU_RENDER_COLOR;
+}
+
+/* only the INFO chunk of the page is needed, not the decoding of the page */
+static Eina_Bool
+_etui_djvu_page_info_get(Etui_Module_Data *md, int page_num, ddjvu_pageinfo_t *info)
+{
+    ddjvu_status_t status;
+
+    while ((status = ddjvu_document_get_pageinfo(md->doc.doc, page_num, info)) < DDJVU_JOB_OK)
+        _etui_djvu_messages_cb(md->doc.ctx, EINA_TRUE);
+
+    if (status != DDJVU_JOB_OK)
+    {
+        _etui_djvu_messages_cb(md->doc.ctx, EINA_FALSE);
+        return EINA_FALSE;
+    }
+
+    return EINA_TRUE;
+}
+
+/*
+ * Waits for the end of the decoding of page, done by the threads of
+ * ddjvuapi. Called from the render threads, never from the main loop.
+ */
+static Eina_Bool
+_etui_djvu_page_decode(Etui_Module_Data *md, ddjvu_page_t *page, const Etui_Module_Cancel *cancel)
+{
+    while (!ddjvu_page_decoding_done(page))
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+            return EINA_FALSE;
+        _etui_djvu_messages_cb(md->doc.ctx, EINA_TRUE);
+    }
+
+    if (ddjvu_page_decoding_error(page))
+    {
+        _etui_djvu_messages_cb(md->doc.ctx, EINA_FALSE);
+        return EINA_FALSE;
+    }
+
+    return EINA_TRUE;
+}
+
 /* Virtual functions */
 
 static void *
@@ -324,6 +388,7 @@ _etui_djvu_page_set(void *d, int page_num)
     if (page_num >= ddjvu_document_get_pagenum(md->doc.doc))
         return EINA_FALSE;
 
+    /* the decoding starts here and is waited for by page_render() */
     page = ddjvu_page_create_by_pageno(md->doc.doc, page_num);
     if (!page)
     {
@@ -331,17 +396,6 @@ _etui_djvu_page_set(void *d, int page_num)
         return EINA_FALSE;
     }
 
-    while (!ddjvu_page_decoding_done(page))
-        _etui_djvu_messages_cb(md->doc.ctx, EINA_TRUE);
-    if (ddjvu_page_decoding_error(page))
-    {
-        _etui_djvu_messages_cb(md->doc.ctx, EINA_FALSE);
-        ERR("Could not decode page %d\n", page_num);
-        /* FIXME: corrupted file */
-        ddjvu_page_release(page);
-        return EINA_FALSE;
-    }
-
     if (md->page.page)
         ddjvu_page_release(md->page.page);
 
@@ -391,7 +445,7 @@ _etui_djvu_page_size_get(void *d, int *width, int *height)
 
     {
         if (width) *width = md->page.width;
-        if (height) *height = md->page.width;
+        if (height) *height = md->page.height;
     }
 
     return;
@@ -465,6 +519,7 @@ _etui_djvu_page_scale_get(void *d)
 static void
 _etui_djvu_page_render_pre(void *d)
 {
+    ddjvu_pageinfo_t info;
     Etui_Module_Data *md;
 
     if (!d)
@@ -480,11 +535,27 @@ _etui_djvu_page_render_pre(void *d)
         return;
     }
 
-    md->page.width = ddjvu_page_get_width(md->page.page);
-    md->page.height = ddjvu_page_get_height(md->page.page);
-    md->page.dpi = ddjvu_page_get_resolution(md->page.page);
-    md->page.gamma = ddjvu_page_get_gamma(md->page.page);
-    md->page.type = (Etui_Djvu_Page_Type)ddjvu_page_get_type(md->page.page);
+    /* the page may still be decoded, its size is known from its INFO chunk */
+    if (!_etui_djvu_page_info_get(md, md->page.page_num, &info))
+    {
+        ERR("could not get information of page %d", md->page.page_num);
+        return;
+    }
+
+    /* the page is rendered at the size it is displayed */
+    if ((info.rotation + _etui_djvu_rotation_get(md->page.rotation)) & 1)
+    {
+        md->page.width = (int)(info.height * md->page.scale);
+        md->page.height = (int)(info.width * md->page.scale);
+    }
+    else
+    {
+        md->page.width = (int)(info.width * md->page.scale);
+        md->page.height = (int)(info.height * md->page.scale);
+    }
+    if (md->page.width < 1) md->page.width = 1;
+    if (md->page.height < 1) md->page.height = 1;
+    md->page.dpi = info.dpi;
 
     evas_object_image_size_set(md->efl.obj, md->page.width, md->page.height);
     evas_object_image_filled_set(md->efl.obj, EINA_TRUE);
@@ -492,8 +563,36 @@ _etui_djvu_page_render_pre(void *d)
     evas_object_resize(md->efl.obj, md->page.width, md->page.height);
 }
 
+/*
+ * Renders rrect in buffer, band by band. The y direction of format must
+ * be top to bottom.
+ */
+static Eina_Bool
+_etui_djvu_render(ddjvu_page_t *page, ddjvu_render_mode_t mode, const ddjvu_rect_t *prect, const ddjvu_rect_t *rrect, const ddjvu_format_t *format, int stride, char *buffer, const Etui_Module_Cancel *cancel)
+{
+    ddjvu_rect_t band;
+    unsigned int row;
+
+    band = *rrect;
+    for (row = 0; row < rrect->h; row += ETUI_DJVU_BAND_HEIGHT)
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+            return EINA_FALSE;
+
+        band.y = rrect->y + row;
+        band.h = rrect->h - row;
+        if (band.h > ETUI_DJVU_BAND_HEIGHT)
+            band.h = ETUI_DJVU_BAND_HEIGHT;
+        if (!ddjvu_page_render(page, mode, prect, &band, format,
+                               stride, buffer + (size_t)row * stride))
+            return EINA_FALSE;
+    }
+
+    return EINA_TRUE;
+}
+
 static void
-_etui_djvu_page_render(void *d)
+_etui_djvu_page_render(void *d, const Etui_Module_Cancel *cancel)
 {
     unsigned int masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
     ddjvu_rect_t prect;
@@ -509,17 +608,39 @@ _etui_djvu_page_render(void *d)
 
     md = (Etui_Module_Data *)d;
 
+    if (!_etui_djvu_page_decode(md, md->page.page, cancel))
+    {
+        if (!ETUI_MODULE_CANCELLED(cancel))
+            ERR("Could not decode page %d", md->page.page_num);
+        return;
+    }
+
+    md->page.gamma = ddjvu_page_get_gamma(md->page.page);
+    md->page.type = (Etui_Djvu_Page_Type)ddjvu_page_get_type(md->page.page);
+
+    ddjvu_page_set_rotation(md->page.page,
+                            (ddjvu_page_rotation_t)((ddjvu_page_get_initial_rotation(md->page.page) +
+                                                     _etui_djvu_rotation_get(md->page.rotation)) & 3));
+
+    /* ddjvuapi scales the page to the size of the image set by page_render_pre() */
     prect.x = 0;
     prect.y = 0;
-    prect.w = ddjvu_page_get_width(md->page.page);
-    prect.h = ddjvu_page_get_height(md->page.page);
+    prect.w = md->page.width;
+    prect.h = md->page.height;
     rrect = prect;
     format = ddjvu_format_create(DDJVU_FORMAT_RGBMASK32, 4, masks);
     ddjvu_format_set_row_order(format, 1);
-    stride = ddjvu_page_get_width(md->page.page) * 4;
+    ddjvu_format_set_y_direction(format, 1);
+    stride = md->page.width * 4;
 
-    if (!ddjvu_page_render(md->page.page, DDJVU_RENDER_COLOR, &prect, &rrect, format, stride, md->efl.m))
-        ERR("could not render page");
+    if (!_etui_djvu_render(md->page.page, _etui_djvu_render_mode_get(md->page.page),
+                           &prect, &rrect, format, stride, md->efl.m, cancel))
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+            DBG("rendering of page %d cancelled", md->page.page_num);
+        else
+            ERR("could not render page");
+    }
 
     ddjvu_format_release(format);
 }
@@ -544,6 +665,114 @@ _etui_djvu_page_render_end(void *d)
 }
 
 
+static Eina_Bool
+_etui_djvu_page_raster_size(void *d, int page_num, double scale, Etui_Rotation rotation, int *width, int *height)
+{
+    Etui_Module_Data *md;
+    ddjvu_pageinfo_t info;
+    int w;
+    int h;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if ((page_num < 0) || (page_num >= md->doc.page_nbr))
+        return EINA_FALSE;
+
+    if (!_etui_djvu_page_info_get(md, page_num, &info))
+        return EINA_FALSE;
+
+    if ((info.rotation + _etui_djvu_rotation_get(rotation)) & 1)
+    {
+        w = info.height;
+        h = info.width;
+    }
+    else
+    {
+        w = info.width;
+        h = info.height;
+    }
+
+    if (width) *width = (int)(w * scale);
+    if (height) *height = (int)(h * scale);
+
+    return EINA_TRUE;
+}
+
+static Eina_Bool
+_etui_djvu_page_raster(void *d, int page_num, double scale, Etui_Rotation rotation, unsigned int *buffer, int x, int y, int width, int height, const Etui_Module_Cancel *cancel)
+{
+    unsigned int masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+    ddjvu_rect_t prect;
+    ddjvu_rect_t rrect;
+    Etui_Module_Data *md;
+    ddjvu_format_t *format;
+    ddjvu_page_t *page;
+    Eina_Bool res = EINA_FALSE;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if ((page_num < 0) || (page_num >= md->doc.page_nbr))
+        return EINA_FALSE;
+
+    page = ddjvu_page_create_by_pageno(md->doc.doc, page_num);
+    if (!page)
+        return EINA_FALSE;
+
+    if (!_etui_djvu_page_decode(md, page, cancel))
+    {
+        if (!ETUI_MODULE_CANCELLED(cancel))
+            ERR("Could not decode page %d", page_num);
+        goto release_page;
+    }
+
+    ddjvu_page_set_rotation(page,
+                            (ddjvu_page_rotation_t)((ddjvu_page_get_initial_rotation(page) +
+                                                     _etui_djvu_rotation_get(rotation)) & 3));
+
+    prect.x = 0;
+    prect.y = 0;
+    prect.w = (unsigned int)(ddjvu_page_get_width(page) * scale);
+    prect.h = (unsigned int)(ddjvu_page_get_height(page) * scale);
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) ||
+        ((unsigned int)(x + width) > prect.w) ||
+        ((unsigned int)(y + height) > prect.h))
+    {
+        ERR("region out of page %d", page_num);
+        goto release_page;
+    }
+
+    rrect.x = x;
+    rrect.y = y;
+    rrect.w = width;
+    rrect.h = height;
+    format = ddjvu_format_create(DDJVU_FORMAT_RGBMASK32, 4, masks);
+    if (!format)
+        goto release_page;
+
+    ddjvu_format_set_row_order(format, 1);
+    /* rrect is given from the top of the page */
+    ddjvu_format_set_y_direction(format, 1);
+
+    res = _etui_djvu_render(page, _etui_djvu_render_mode_get(page),
+                            &prect, &rrect, format,
+                            width * 4, (char *)buffer, cancel);
+    if (!res && !ETUI_MODULE_CANCELLED(cancel))
+        ERR("could not render page %d", page_num);
+
+    ddjvu_format_release(format);
+  release_page:
+    ddjvu_page_release(page);
+
+    return res;
+}
+
+
 static Etui_Module_Func _etui_module_func_djvu =
 {
     /* .init              */ _etui_djvu_init,
@@ -564,7 +793,10 @@ static Etui_Module_Func _etui_module_func_djvu =
     /* .page_render_pre   */ _etui_djvu_page_render_pre,
     /* .page_render       */ _etui_djvu_page_render,
     /* .page_render_end   */ _etui_djvu_page_render_end,
-    /* .api_get           */ NULL
+    /* .api_get           */ NULL,
+    /* .page_raster_size  */ _etui_djvu_page_raster_size,
+    /* .page_raster       */ _etui_djvu_page_raster,
+    /* .page_text_get     */ NULL
 };
 
 
@@ -608,7 +840,7 @@ module_open(Etui_Module *em)
 }
 
 static void
-module_close(Etui_Module *em)
+module_close(Etui_Module *em EINA_UNUSED)
 {
     if (_etui_module_djvu_init_count > 1)
     {
@@ -623,8 +855,7 @@ module_close(Etui_Module *em)
 
     DBG("shutdown djvu module");
 
-    /* shutdown module here */
-    em->functions->shutdown(em->data);
+    /* documents are shut down by etui_file_free() */
 
     /* shutdown external libraries here */
 
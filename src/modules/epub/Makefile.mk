@@ -22,7 +22,9 @@ etui_modules_epub_LTLIBRARIES = src/modules/epub/module.la
 
 src_modules_epub_module_la_SOURCES = \
 src/modules/epub/etui_module_epub.c \
-src/modules/epub/etui_module_epub.h
+src/modules/epub/etui_module_epub.h \
+src/lib/etui_zip.c \
+src/lib/etui_zip.h
 
 src_modules_epub_module_la_CPPFLAGS = \
 -I$(top_srcdir)/src/lib \
@@ -18,19 +18,18 @@
 
 #include <config.h>
 
-#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <Eina.h>
+#include <Ecore.h> /* for Ecore_Thread in Etui_Module */
 #include <Evas.h>
-#include <Ecore_File.h>
-
-#include <EWebKit2.h>
-
-#include <archive.h>
-#include <archive_entry.h>
+#include <Ecore_Evas.h>
 
 #include "Etui.h"
 #include "etui_module.h"
+#include "etui_file.h"
+#include "etui_zip.h"
 #include "etui_module_epub.h"
 
 /*============================================================================*
@@ -71,17 +70,40 @@
 #endif
 #define CRIT(...) EINA_LOG_DOM_CRIT(_etui_module_epub_log_domain, __VA_ARGS__)
 
-typedef struct _Etui_Provider_Data Etui_Provider_Data;
-typedef struct _Etui_Epub_Ncx_Toc_Item Etui_Epub_Ncx_Toc_Item;
+#define ETUI_EPUB_MIMETYPE "application/epub+zip"
 
-struct _Etui_Epub_Ncx_Toc_Item
-{
-  char *label;
-  char *link;
-  Eina_Array *child;
-};
+/* size of a page at scale 1, in pixels */
+#define ETUI_EPUB_PAGE_WIDTH 600
+#define ETUI_EPUB_PAGE_HEIGHT 800
+#define ETUI_EPUB_PAGE_MARGIN 40
+#define ETUI_EPUB_FONT_SIZE 16
 
-struct _Etui_Provider_Data
+/* estimation of the number of pages of the chapters not laid out yet */
+#define ETUI_EPUB_BYTES_PER_PAGE 3072
+
+/* chapters laid out on each side of the current one */
+#define ETUI_EPUB_LAYOUT_AROUND 1
+
+typedef struct
+{
+    char *path; /* name of the spine document in the archive */
+    const Etui_Zip_Entry *zip_entry;
+    char *markup; /* textblock markup, kept for the chapters around the current one */
+    int *breaks; /* top of each page in the laid out chapter */
+    int pages_nbr; /* 0 until the chapter is laid out */
+    double scale; /* scale of the last layout */
+} Etui_Epub_Chapter;
+
+typedef struct
+{
+    Eina_Strbuf *buf;
+    int skip; /* depth in the elements that are not displayed */
+    unsigned int in_body : 1;
+    unsigned int space : 1; /* a space or a paragraph separator ends buf */
+    unsigned int paragraph : 1; /* a paragraph separator ends buf */
+} Etui_Epub_Markup;
+
+typedef struct
 {
     /* specific EFL stuff for the module */
 
@@ -96,13 +118,29 @@ struct _Etui_Provider_Data
     struct
     {
         char *filename;
-        Eina_Tmpstr *path;
         int page_nbr;
         Eina_Array toc;
-        void *data;
+        const void *data;
         size_t size;
+        Etui_Zip *zip; /* index of the central directory of the mapped file */
+        Etui_Epub_Chapter *chapters; /* one per spine item */
     } doc;
 
+    /*
+     * Evas is not thread safe, so the chapters are laid out and the pages
+     * rasterised in an offscreen canvas of the main loop
+     */
+    struct
+    {
+        Ecore_Evas *ee;
+        Evas_Object *bg;
+        Evas_Object *clip;
+        Evas_Object *tb;
+        Evas_Textblock_Style *style;
+        double scale; /* scale of the style */
+        int chapter; /* chapter whose markup is in tb, or -1 */
+    } layout;
+
     struct
     {
         char *content_file;
@@ -112,6 +150,7 @@ struct _Etui_Provider_Data
 
     struct
     {
+        char *dir; /* hrefs of the OPF file are relative to it */
         Eina_Hash *manifest;
         Eina_Array *spine;
         char *title;
@@ -134,13 +173,13 @@ struct _Etui_Provider_Data
             char *name;
         } meta_items[2];
         int meta_item_current;
+        char *dir; /* sources of the NCX file are relative to it */
         char *title;
         char *uid;
         char *author;
-        Etui_Epub_Ncx_Toc_Item **stack;
+        Etui_Toc_Item **stack;
         int depth;
         int current_depth;
-        unsigned int meta_item_to_free : 1;
         unsigned int has_ncx : 1;
         unsigned int has_title : 1;
         unsigned int has_author : 1;
@@ -157,10 +196,12 @@ struct _Etui_Provider_Data
         int width;
         int height;
         int page_num;
+        int chapter;
+        int local; /* page in the chapter */
         Etui_Rotation rotation;
         double scale;
     } page;
-};
+} Etui_Module_Data;
 
 typedef struct _Etui_Epub_Opf_Manifest_Item Etui_Epub_Opf_Manifest_Item;
 
@@ -174,132 +215,195 @@ struct _Etui_Epub_Opf_Manifest_Item
 static int _etui_module_epub_init_count = 0;
 static int _etui_module_epub_log_domain = -1;
 
-static Eina_Bool
-_etui_epub_file_unzip(Etui_Provider_Data *pd)
+/*
+ * Inflate the entry @p name of the archive in memory. The returned
+ * buffer is nul terminated, so that it can be parsed as a string.
+ */
+static char *
+_etui_epub_entry_get(const Etui_Module_Data *md, const char *name, size_t *size)
 {
-    struct archive *a;
-    struct archive_entry *entry;
-    int r;
+    const Etui_Zip_Entry *entry;
+    char *data;
+    size_t s;
 
-    if (!eina_file_mkdtemp("etui-epub-tmp-XXXXXX", &pd->doc.path))
-        return EINA_FALSE;
+    if (size) *size = 0;
+
+    entry = etui_zip_entry_find(md->doc.zip, name);
+    if (!entry)
+    {
+        ERR("Can not find %s in the EPUB archive", name);
+        return NULL;
+    }
+
+    data = (char *)etui_zip_entry_data_get(md->doc.zip, entry, &s);
+    if (!data)
+    {
+        ERR("Can not inflate %s from the EPUB archive", name);
+        return NULL;
+    }
+
+    /* etui_zip allocates one more byte than the size of the entry */
+    data[s] = '\0';
+    if (size) *size = s;
+
+    return data;
+}
+
+/* directory part of path, with its trailing slash, or "" */
+static char *
+_etui_epub_dir_get(const char *path)
+{
+    const char *iter;
+    char *dir;
+
+    iter = strrchr(path, '/');
+    if (!iter)
+        return strdup("");
+
+    dir = (char *)malloc(iter - path + 2);
+    if (!dir)
+        return NULL;
 
-    a = archive_read_new();
-    if (!a)
-        goto free_path;
+    memcpy(dir, path, iter - path + 1);
+    dir[iter - path + 1] = '\0';
 
-    if (archive_read_support_filter_all(a) != ARCHIVE_OK)
-        goto free_path;
+    return dir;
+}
 
-    if (archive_read_support_format_zip(a) != ARCHIVE_OK)
-        goto free_path;
+static int
+_etui_epub_hex_get(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+/*
+ * Name in the archive of the relative URL @p href, found in a file of
+ * the directory @p dir. The fragment is dropped, the escaped characters
+ * are decoded and the "." and ".." segments are removed.
+ */
+static char *
+_etui_epub_path_resolve(const char *dir, const char *href)
+{
+    const char *seg;
+    char *path;
+    char *tmp;
+    char *iter;
+    size_t l;
+
+    if (*href == '/')
+    {
+        dir = "";
+        href++;
+    }
 
-    r = archive_read_open_filename(a, pd->doc.filename, 16384);
-    if (r != ARCHIVE_OK)
-        goto free_path;
+    tmp = (char *)malloc(strlen(dir) + strlen(href) + 1);
+    if (!tmp)
+        return NULL;
 
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+    l = strlen(dir);
+    memcpy(tmp, dir, l);
+    iter = tmp + l;
+    while (*href && (*href != '#') && (*href != '?'))
     {
-        if (archive_entry_filetype(entry) == AE_IFREG)
+        if ((*href == '%') &&
+            (_etui_epub_hex_get(href[1]) >= 0) &&
+            (_etui_epub_hex_get(href[2]) >= 0))
         {
-            char buf[PATH_MAX];
-            const char *name;
-            char *dir;
-            char *base;
-            size_t size;
-            void *data;
-
-            name = archive_entry_pathname(entry);
-            dir = strdup(name);
-            base = strdup(name);
-            if (dir && base && (strcmp(dir, ".") != 0))
-            {
-                snprintf(buf, sizeof(buf), "%s/%s", pd->doc.path, dirname(dir));
-                buf[sizeof(buf) - 1] = '\0';
-                ecore_file_mkdir(buf);
-                printf(" * %s %s %s\n", name, dirname(dir), basename(base));
-            }
+            *iter++ = (char)((_etui_epub_hex_get(href[1]) << 4) |
+                             _etui_epub_hex_get(href[2]));
+            href += 3;
+        }
+        else
+            *iter++ = *href++;
+    }
+    *iter = '\0';
 
-            if (base)
-                free(base);
-            if (dir)
-                free(dir);
+    path = (char *)malloc(iter - tmp + 1);
+    if (!path)
+    {
+        free(tmp);
+        return NULL;
+    }
 
-            size = archive_entry_size(entry);
-            data = malloc(size);
-            if (data)
-            {
-                size_t res;
+    l = 0;
+    seg = tmp;
+    while (*seg)
+    {
+        const char *end;
+        size_t s;
 
-                res = archive_read_data(a, data, size);
-                if (res > 0)
-                {
-                    FILE *f;
-
-                    snprintf(buf, sizeof(buf), "%s/%s", pd->doc.path, name);
-                    buf[sizeof(buf) - 1] = '\0';
-                    printf(" $ %s\n", buf);
-                    f = fopen(buf, "wb");
-                    if (f)
-                    {
-                        fwrite(data, 1, size, f);
-                        fclose(f);
-                    }
-                }
+        end = strchr(seg, '/');
+        if (!end)
+            end = seg + strlen(seg);
+        s = end - seg;
 
-                free(data);
-            }
+        if ((s == 2) && (seg[0] == '.') && (seg[1] == '.'))
+        {
+            while ((l > 0) && (path[l - 1] != '/'))
+                l--;
+            if (l > 0)
+                l--;
         }
-        archive_read_data_skip(a);
+        else if ((s > 0) && !((s == 1) && (seg[0] == '.')))
+        {
+            if (l > 0)
+                path[l++] = '/';
+            memcpy(path + l, seg, s);
+            l += s;
+        }
+
+        seg = *end ? end + 1 : end;
     }
+    path[l] = '\0';
+    free(tmp);
 
-    archive_read_free(a);
+    return path;
+}
 
-    return EINA_TRUE;
+static int
+_etui_epub_chapter_find(const Etui_Module_Data *md, const char *path)
+{
+    int i;
 
-  free_path:
-    eina_tmpstr_del(pd->doc.path);
+    for (i = 0; i < md->doc.page_nbr; i++)
+    {
+        if (strcmp(md->doc.chapters[i].path, path) == 0)
+            return i;
+    }
 
-    return EINA_FALSE;
+    return -1;
 }
 
 static Eina_Bool
-_etui_epub_mimetype_is_valid(Etui_Provider_Data *pd)
+_etui_epub_mimetype_is_valid(Etui_Module_Data *md)
 {
-    char buf[PATH_MAX];
-    Eina_File *f;
-    void *data;
-
-    snprintf(buf, sizeof(buf), "%s/%s", pd->doc.path, "mimetype");
-    buf[sizeof(buf) - 1] = '\0';
-    f = eina_file_open(buf, EINA_FALSE);
-    if (!f)
-        return EINA_FALSE;
+    char *data;
+    size_t size;
+    Eina_Bool res;
 
-    data = eina_file_map_all(f, EINA_FILE_POPULATE);
+    data = _etui_epub_entry_get(md, "mimetype", &size);
     if (!data)
-    {
-        eina_file_close(f);
-        return EINA_FALSE;
-    }
-
-    if (strcmp(data, "application/epub+zip") != 0)
-    {
-        eina_file_close(f);
         return EINA_FALSE;
-    }
 
-    eina_file_close(f);
+    res = ((size >= strlen(ETUI_EPUB_MIMETYPE)) &&
+           (strncmp(data, ETUI_EPUB_MIMETYPE, strlen(ETUI_EPUB_MIMETYPE)) == 0));
+    free(data);
 
-    return EINA_TRUE;
+    return res;
 }
 
 static Eina_Bool
 _etui_epub_container_attr_parse_cb(void *data, const char *key, const char *value)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if (!strcmp("media-type", key))
     {
@@ -311,9 +415,9 @@ _etui_epub_container_attr_parse_cb(void *data, const char *key, const char *valu
         }
     }
 
-    if (!strcmp("full-path", key))
+    if (!strcmp("full-path", key) && !md->container.content_file)
     {
-        pd->container.content_file = strdup(value);
+        md->container.content_file = strdup(value);
     }
 
     return EINA_TRUE;
@@ -322,33 +426,33 @@ _etui_epub_container_attr_parse_cb(void *data, const char *key, const char *valu
 static Eina_Bool
 _etui_epub_container_parse_cb(void *data, Eina_Simple_XML_Type type, const char *content, unsigned offset EINA_UNUSED, unsigned length)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if ((type == EINA_SIMPLE_XML_OPEN) || (type == EINA_SIMPLE_XML_OPEN_EMPTY))
     {
         if (strncmp("container", content, strlen("container")) == 0)
         {
-            if (pd->container.has_container)
+            if (md->container.has_container)
             {
                 return EINA_FALSE;
             }
-            pd->container.has_container = 1;
+            md->container.has_container = 1;
         }
         else if (strncmp("rootfiles", content, strlen("rootfiles")) == 0)
         {
-            if (!pd->container.has_container || pd->container.has_rootfiles)
+            if (!md->container.has_container || md->container.has_rootfiles)
             {
                 return EINA_FALSE;
             }
-            pd->container.has_rootfiles = 1;
+            md->container.has_rootfiles = 1;
         }
         else if (strncmp("rootfile", content, strlen("rootfile")) == 0)
         {
             const char *tags;
 
-            if (!pd->container.has_container || !pd->container.has_rootfiles)
+            if (!md->container.has_container || !md->container.has_rootfiles)
             {
                 return EINA_FALSE;
             }
@@ -357,7 +461,7 @@ _etui_epub_container_parse_cb(void *data, Eina_Simple_XML_Type type, const char
                                                        length);
 
             if (!eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                                  _etui_epub_container_attr_parse_cb, pd))
+                                                  _etui_epub_container_attr_parse_cb, md))
             {
                 return EINA_FALSE;
             }
@@ -368,29 +472,25 @@ _etui_epub_container_parse_cb(void *data, Eina_Simple_XML_Type type, const char
 }
 
 static Eina_Bool
-_etui_epub_container_is_valid(Etui_Provider_Data *pd)
+_etui_epub_container_is_valid(Etui_Module_Data *md)
 {
-    char buf[PATH_MAX];
-    Eina_File *f;
+    char *data;
+    size_t size;
+    Eina_Bool res;
 
-    snprintf(buf, sizeof(buf), "%s/%s", pd->doc.path, "META-INF/container.xml");
-    buf[sizeof(buf) - 1] = '\0';
-    f = eina_file_open(buf, EINA_FALSE);
-    if (!f)
+    data = _etui_epub_entry_get(md, "META-INF/container.xml", &size);
+    if (!data)
         return EINA_FALSE;
 
-    if (!eina_simple_xml_parse((const char *)eina_file_map_all(f, EINA_FILE_POPULATE),
-                               eina_file_size_get(f),
-                               EINA_TRUE,
-                               _etui_epub_container_parse_cb, pd))
-    {
-        eina_file_close(f);
-        return EINA_FALSE;
-    }
+    res = eina_simple_xml_parse(data, size,
+                                EINA_TRUE,
+                                _etui_epub_container_parse_cb, md);
+    free(data);
 
-    eina_file_close(f);
+    if (!res)
+        return EINA_FALSE;
 
-    if (!pd->container.content_file || !*pd->container.content_file)
+    if (!md->container.content_file || !*md->container.content_file)
     {
         return EINA_FALSE;
     }
@@ -420,12 +520,12 @@ _etui_epub_opf_manifest_item_attr_parse_cb(void *data, const char *key, const ch
 static Eina_Bool
 _etui_epub_opf_spine_attr_parse_cb(void *data, const char *key, const char *value)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if (!strcmp("toc", key))
-        pd->opf.toc_id = strdup(value);
+        md->opf.toc_id = strdup(value);
 
    return EINA_TRUE;
 }
@@ -433,47 +533,62 @@ _etui_epub_opf_spine_attr_parse_cb(void *data, const char *key, const char *valu
 static Eina_Bool
 _etui_epub_opf_spine_item_attr_parse_cb(void *data, const char *key, const char *value)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if (!strcmp("idref", key))
-        eina_array_push(pd->opf.spine, strdup(value));
+        eina_array_push(md->opf.spine, strdup(value));
 
     return EINA_TRUE;
 }
 
+static char *
+_etui_epub_text_dup(const char *content, unsigned length)
+{
+    char *str;
+
+    str = (char *)malloc(length + 1);
+    if (str)
+    {
+        memcpy(str, content, length);
+        str[length] = '\0';
+    }
+
+    return str;
+}
+
 static Eina_Bool
 _etui_epub_opf_parse_cb(void *data, Eina_Simple_XML_Type type, const char *content, unsigned offset EINA_UNUSED, unsigned length)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if ((type == EINA_SIMPLE_XML_OPEN) || (type == EINA_SIMPLE_XML_OPEN_EMPTY))
     {
         if (strncmp("package", content, strlen("package")) == 0)
         {
-            if (pd->opf.has_package)
+            if (md->opf.has_package)
             {
                 return EINA_FALSE;
             }
-            pd->opf.has_package = 1;
+            md->opf.has_package = 1;
         }
         else if (strncmp("manifest", content, strlen("manifest")) == 0)
         {
-            if (!pd->opf.has_package || pd->opf.has_manifest)
+            if (!md->opf.has_package || md->opf.has_manifest)
             {
                 return EINA_FALSE;
             }
-            pd->opf.has_manifest = 1;
+            md->opf.has_manifest = 1;
         }
         else if ((strncmp("item", content, strlen("item")) == 0) &&
                  (strncmp("itemref", content, strlen("itemref")) != 0))
         {
             Etui_Epub_Opf_Manifest_Item *item;
 
-            if (!pd->opf.has_package || !pd->opf.has_manifest)
+            if (!md->opf.has_package || !md->opf.has_manifest)
             {
                 return EINA_FALSE;
             }
@@ -487,9 +602,10 @@ _etui_epub_opf_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
                                                            length);
 
                 if (eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                                      _etui_epub_opf_manifest_item_attr_parse_cb, item))
+                                                      _etui_epub_opf_manifest_item_attr_parse_cb, item) &&
+                    item->id && item->href)
                 {
-                    eina_hash_add(pd->opf.manifest, item->id, item);
+                    eina_hash_add(md->opf.manifest, item->id, item);
                 }
                 else
                 {
@@ -507,23 +623,23 @@ _etui_epub_opf_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
         {
             const char *tags;
 
-            if (!pd->opf.has_package || pd->opf.has_spine)
+            if (!md->opf.has_package || md->opf.has_spine)
             {
                 return EINA_FALSE;
             }
-            pd->opf.has_spine = 1;
+            md->opf.has_spine = 1;
 
             tags = eina_simple_xml_tag_attributes_find(content,
                                                        length);
 
             eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                             _etui_epub_opf_spine_attr_parse_cb, pd);
+                                             _etui_epub_opf_spine_attr_parse_cb, md);
         }
         else if (strncmp("itemref", content, strlen("itemref")) == 0)
         {
             const char *tags;
 
-            if (!pd->opf.has_package || !pd->opf.has_spine)
+            if (!md->opf.has_package || !md->opf.has_spine)
             {
                 return EINA_FALSE;
             }
@@ -532,115 +648,147 @@ _etui_epub_opf_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
                                                        length);
 
             eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                             _etui_epub_opf_spine_item_attr_parse_cb, pd);
+                                             _etui_epub_opf_spine_item_attr_parse_cb, md);
         }
         else if (strncmp("dc:title", content, strlen("dc:title")) == 0)
         {
-            pd->opf.has_dc_title = 1;
+            md->opf.has_dc_title = 1;
         }
         else if (strncmp("dc:creator", content, strlen("dc:creator")) == 0)
         {
-            pd->opf.has_dc_creator = 1;
+            md->opf.has_dc_creator = 1;
         }
         else if (strncmp("dc:identifier", content, strlen("dc:identifier")) == 0)
         {
-            pd->opf.has_dc_identifier = 1;
+            md->opf.has_dc_identifier = 1;
         }
     }
     else if (type == EINA_SIMPLE_XML_DATA)
     {
-        if (pd->opf.has_dc_title)
-        {
-            pd->opf.title = (char *)malloc(length + 1);
-            if (pd->opf.title)
-            {
-                memcpy(pd->opf.title, content, length);
-                pd->opf.title[length] = '\0';
-            }
-        }
-        if (pd->opf.has_dc_creator)
-        {
-            pd->opf.author = (char *)malloc(length + 1);
-            if (pd->opf.author)
-            {
-                memcpy(pd->opf.author, content, length);
-                pd->opf.author[length] = '\0';
-            }
-        }
-        if (pd->opf.has_dc_identifier)
-        {
-            pd->opf.uuid = (char *)malloc(length + 1);
-            if (pd->opf.uuid)
-            {
-                memcpy(pd->opf.uuid, content, length);
-                pd->opf.uuid[length] = '\0';
-            }
-        }
+        /* only the first title, creator and identifier are kept */
+        if (md->opf.has_dc_title && !md->opf.title)
+            md->opf.title = _etui_epub_text_dup(content, length);
+        if (md->opf.has_dc_creator && !md->opf.author)
+            md->opf.author = _etui_epub_text_dup(content, length);
+        if (md->opf.has_dc_identifier && !md->opf.uuid)
+            md->opf.uuid = _etui_epub_text_dup(content, length);
     }
     else if (type == EINA_SIMPLE_XML_CLOSE)
     {
-        if (pd->opf.has_dc_title)
-            pd->opf.has_dc_title = 0;
+        if (md->opf.has_dc_title)
+            md->opf.has_dc_title = 0;
 
-        if (pd->opf.has_dc_creator)
-            pd->opf.has_dc_creator = 0;
+        if (md->opf.has_dc_creator)
+            md->opf.has_dc_creator = 0;
 
-        if (pd->opf.has_dc_identifier)
-            pd->opf.has_dc_identifier = 0;
+        if (md->opf.has_dc_identifier)
+            md->opf.has_dc_identifier = 0;
     }
 
     return EINA_TRUE;
 }
 
 static Eina_Bool
-_etui_epub_opf_is_valid(Etui_Provider_Data *pd)
+_etui_epub_opf_is_valid(Etui_Module_Data *md)
 {
-    char buf[PATH_MAX];
-    Eina_File *f;
+    char *data;
+    size_t size;
+    Eina_Bool res;
 
-    snprintf(buf, sizeof(buf), "%s/%s", pd->doc.path, pd->container.content_file);
-    buf[sizeof(buf) - 1] = '\0';
-    f = eina_file_open(buf, EINA_FALSE);
-    if (!f)
+    md->opf.dir = _etui_epub_dir_get(md->container.content_file);
+    if (!md->opf.dir)
         return EINA_FALSE;
 
-    if (!eina_simple_xml_parse((const char *)eina_file_map_all(f, EINA_FILE_POPULATE),
-                               eina_file_size_get(f),
-                               EINA_TRUE,
-                               _etui_epub_opf_parse_cb, pd))
-    {
-        eina_file_close(f);
+    data = _etui_epub_entry_get(md, md->container.content_file, &size);
+    if (!data)
         return EINA_FALSE;
-    }
 
-    eina_file_close(f);
+    res = eina_simple_xml_parse(data, size,
+                                EINA_TRUE,
+                                _etui_epub_opf_parse_cb, md);
+    free(data);
 
-    return EINA_TRUE;
+    return res;
+}
+
+/*
+ * The spine documents are only located in the central directory here,
+ * they are inflated when they are displayed.
+ */
+static Eina_Bool
+_etui_epub_chapters_fill(Etui_Module_Data *md)
+{
+    unsigned int count;
+    unsigned int i;
+
+    count = eina_array_count(md->opf.spine);
+    if (count == 0)
+        return EINA_FALSE;
+
+    md->doc.chapters = (Etui_Epub_Chapter *)calloc(count, sizeof(Etui_Epub_Chapter));
+    if (!md->doc.chapters)
+        return EINA_FALSE;
+
+    for (i = 0; i < count; i++)
+    {
+        Etui_Epub_Opf_Manifest_Item *item;
+        Etui_Epub_Chapter *chapter;
+        char *path;
+
+        item = eina_hash_find(md->opf.manifest,
+                              eina_array_data_get(md->opf.spine, i));
+        if (!item)
+        {
+            WRN("spine item %s not in the manifest",
+                (char *)eina_array_data_get(md->opf.spine, i));
+            continue;
+        }
+
+        path = _etui_epub_path_resolve(md->opf.dir, item->href);
+        if (!path)
+            return EINA_FALSE;
+
+        chapter = md->doc.chapters + md->doc.page_nbr;
+        chapter->zip_entry = etui_zip_entry_find(md->doc.zip, path);
+        if (!chapter->zip_entry)
+        {
+            WRN("spine document %s not in the archive", path);
+            free(path);
+            continue;
+        }
+
+        chapter->path = path;
+        md->doc.page_nbr++;
+    }
+
+    return md->doc.page_nbr > 0;
 }
 
 static Eina_Bool
 _etui_epub_ncx_meta_attr_parse_cb(void *data, const char *key, const char *value)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
+
+    if (md->ncx.meta_item_current >= 2)
+        return EINA_TRUE;
 
     if (!strcmp("name", key) &&
         (!strcmp("dtb:depth", value) || !strcmp("dtb:uid", value)))
     {
-        if (pd->ncx.meta_item_current < 2)
-            pd->ncx.meta_items[pd->ncx.meta_item_current].name = strdup(value);
+        md->ncx.meta_items[md->ncx.meta_item_current].name = strdup(value);
     }
 
     if (!strcmp("content", key))
     {
-        if (pd->ncx.meta_item_current < 2)
-            pd->ncx.meta_items[pd->ncx.meta_item_current].content = strdup(value);
+        free(md->ncx.meta_items[md->ncx.meta_item_current].content);
+        md->ncx.meta_items[md->ncx.meta_item_current].content = strdup(value);
     }
 
-    if (pd->ncx.meta_items[pd->ncx.meta_item_current].content &&
-        pd->ncx.meta_items[pd->ncx.meta_item_current].name)
-        pd->ncx.meta_item_current++;
+    if (md->ncx.meta_items[md->ncx.meta_item_current].content &&
+        md->ncx.meta_items[md->ncx.meta_item_current].name)
+        md->ncx.meta_item_current++;
 
     return EINA_TRUE;
 }
@@ -648,13 +796,24 @@ _etui_epub_ncx_meta_attr_parse_cb(void *data, const char *key, const char *value
 static Eina_Bool
 _etui_epub_ncx_content_attr_parse_cb(void *data, const char *key, const char *value)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if (!strcmp("src", key))
     {
-        pd->ncx.stack[pd->ncx.current_depth]->link = strdup(value);
+        Etui_Toc_Item *item;
+        char *path;
+
+        item = md->ncx.stack[md->ncx.current_depth];
+        path = _etui_epub_path_resolve(md->ncx.dir, value);
+        if (path)
+        {
+            item->kind = ETUI_LINK_KIND_GOTO;
+            item->dest.goto_.chapter = _etui_epub_chapter_find(md, path);
+            item->dest.goto_.page = item->dest.goto_.chapter;
+            free(path);
+        }
     }
 
     return EINA_TRUE;
@@ -663,19 +822,19 @@ _etui_epub_ncx_content_attr_parse_cb(void *data, const char *key, const char *va
 static Eina_Bool
 _etui_epub_ncx_parse_cb(void *data, Eina_Simple_XML_Type type, const char *content, unsigned offset EINA_UNUSED, unsigned length)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
-    pd = (Etui_Provider_Data *)data;
+    md = (Etui_Module_Data *)data;
 
     if ((type == EINA_SIMPLE_XML_OPEN) || (type == EINA_SIMPLE_XML_OPEN_EMPTY))
     {
         if (strncmp("ncx", content, strlen("ncx")) == 0)
         {
-            if (pd->ncx.has_ncx)
+            if (md->ncx.has_ncx)
             {
                 return EINA_FALSE;
             }
-            pd->ncx.has_ncx = 1;
+            md->ncx.has_ncx = 1;
         }
         else if (strncmp("meta", content, strlen("meta")) == 0)
         {
@@ -685,109 +844,111 @@ _etui_epub_ncx_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
                                                        length);
 
             eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                             _etui_epub_ncx_meta_attr_parse_cb, pd);
+                                             _etui_epub_ncx_meta_attr_parse_cb, md);
         }
         else if (strncmp("docTitle", content, strlen("docTitle")) == 0)
         {
-            if (!pd->ncx.has_ncx || pd->ncx.has_title)
+            if (!md->ncx.has_ncx || md->ncx.has_title)
             {
                 return EINA_FALSE;
             }
-            pd->ncx.has_title = 1;
+            md->ncx.has_title = 1;
         }
         else if (strncmp("docAuthor", content, strlen("docAuthor")) == 0)
         {
-            if (!pd->ncx.has_ncx || pd->ncx.has_author)
+            if (!md->ncx.has_ncx || md->ncx.has_author)
             {
                 return EINA_FALSE;
             }
-            pd->ncx.has_author = 1;
+            md->ncx.has_author = 1;
         }
         else if (strncmp("text", content, strlen("text")) == 0)
         {
-            if (pd->ncx.has_title)
-                pd->ncx.has_title_text = 1;
-            if (pd->ncx.has_author)
-                pd->ncx.has_author_text = 1;
-            if (pd->ncx.has_navpoint)
-                pd->ncx.has_navpoint_text = 1;
+            if (md->ncx.has_title)
+                md->ncx.has_title_text = 1;
+            if (md->ncx.has_author)
+                md->ncx.has_author_text = 1;
+            if (md->ncx.has_navpoint)
+                md->ncx.has_navpoint_text = 1;
         }
         else if (strncmp("navMap", content, strlen("navMap")) == 0)
         {
             int i;
 
-            for (i = 0; i < 2; i++)
+            for (i = 0; i < md->ncx.meta_item_current; i++)
             {
-                if (!strcmp(pd->ncx.meta_items[i].name, "dtb:uid"))
-                    pd->ncx.uid = pd->ncx.meta_items[i].content;
-                if (!strcmp(pd->ncx.meta_items[i].name, "dtb:depth"))
+                if (!strcmp(md->ncx.meta_items[i].name, "dtb:uid"))
+                    md->ncx.uid = md->ncx.meta_items[i].content;
+                if (!strcmp(md->ncx.meta_items[i].name, "dtb:depth"))
                 {
-                    pd->ncx.depth = atoi(pd->ncx.meta_items[i].content);
-                    free(pd->ncx.meta_items[i].content);
-                    pd->ncx.meta_item_to_free = 1 - i;
+                    md->ncx.depth = atoi(md->ncx.meta_items[i].content);
+                    free(md->ncx.meta_items[i].content);
+                    md->ncx.meta_items[i].content = NULL;
                 }
-                free(pd->ncx.meta_items[i].name);
+                free(md->ncx.meta_items[i].name);
+                md->ncx.meta_items[i].name = NULL;
             }
             /* FIXME: use an eina_array instead */
-            if (pd->ncx.depth == 0)
-                pd->ncx.depth = 10;
-            pd->ncx.stack = (Etui_Epub_Ncx_Toc_Item **)calloc(pd->ncx.depth, sizeof(Etui_Epub_Ncx_Toc_Item *));
+            if (md->ncx.depth <= 0)
+                md->ncx.depth = 10;
+            md->ncx.stack = (Etui_Toc_Item **)calloc(md->ncx.depth, sizeof(Etui_Toc_Item *));
+            if (!md->ncx.stack)
+                return EINA_FALSE;
+            md->ncx.has_navmap = 1;
         }
         else if (strncmp("navPoint", content, strlen("navPoint")) == 0)
         {
-            pd->ncx.current_depth++;
-            pd->ncx.stack[pd->ncx.current_depth] = (Etui_Epub_Ncx_Toc_Item *)calloc(1, sizeof(Etui_Epub_Ncx_Toc_Item));
-            if (pd->ncx.current_depth > 0)
+            if (!md->ncx.has_navmap ||
+                (md->ncx.current_depth + 1 >= md->ncx.depth))
+            {
+                return EINA_FALSE;
+            }
+            md->ncx.current_depth++;
+            md->ncx.stack[md->ncx.current_depth] = (Etui_Toc_Item *)calloc(1, sizeof(Etui_Toc_Item));
+            if (!md->ncx.stack[md->ncx.current_depth])
+                return EINA_FALSE;
+            md->ncx.stack[md->ncx.current_depth]->dest.goto_.chapter = -1;
+            md->ncx.stack[md->ncx.current_depth]->dest.goto_.page = -1;
+            if (md->ncx.current_depth > 0)
             {
-                if (pd->ncx.stack[pd->ncx.current_depth - 1]->child == NULL)
-                    pd->ncx.stack[pd->ncx.current_depth - 1]->child = eina_array_new(4);
+                if (md->ncx.stack[md->ncx.current_depth - 1]->child == NULL)
+                    md->ncx.stack[md->ncx.current_depth - 1]->child = eina_array_new(4);
             }
-            pd->ncx.has_navpoint = 1;
+            md->ncx.has_navpoint = 1;
         }
         else if (strncmp("content", content, strlen("content")) == 0)
         {
             const char *tags;
 
+            if (md->ncx.current_depth < 0)
+                return EINA_TRUE;
+
             tags = eina_simple_xml_tag_attributes_find(content,
                                                        length);
 
             eina_simple_xml_attributes_parse(tags, length - (tags - content),
-                                             _etui_epub_ncx_content_attr_parse_cb, pd);
+                                             _etui_epub_ncx_content_attr_parse_cb, md);
         }
     }
     else if (type == EINA_SIMPLE_XML_DATA)
     {
-        if (pd->ncx.has_title_text)
+        if (md->ncx.has_title_text)
         {
-            pd->ncx.title = (char *)malloc(length + 1);
-            if (pd->ncx.title)
-            {
-                memcpy(pd->ncx.title, content, length);
-                pd->ncx.title[length] = '\0';
-            }
+            if (!md->ncx.title)
+                md->ncx.title = _etui_epub_text_dup(content, length);
         }
-        else if (pd->ncx.has_author_text)
+        else if (md->ncx.has_author_text)
         {
-            pd->ncx.author = (char *)malloc(length + 1);
-            if (pd->ncx.author)
-            {
-                memcpy(pd->ncx.author, content, length);
-                pd->ncx.author[length] = '\0';
-            }
+            if (!md->ncx.author)
+                md->ncx.author = _etui_epub_text_dup(content, length);
         }
-        else if (pd->ncx.has_navpoint_text)
+        else if (md->ncx.has_navpoint_text)
         {
-            if (pd->ncx.stack[pd->ncx.current_depth])
+            if ((md->ncx.current_depth >= 0) &&
+                md->ncx.stack[md->ncx.current_depth] &&
+                !md->ncx.stack[md->ncx.current_depth]->title)
             {
-                char *label;
-
-                label = (char *)malloc(length + 1);
-                if (label)
-                {
-                    memcpy(label, content, length);
-                    label[length] = '\0';
-                    pd->ncx.stack[pd->ncx.current_depth]->label = label;
-                }
+                md->ncx.stack[md->ncx.current_depth]->title = _etui_epub_text_dup(content, length);
             }
         }
     }
@@ -795,37 +956,42 @@ _etui_epub_ncx_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
     {
         if (strncmp("docTitle", content, strlen("docTitle")) == 0)
         {
-            pd->ncx.has_title = 0;
+            md->ncx.has_title = 0;
         }
         else if (strncmp("docAuthor", content, strlen("docAuthor")) == 0)
         {
-            pd->ncx.has_author = 0;
+            md->ncx.has_author = 0;
         }
         else if (strncmp("navPoint", content, strlen("navPoint")) == 0)
         {
-            pd->ncx.has_navpoint = 0;
-            if (pd->ncx.stack[pd->ncx.current_depth])
-            {
-                if (pd->ncx.current_depth == 0)
-                    eina_array_push(&pd->doc.toc, pd->ncx.stack[pd->ncx.current_depth]);
-                else
-                    eina_array_push(pd->ncx.stack[pd->ncx.current_depth - 1]->child, pd->ncx.stack[pd->ncx.current_depth]);
-            }
-            pd->ncx.current_depth--;
+            Etui_Toc_Item *item;
+
+            if (md->ncx.current_depth < 0)
+                return EINA_FALSE;
+
+            md->ncx.has_navpoint = 0;
+            item = md->ncx.stack[md->ncx.current_depth];
+            if (md->ncx.current_depth == 0)
+                eina_array_push(&md->doc.toc, item);
+            else
+                eina_array_push(md->ncx.stack[md->ncx.current_depth - 1]->child, item);
+            md->ncx.stack[md->ncx.current_depth] = NULL;
+            md->ncx.current_depth--;
         }
         else if (strncmp("navMap", content, strlen("navMap")) == 0)
         {
-            free(pd->ncx.stack);
-            pd->ncx.stack = NULL;
+            free(md->ncx.stack);
+            md->ncx.stack = NULL;
+            md->ncx.has_navmap = 0;
         }
         else if (strncmp("text", content, strlen("text")) == 0)
         {
-            if (pd->ncx.has_title)
-                pd->ncx.has_title_text = 0;
-            if (pd->ncx.has_author)
-                pd->ncx.has_author_text = 0;
-            if (pd->ncx.has_navpoint)
-                pd->ncx.has_navpoint_text = 0;
+            if (md->ncx.has_title)
+                md->ncx.has_title_text = 0;
+            if (md->ncx.has_author)
+                md->ncx.has_author_text = 0;
+            if (md->ncx.has_navpoint)
+                md->ncx.has_navpoint_text = 0;
         }
     }
 
@@ -833,96 +999,112 @@ _etui_epub_ncx_parse_cb(void *data, Eina_Simple_XML_Type type, const char *conte
 }
 
 static Eina_Bool
-_etui_epub_ncx_is_valid(Etui_Provider_Data *pd)
+_etui_epub_ncx_is_valid(Etui_Module_Data *md)
 {
-    char buf[PATH_MAX];
     Etui_Epub_Opf_Manifest_Item *item;
-    Eina_File *f;
-    char *oebps_dir;
+    char *path;
+    char *data;
+    size_t size;
+    Eina_Bool res;
 
-    if (!pd->opf.toc_id)
+    if (!md->opf.toc_id)
         return EINA_FALSE;
 
-    item = eina_hash_find(pd->opf.manifest, pd->opf.toc_id);
+    item = eina_hash_find(md->opf.manifest, md->opf.toc_id);
     if (!item)
         return EINA_FALSE;
 
-    oebps_dir = strdup(pd->container.content_file);
-    if (!oebps_dir)
+    path = _etui_epub_path_resolve(md->opf.dir, item->href);
+    if (!path)
         return EINA_FALSE;
 
-    snprintf(buf, sizeof(buf), "%s/%s/%s", pd->doc.path, dirname(oebps_dir), item->href);
-    buf[sizeof(buf) - 1] = '\0';
-    free(oebps_dir);
-    f = eina_file_open(buf, EINA_FALSE);
-    if (!f)
+    md->ncx.dir = _etui_epub_dir_get(path);
+    data = _etui_epub_entry_get(md, path, &size);
+    free(path);
+    if (!md->ncx.dir || !data)
     {
+        free(data);
         return EINA_FALSE;
     }
 
-    pd->ncx.current_depth = -1;
+    md->ncx.current_depth = -1;
+
+    res = eina_simple_xml_parse(data, size,
+                                EINA_TRUE,
+                                _etui_epub_ncx_parse_cb, md);
+    free(data);
 
-    if (!eina_simple_xml_parse((const char *)eina_file_map_all(f, EINA_FILE_POPULATE),
-                               eina_file_size_get(f),
-                               EINA_TRUE,
-                               _etui_epub_ncx_parse_cb, pd))
+    /* items still on the stack belong to an unterminated navMap */
+    if (md->ncx.stack)
     {
-        eina_file_close(f);
-        return EINA_FALSE;
-    }
+        while (md->ncx.current_depth >= 0)
+        {
+            Etui_Toc_Item *toc_item;
 
-    eina_file_close(f);
+            toc_item = md->ncx.stack[md->ncx.current_depth--];
+            if (toc_item)
+            {
+                free(toc_item->title);
+                free(toc_item);
+            }
+        }
+        free(md->ncx.stack);
+        md->ncx.stack = NULL;
+    }
 
-    return EINA_TRUE;
+    return res;
 }
 
 static Eina_Bool
-_etui_epub_is_valid(Etui_Provider_Data *pd)
+_etui_epub_is_valid(Etui_Module_Data *md)
 {
     /* the mimetype file must exist et has "application/epub+zip" as content */
 
-    if (!_etui_epub_mimetype_is_valid(pd))
+    if (!_etui_epub_mimetype_is_valid(md))
         return EINA_FALSE;
 
     /* then, the file "META-INF/container.xml" mst exist and point to */
     /* the .opf file (usually content.opf) with its relative path if any */
 
-    if (!_etui_epub_container_is_valid(pd))
+    if (!_etui_epub_container_is_valid(md))
         return EINA_FALSE;
 
     /* Then we parse the .opf file to obtain the files of the Epub archive */
 
-    if (!_etui_epub_opf_is_valid(pd))
+    if (!_etui_epub_opf_is_valid(md))
+        return EINA_FALSE;
+
+    if (!_etui_epub_chapters_fill(md))
         return EINA_FALSE;
 
     /* Then, we parse the .ncx file to obtain last checks and the ToC */
 
-    if (!_etui_epub_ncx_is_valid(pd))
+    if (!_etui_epub_ncx_is_valid(md))
         return EINA_FALSE;
 
     /* Finally the latest checks */
 
     /* title of opf and ncx must be the same */
-    printf(" *** title : %s %s\n", pd->opf.title, pd->ncx.title);
-    if (pd->opf.title && pd->ncx.title)
+    DBG("title : %s %s", md->opf.title, md->ncx.title);
+    if (md->opf.title && md->ncx.title)
     {
-        if (strcmp(pd->opf.title, pd->ncx.title) != 0)
+        if (strcmp(md->opf.title, md->ncx.title) != 0)
             return EINA_FALSE;
     }
 
     /* author of opf and ncx must be the same */
-    printf(" *** authors : %s %s\n", pd->opf.author, pd->ncx.author);
-    if (pd->opf.author && pd->ncx.author)
+    DBG("authors : %s %s", md->opf.author, md->ncx.author);
+    if (md->opf.author && md->ncx.author)
     {
-        if (strcmp(pd->opf.author, pd->ncx.author) != 0)
+        if (strcmp(md->opf.author, md->ncx.author) != 0)
             return EINA_FALSE;
     }
 
     /* uuid of opf and ncx must be the same */
-    printf(" *** UUID : %s %s\n", pd->opf.uuid, pd->ncx.uid);
-    if (pd->opf.uuid && pd->ncx.uid)
+    DBG("UUID : %s %s", md->opf.uuid, md->ncx.uid);
+    if (md->opf.uuid && md->ncx.uid)
     {
-        if (strcmp(pd->opf.uuid, pd->ncx.uid) != 0)
+        if (strcmp(md->opf.uuid, md->ncx.uid) != 0)
             return EINA_FALSE;
     }
 
@@ -948,7 +1130,7 @@ _etui_epub_opf_manifest_free_cb(void *data)
 static void
 _etui_epub_toc_unfill(Eina_Array *items, Eina_Bool free_array)
 {
-    Etui_Epub_Ncx_Toc_Item *item;
+    Etui_Toc_Item *item;
     Eina_Array_Iterator iterator;
     unsigned int i;
 
@@ -957,8 +1139,7 @@ _etui_epub_toc_unfill(Eina_Array *items, Eina_Bool free_array)
 
     EINA_ARRAY_ITER_NEXT(items, i, item, iterator)
     {
-        free(item->label);
-        free(item->link);
+        free(item->title);
 
         if (item->child)
             _etui_epub_toc_unfill(item->child, EINA_TRUE);
@@ -970,282 +1151,769 @@ _etui_epub_toc_unfill(Eina_Array *items, Eina_Bool free_array)
         eina_array_free(items);
 }
 
-/* Virtual functions */
+/*
+ * Conversion of the XHTML spine documents to textblock markup. Only the
+ * text and its basic structure (paragraphs, headings, lists, bold and
+ * italic) are kept, styles and images are not supported.
+ */
 
-static void *
-_etui_epub_init(Evas *evas)
+static void
+_etui_epub_markup_tag_get(const char *content, unsigned length, char *tag, size_t size)
 {
-    Etui_Provider_Data *pd;
-
-    pd = (Etui_Provider_Data *)calloc(1, sizeof(Etui_Provider_Data));
-    if (!pd)
-        return NULL;
+    const char *iter;
+    const char *end;
+    size_t l;
 
-    DBG("init module");
+    end = content + length;
+    for (iter = content; iter < end; iter++)
+    {
+        if ((*iter == ' ') || (*iter == '\t') || (*iter == '\n') ||
+            (*iter == '\r') || (*iter == '/') || (*iter == '>'))
+            break;
+        /* the namespace prefix is dropped */
+        if (*iter == ':')
+            content = iter + 1;
+    }
 
-    pd->efl.obj = evas_object_image_add(evas);
-    if (!pd->efl.obj)
-        goto free_pd;
+    l = 0;
+    while ((content < iter) && (l < size - 1))
+    {
+        char c;
 
-    return pd;
+        c = *content++;
+        if ((c >= 'A') && (c <= 'Z'))
+            c += 'a' - 'A';
+        tag[l++] = c;
+    }
+    tag[l] = '\0';
+}
 
-  free_pd:
-    free(pd);
+static Eina_Bool
+_etui_epub_markup_tag_is(const char *tag, const char * const *tags)
+{
+    for (; *tags; tags++)
+    {
+        if (strcmp(tag, *tags) == 0)
+            return EINA_TRUE;
+    }
 
-    return NULL;
+    return EINA_FALSE;
 }
 
 static void
-_etui_epub_shutdown(void *d)
+_etui_epub_markup_paragraph(Etui_Epub_Markup *m)
 {
-    Etui_Provider_Data *pd;
+    if ((eina_strbuf_length_get(m->buf) > 0) && !m->paragraph)
+        eina_strbuf_append(m->buf, "<ps/>");
+    m->paragraph = 1;
+    m->space = 1;
+}
 
-    if (!d)
-        return;
+static Eina_Bool
+_etui_epub_markup_parse_cb(void *data, Eina_Simple_XML_Type type, const char *content, unsigned offset EINA_UNUSED, unsigned length)
+{
+    static const char * const skipped[] = {
+        "head", "style", "script", "title", "svg", NULL
+    };
+    static const char * const blocks[] = {
+        "p", "div", "ul", "ol", "dl", "dt", "dd", "blockquote", "pre",
+        "section", "article", "header", "footer", "aside", "nav",
+        "table", "tr", "figure", "figcaption", "hr", NULL
+    };
+    static const char * const headings[] = {
+        "h1", "h2", "h3", "h4", "h5", "h6", NULL
+    };
+    static const char * const italics[] = {
+        "i", "em", "cite", "dfn", "var", NULL
+    };
+    static const char * const bolds[] = {
+        "b", "strong", NULL
+    };
+    Etui_Epub_Markup *m;
+    char tag[16];
+
+    m = (Etui_Epub_Markup *)data;
+
+    switch (type)
+    {
+        case EINA_SIMPLE_XML_OPEN:
+        case EINA_SIMPLE_XML_OPEN_EMPTY:
+            if (m->skip > 0)
+            {
+                if (type == EINA_SIMPLE_XML_OPEN)
+                    m->skip++;
+                break;
+            }
 
-    DBG("shutdown module");
+            _etui_epub_markup_tag_get(content, length, tag, sizeof(tag));
+            if (strcmp(tag, "body") == 0)
+                m->in_body = 1;
+            else if (!m->in_body)
+                break;
+            else if (_etui_epub_markup_tag_is(tag, skipped))
+            {
+                if (type == EINA_SIMPLE_XML_OPEN)
+                    m->skip = 1;
+            }
+            else if (_etui_epub_markup_tag_is(tag, blocks))
+                _etui_epub_markup_paragraph(m);
+            else if (_etui_epub_markup_tag_is(tag, headings))
+            {
+                _etui_epub_markup_paragraph(m);
+                if (type == EINA_SIMPLE_XML_OPEN)
+                    eina_strbuf_append_printf(m->buf, "<%s>", tag);
+            }
+            else if (strcmp(tag, "li") == 0)
+            {
+                _etui_epub_markup_paragraph(m);
+                eina_strbuf_append(m->buf, "\xe2\x80\xa2 "); /* bullet */
+                m->paragraph = 0;
+            }
+            else if (strcmp(tag, "br") == 0)
+            {
+                eina_strbuf_append(m->buf, "<br/>");
+                m->space = 1;
+            }
+            else if (type == EINA_SIMPLE_XML_OPEN)
+            {
+                if (_etui_epub_markup_tag_is(tag, italics))
+                    eina_strbuf_append(m->buf, "<i>");
+                else if (_etui_epub_markup_tag_is(tag, bolds))
+                    eina_strbuf_append(m->buf, "<b>");
+            }
+            break;
+        case EINA_SIMPLE_XML_CLOSE:
+            if (m->skip > 0)
+            {
+                m->skip--;
+                break;
+            }
 
-    pd = (Etui_Provider_Data *)d;
+            if (!m->in_body)
+                break;
 
-    if (pd->doc.filename)
-      free(pd->doc.filename);
-    evas_object_del(pd->efl.obj);
-    free(pd);
+            _etui_epub_markup_tag_get(content, length, tag, sizeof(tag));
+            if (strcmp(tag, "body") == 0)
+                m->in_body = 0;
+            else if (_etui_epub_markup_tag_is(tag, headings))
+            {
+                eina_strbuf_append_printf(m->buf, "</%s>", tag);
+                _etui_epub_markup_paragraph(m);
+            }
+            else if (_etui_epub_markup_tag_is(tag, blocks) ||
+                     (strcmp(tag, "li") == 0))
+                _etui_epub_markup_paragraph(m);
+            else if (_etui_epub_markup_tag_is(tag, italics))
+                eina_strbuf_append(m->buf, "</i>");
+            else if (_etui_epub_markup_tag_is(tag, bolds))
+                eina_strbuf_append(m->buf, "</b>");
+            break;
+        case EINA_SIMPLE_XML_DATA:
+        {
+            const char *end;
+
+            if (!m->in_body || (m->skip > 0))
+                break;
+
+            /* white spaces are collapsed, the entities are kept as is */
+            end = content + length;
+            for (; content < end; content++)
+            {
+                if ((*content == ' ') || (*content == '\t') ||
+                    (*content == '\n') || (*content == '\r'))
+                {
+                    if (!m->space)
+                        eina_strbuf_append_char(m->buf, ' ');
+                    m->space = 1;
+                }
+                else
+                {
+                    eina_strbuf_append_char(m->buf, *content);
+                    m->space = 0;
+                    m->paragraph = 0;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    return EINA_TRUE;
 }
 
-static Evas_Object *
-_etui_epub_evas_object_get(void *d)
+static char *
+_etui_epub_markup_get(const Etui_Module_Data *md, int chapter)
 {
-    if (!d)
+    Etui_Epub_Markup m;
+    char *data;
+    char *markup;
+    size_t size;
+
+    data = _etui_epub_entry_get(md, md->doc.chapters[chapter].path, &size);
+    if (!data)
         return NULL;
 
-    return ((Etui_Provider_Data *)d)->efl.obj;
+    memset(&m, 0, sizeof(Etui_Epub_Markup));
+    m.buf = eina_strbuf_new();
+    if (!m.buf)
+    {
+        free(data);
+        return NULL;
+    }
+
+    m.space = 1;
+    m.paragraph = 1;
+    if (!eina_simple_xml_parse(data, size, EINA_FALSE,
+                               _etui_epub_markup_parse_cb, &m))
+        WRN("spine document %s is not well formed",
+            md->doc.chapters[chapter].path);
+    free(data);
+
+    markup = eina_strbuf_string_steal(m.buf);
+    eina_strbuf_free(m.buf);
+
+    return markup;
 }
 
-static Eina_Bool
-_manifest_foreach_cb(const Eina_Hash *manifest EINA_UNUSED,
-                     const void *key EINA_UNUSED,
-                     void *data, void *fdata EINA_UNUSED)
+/* Pagination */
+
+static int
+_etui_epub_chapter_pages_count(const Etui_Module_Data *md, int chapter)
 {
-   const Etui_Epub_Opf_Manifest_Item *item = data;
+    const Etui_Epub_Chapter *c;
+    int count;
 
-   printf(" %s %s %s\n", item->id, item->href, item ->media_type);
+    c = md->doc.chapters + chapter;
 
-   return EINA_TRUE;
+    /*
+     * a chapter laid out at another scale keeps its number of pages,
+     * as the font and the page are scaled together
+     */
+    if (c->pages_nbr > 0)
+        return c->pages_nbr;
+
+    count = (int)((c->zip_entry->size + ETUI_EPUB_BYTES_PER_PAGE - 1) / ETUI_EPUB_BYTES_PER_PAGE);
+
+    return (count > 0) ? count : 1;
 }
 
-static Eina_Bool
-_print(const void *container EINA_UNUSED, void *data, void *fdata EINA_UNUSED)
+static int
+_etui_epub_page_num_get(const Etui_Module_Data *md, int chapter, int local)
 {
-  printf("%s\n", (char *)data);
-  return EINA_TRUE;
+    int page_num;
+    int i;
+
+    page_num = local;
+    for (i = 0; i < chapter; i++)
+        page_num += _etui_epub_chapter_pages_count(md, i);
+
+    return page_num;
 }
 
-static Eina_Bool
-_print_toc(const void *container EINA_UNUSED, void *data, void *fdata EINA_UNUSED)
+static void
+_etui_epub_page_locate(const Etui_Module_Data *md, int page_num, int *chapter, int *local)
 {
-  char buf[1024];
-  int i;
-  Etui_Epub_Ncx_Toc_Item *item = (Etui_Epub_Ncx_Toc_Item *)data;
-  static int d = 0;
+    int i;
 
-  d++;
-  for (i = 0; i < 2*d; i++)
-    buf[i] = ' ';
-  buf[i] = '\0';
-  printf("%s%s (%s)\n", buf, item->label, item->link);
-  if (item->child)
+    for (i = 0; i < md->doc.page_nbr - 1; i++)
     {
-      eina_array_foreach(item->child, _print_toc, NULL);
+        int count;
+
+        count = _etui_epub_chapter_pages_count(md, i);
+        if (page_num < count)
+            break;
+        page_num -= count;
     }
-  d--;
-  return EINA_TRUE;
+
+    *chapter = i;
+    *local = page_num;
 }
 
 static Eina_Bool
-_etui_epub_file_open(void *d, const char *filename)
+_etui_epub_layout_canvas_new(Etui_Module_Data *md)
 {
-    Etui_Provider_Data *pd;
+    Evas *evas;
 
-    if (!d || !filename || !*filename)
+    md->layout.ee = ecore_evas_buffer_new(ETUI_EPUB_PAGE_WIDTH,
+                                          ETUI_EPUB_PAGE_HEIGHT);
+    if (!md->layout.ee)
+    {
+        ERR("Can not create the canvas of the EPUB layout");
         return EINA_FALSE;
+    }
+
+    evas = ecore_evas_get(md->layout.ee);
+
+    md->layout.bg = evas_object_rectangle_add(evas);
+    evas_object_color_set(md->layout.bg, 255, 255, 255, 255);
+    evas_object_show(md->layout.bg);
+
+    /* hides the first line of the next page */
+    md->layout.clip = evas_object_rectangle_add(evas);
+    evas_object_color_set(md->layout.clip, 255, 255, 255, 255);
+    evas_object_show(md->layout.clip);
+
+    md->layout.tb = evas_object_textblock_add(evas);
+    evas_object_clip_set(md->layout.tb, md->layout.clip);
+    evas_object_show(md->layout.tb);
+
+    md->layout.style = evas_textblock_style_new();
+    md->layout.chapter = -1;
+
+    return EINA_TRUE;
+}
+
+static void
+_etui_epub_layout_canvas_free(Etui_Module_Data *md)
+{
+    if (!md->layout.ee)
+        return;
+
+    evas_textblock_style_free(md->layout.style);
+    ecore_evas_free(md->layout.ee);
+    md->layout.ee = NULL;
+}
+
+static void
+_etui_epub_layout_style_set(Etui_Module_Data *md, double scale)
+{
+    /* relative sizes of the headings, from CSS */
+    static const double headings[] = { 2.0, 1.5, 1.17, 1.0, 0.83, 0.67 };
+    Eina_Strbuf *buf;
+    int font_size;
+    int i;
+
+    if (md->layout.scale == scale)
+        return;
 
-    DBG("open file %s", filename);
+    buf = eina_strbuf_new();
+    if (!buf)
+        return;
 
-    pd = (Etui_Provider_Data *)d;
+    font_size = (int)(ETUI_EPUB_FONT_SIZE * scale + 0.5);
+    eina_strbuf_append_printf(buf,
+                              "DEFAULT='font=Serif font_size=%d color=#000000 wrap=word'"
+                              "br='\n'"
+                              "ps='ps'"
+                              "b='+ font_weight=Bold'"
+                              "i='+ font_style=Italic'",
+                              font_size > 0 ? font_size : 1);
+    for (i = 0; i < 6; i++)
+        eina_strbuf_append_printf(buf, "h%d='+ font_size=%d font_weight=Bold'",
+                                  i + 1, (int)(font_size * headings[i] + 0.5));
+
+    evas_textblock_style_set(md->layout.style, eina_strbuf_string_get(buf));
+    evas_object_textblock_style_set(md->layout.tb, md->layout.style);
+    eina_strbuf_free(buf);
+
+    md->layout.scale = scale;
+}
 
-    if (pd->doc.filename && (strcmp(filename, pd->doc.filename) == 0))
-      return EINA_TRUE;
+/* sets the markup of chapter in the textblock, at the scale of the page */
+static Eina_Bool
+_etui_epub_layout_chapter_set(Etui_Module_Data *md, int chapter)
+{
+    Etui_Epub_Chapter *c;
+    int margin;
 
-    if (pd->doc.filename)
-        free(pd->doc.filename);
-    pd->doc.filename = strdup(filename);
-    if (!pd->doc.filename)
+    if (!md->layout.ee && !_etui_epub_layout_canvas_new(md))
         return EINA_FALSE;
 
-    pd->opf.manifest = eina_hash_string_superfast_new(_etui_epub_opf_manifest_free_cb);
-    if (!pd->opf.manifest)
-        goto free_filename;
+    c = md->doc.chapters + chapter;
+    if (!c->markup)
+    {
+        c->markup = _etui_epub_markup_get(md, chapter);
+        if (!c->markup)
+            return EINA_FALSE;
+        if (md->layout.chapter == chapter)
+            md->layout.chapter = -1;
+    }
+
+    if (md->layout.scale != md->page.scale)
+    {
+        _etui_epub_layout_style_set(md, md->page.scale);
+        md->layout.chapter = -1;
+    }
+
+    if (md->layout.chapter != chapter)
+    {
+        margin = (int)(ETUI_EPUB_PAGE_MARGIN * md->page.scale + 0.5);
+        evas_object_resize(md->layout.tb,
+                           (int)(ETUI_EPUB_PAGE_WIDTH * md->page.scale + 0.5) - 2 * margin,
+                           (int)(ETUI_EPUB_PAGE_HEIGHT * md->page.scale + 0.5) - 2 * margin);
+        evas_object_textblock_text_markup_set(md->layout.tb, c->markup);
+        md->layout.chapter = chapter;
+    }
+
+    return EINA_TRUE;
+}
+
+static Eina_Bool
+_etui_epub_chapter_break_add(Etui_Epub_Chapter *c, int top)
+{
+    if ((c->pages_nbr % 16) == 0)
+    {
+        int *tmp;
 
-    pd->opf.spine = eina_array_new(4);
-    if (!pd->opf.spine)
-        goto free_manifest;
+        tmp = (int *)realloc(c->breaks, (c->pages_nbr + 16) * sizeof(int));
+        if (!tmp)
+            return EINA_FALSE;
+        c->breaks = tmp;
+    }
 
-    if (!_etui_epub_file_unzip(pd))
-        goto free_spine;
+    c->breaks[c->pages_nbr++] = top;
 
-    while (eina_array_count(&pd->doc.toc))
-        free(eina_array_pop(&pd->doc.toc));
-    eina_array_step_set(&pd->doc.toc, sizeof(Eina_Array), 4);
+    return EINA_TRUE;
+}
 
-    if (!_etui_epub_is_valid(pd))
-        goto remove_files;
+/*
+ * Splits the chapter in pages at line boundaries. It is done again only
+ * when the chapter is displayed at another scale.
+ */
+static Eina_Bool
+_etui_epub_chapter_layout(Etui_Module_Data *md, int chapter)
+{
+    Etui_Epub_Chapter *c;
+    Evas_Coord ly;
+    Evas_Coord lh;
+    int height;
+    int top;
+    int line;
+
+    c = md->doc.chapters + chapter;
+    if ((c->pages_nbr > 0) && (c->scale == md->page.scale))
+        return EINA_TRUE;
+
+    if (!_etui_epub_layout_chapter_set(md, chapter))
+        return EINA_FALSE;
 
+    DBG("lay out chapter %d (%s)", chapter, c->path);
+
+    height = (int)(ETUI_EPUB_PAGE_HEIGHT * md->page.scale + 0.5) -
+        2 * (int)(ETUI_EPUB_PAGE_MARGIN * md->page.scale + 0.5);
+    evas_object_textblock_size_formatted_get(md->layout.tb, NULL, NULL);
+
+    c->pages_nbr = 0;
+    top = 0;
+    if (!_etui_epub_chapter_break_add(c, top))
+        return EINA_FALSE;
+
+    for (line = 0;
+         evas_object_textblock_line_number_geometry_get(md->layout.tb, line,
+                                                        NULL, &ly, NULL, &lh);
+         line++)
     {
-        printf("\n\n");
-        printf(" * full path : %s\n", pd->container.content_file);
-        printf(" * manifest :\n");
-        eina_hash_foreach(pd->opf.manifest, _manifest_foreach_cb, NULL);
-        printf(" * spine :\n");
-        eina_array_foreach(pd->opf.spine, _print, NULL);
-        printf(" * toc :\n");
-        eina_array_foreach(&pd->doc.toc, _print_toc, NULL);
+        /* a line that does not fit starts the next page */
+        if ((ly + lh - top > height) && (ly > top))
+        {
+            top = ly;
+            if (!_etui_epub_chapter_break_add(c, top))
+            {
+                c->pages_nbr = 0;
+                return EINA_FALSE;
+            }
+        }
     }
 
+    c->scale = md->page.scale;
+
     return EINA_TRUE;
+}
+
+/*
+ * Lays out the current chapter and the ones around it, the markup of
+ * the other chapters is released.
+ */
+static void
+_etui_epub_chapters_layout(Etui_Module_Data *md)
+{
+    int i;
 
-  remove_files:
-    printf("merde\n");
-    ecore_file_recursive_rm(pd->doc.path);
-    eina_tmpstr_del(pd->doc.path);
-  free_spine:
-    eina_array_free(pd->opf.spine);
-  free_manifest:
-    eina_hash_free(pd->opf.manifest);
-  free_filename:
-    free(pd->doc.filename);
-    pd->doc.filename = NULL;
-
-  return EINA_FALSE;
+    for (i = 0; i < md->doc.page_nbr; i++)
+    {
+        if ((i < md->page.chapter - ETUI_EPUB_LAYOUT_AROUND) ||
+            (i > md->page.chapter + ETUI_EPUB_LAYOUT_AROUND))
+        {
+            free(md->doc.chapters[i].markup);
+            md->doc.chapters[i].markup = NULL;
+            if (md->layout.chapter == i)
+                md->layout.chapter = -1;
+        }
+    }
+
+    /* the current chapter is the last one set in the textblock */
+    for (i = md->page.chapter - ETUI_EPUB_LAYOUT_AROUND; i <= md->page.chapter + ETUI_EPUB_LAYOUT_AROUND; i++)
+    {
+        if ((i >= 0) && (i < md->doc.page_nbr) && (i != md->page.chapter))
+            _etui_epub_chapter_layout(md, i);
+    }
+    _etui_epub_chapter_layout(md, md->page.chapter);
 }
 
 static void
-_etui_epub_file_close(void *d)
+_etui_epub_pixels_copy(unsigned int *dst, const unsigned int *src, int width, int height, Etui_Rotation rotation)
 {
-    Etui_Provider_Data *pd;
+    int x;
+    int y;
 
-    if (!d)
-        return;
+    switch (rotation)
+    {
+        case ETUI_ROTATION_90:
+            for (y = 0; y < height; y++)
+                for (x = 0; x < width; x++)
+                    dst[x * height + (height - 1 - y)] = src[y * width + x];
+            break;
+        case ETUI_ROTATION_180:
+            for (y = 0; y < height; y++)
+                for (x = 0; x < width; x++)
+                    dst[(height - 1 - y) * width + (width - 1 - x)] = src[y * width + x];
+            break;
+        case ETUI_ROTATION_270:
+            for (y = 0; y < height; y++)
+                for (x = 0; x < width; x++)
+                    dst[(width - 1 - x) * height + y] = src[y * width + x];
+            break;
+        default:
+            memcpy(dst, src, (size_t)width * height * sizeof(unsigned int));
+            break;
+    }
+}
 
-    pd = (Etui_Provider_Data *)d;
+static void
+_etui_epub_doc_free(Etui_Module_Data *md)
+{
+    int i;
 
-    DBG("close file %s", pd->doc.filename);
+    _etui_epub_toc_unfill(&md->doc.toc, EINA_FALSE);
+    eina_array_flush(&md->doc.toc);
 
-    _etui_epub_toc_unfill(&pd->doc.toc, EINA_FALSE);
-    eina_array_flush(&pd->doc.toc);
+    free(md->ncx.title);
+    free(md->ncx.author);
+    free(md->ncx.dir);
+    for (i = 0; i < 2; i++)
+    {
+        free(md->ncx.meta_items[i].name);
+        free(md->ncx.meta_items[i].content);
+    }
 
-    free(pd->ncx.title);
-    free(pd->ncx.author);
-    free(pd->ncx.meta_items[pd->ncx.meta_item_to_free].content);
+    free(md->opf.toc_id);
+    free(md->opf.title);
+    free(md->opf.author);
+    free(md->opf.uuid);
+    free(md->opf.dir);
 
-    free(pd->opf.toc_id);
-    free(pd->opf.title);
-    free(pd->opf.author);
+    if (md->opf.spine)
+    {
+        while (eina_array_count(md->opf.spine))
+            free(eina_array_pop(md->opf.spine));
+        eina_array_free(md->opf.spine);
+    }
 
-    while (eina_array_count(pd->opf.spine))
-        free(eina_array_pop(pd->opf.spine));
-    eina_array_free(pd->opf.spine);
+    if (md->opf.manifest)
+        eina_hash_free(md->opf.manifest);
 
-    eina_hash_free(pd->opf.manifest);
+    free(md->container.content_file);
 
-    free(pd->container.content_file);
+    for (i = 0; i < md->doc.page_nbr; i++)
+    {
+        free(md->doc.chapters[i].path);
+        free(md->doc.chapters[i].markup);
+        free(md->doc.chapters[i].breaks);
+    }
+    free(md->doc.chapters);
 
-    ecore_file_recursive_rm(pd->doc.path);
-    eina_tmpstr_del(pd->doc.path);
+    _etui_epub_layout_canvas_free(md);
 
-    if (pd->doc.filename)
-        free(pd->doc.filename);
-    pd->doc.filename = NULL;
+    etui_zip_free(md->doc.zip);
+    free(md->doc.filename);
 }
 
-static void
-_etui_epub_version_get(void *d EINA_UNUSED, int *maj, int *min)
+/* Virtual functions */
+
+static void *
+_etui_epub_init(const Etui_File *ef)
 {
-    if (maj) *maj = 0;
-    if (min) *min = 0;
+    Etui_Module_Data *md;
+
+    md = (Etui_Module_Data *)calloc(1, sizeof(Etui_Module_Data));
+    if (!md)
+        return NULL;
+
+    DBG("init module");
+
+    md->doc.filename = strdup(etui_file_filename_get(ef));
+    md->doc.data = etui_file_base_get(ef);
+    md->doc.size = etui_file_size_get(ef);
+    if (!md->doc.data)
+    {
+        ERR("Can not map EPUB file %s", etui_file_filename_get(ef));
+        goto free_md;
+    }
+
+    /* only the central directory is read, entries are inflated on demand */
+    md->doc.zip = etui_zip_new(md->doc.data, md->doc.size);
+    if (!md->doc.zip)
+    {
+        ERR("Can not read the central directory of %s", md->doc.filename);
+        goto free_md;
+    }
+
+    md->opf.manifest = eina_hash_string_superfast_new(_etui_epub_opf_manifest_free_cb);
+    if (!md->opf.manifest)
+        goto free_md;
+
+    md->opf.spine = eina_array_new(4);
+    if (!md->opf.spine)
+        goto free_md;
+
+    eina_array_step_set(&md->doc.toc, sizeof(Eina_Array), 4);
+
+    if (!_etui_epub_is_valid(md))
+    {
+        ERR("Can not open EPUB file %s", md->doc.filename);
+        goto free_md;
+    }
+
+    md->page.page_num = -1;
+    md->page.chapter = -1;
+    md->page.rotation = ETUI_ROTATION_0;
+    md->page.scale = 1.0f;
+
+    return md;
+
+  free_md:
+    _etui_epub_doc_free(md);
+    free(md);
+
+    return NULL;
 }
 
-static char *
-_etui_epub_title_get(void *d)
+static void
+_etui_epub_shutdown(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
+
+    DBG("shutdown module");
 
+    if (!d)
+        return;
+
+    md = (Etui_Module_Data *)d;
+
+    _etui_epub_doc_free(md);
+    free(md);
+}
+
+static Evas_Object *
+_etui_epub_evas_object_add(void *d, Evas *evas)
+{
     if (!d)
         return NULL;
 
-    pd = (Etui_Provider_Data *)d;
+    ((Etui_Module_Data *)d)->efl.obj = evas_object_image_add(evas);
+    return ((Etui_Module_Data *)d)->efl.obj;
+}
+
+static void
+_etui_epub_evas_object_del(void *d)
+{
+    if (!d)
+        return;
 
-    return strdup(pd->opf.title);
+    evas_object_del(((Etui_Module_Data *)d)->efl.obj);
 }
 
-static char *
-_etui_epub_author_get(void *d)
+static const void *
+_etui_epub_info_get(void *d EINA_UNUSED)
 {
-    Etui_Provider_Data *pd;
+    return NULL;
+}
+
+static const char *
+_etui_epub_title_get(void *d)
+{
+    Etui_Module_Data *md;
 
     if (!d)
         return NULL;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    return strdup(pd->opf.author);
+    return md->opf.title ? md->opf.title : md->doc.filename;
 }
 
+/*
+ * The number of pages changes when a chapter is laid out, as it is
+ * estimated from the size of the chapters that are not laid out yet.
+ */
 static int
 _etui_epub_pages_count(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return -1;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    return eina_array_count(pd->opf.spine);
+    return _etui_epub_page_num_get(md, md->doc.page_nbr, 0);
+}
+
+static void
+_etui_epub_toc_pages_update(const Etui_Module_Data *md, Eina_Array *items)
+{
+    Etui_Toc_Item *item;
+    Eina_Array_Iterator iterator;
+    unsigned int i;
+
+    if (!items)
+        return;
+
+    EINA_ARRAY_ITER_NEXT(items, i, item, iterator)
+    {
+        if (item->dest.goto_.chapter >= 0)
+            item->dest.goto_.page = _etui_epub_page_num_get(md, item->dest.goto_.chapter, 0);
+        _etui_epub_toc_pages_update(md, item->child);
+    }
 }
 
 static const Eina_Array *
 _etui_epub_toc_get(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return NULL;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
+
+    /* the first page of the chapters depends on the layout */
+    _etui_epub_toc_pages_update(md, &md->doc.toc);
 
-    return &pd->doc.toc;
+    return &md->doc.toc;
 }
 
 static Eina_Bool
 _etui_epub_page_set(void *d, int page_num)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return EINA_FALSE;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    if ((page_num < 0) || (page_num >= (int)eina_array_count(pd->opf.spine)))
+    if ((page_num < 0) || (page_num >= _etui_epub_pages_count(md)))
         return EINA_FALSE;
 
-    if (page_num == pd->page.page_num)
+    if (page_num == md->page.page_num)
         return EINA_FALSE;
 
-    pd->page.page_num = page_num;
-    pd->page.rotation = ETUI_ROTATION_0;
-    pd->page.scale = 1.0f;
+    _etui_epub_page_locate(md, page_num, &md->page.chapter, &md->page.local);
+    md->page.page_num = page_num;
+    md->page.rotation = ETUI_ROTATION_0;
+    md->page.scale = 1.0f;
 
     return EINA_TRUE;
 }
@@ -1253,30 +1921,50 @@ _etui_epub_page_set(void *d, int page_num)
 static int
 _etui_epub_page_get(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return -1;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    return pd->page.page_num;
+    return md->page.page_num;
+}
+
+static void
+_etui_epub_page_size_get(void *d, int *width, int *height)
+{
+    if (!d)
+        goto _err;
+
+    /*
+     * the page box, neither scaled nor rotated: the image is empty before
+     * the first rendering and is already scaled after it
+     */
+    if (width) *width = ETUI_EPUB_PAGE_WIDTH;
+    if (height) *height = ETUI_EPUB_PAGE_HEIGHT;
+
+    return;
+
+  _err:
+    if (width) *width = 0;
+    if (height) *height = 0;
 }
 
 static Eina_Bool
 _etui_epub_page_rotation_set(void *d, Etui_Rotation rotation)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return EINA_FALSE;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    if (pd->page.rotation == rotation)
+    if (md->page.rotation == rotation)
         return EINA_TRUE;
 
-    pd->page.rotation = rotation;
+    md->page.rotation = rotation;
 
     return EINA_TRUE;
 }
@@ -1284,27 +1972,27 @@ _etui_epub_page_rotation_set(void *d, Etui_Rotation rotation)
 static Etui_Rotation
 _etui_epub_page_rotation_get(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return ETUI_ROTATION_0;
 
-    pd = (Etui_Provider_Data *)d;
-    return pd->page.rotation;
+    md = (Etui_Module_Data *)d;
+    return md->page.rotation;
 }
 
 static Eina_Bool
 _etui_epub_page_scale_set(void *d, double scale)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
         return EINA_FALSE;
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
 
-    if (pd->page.scale != scale)
-      pd->page.scale = scale;
+    if (md->page.scale != scale)
+      md->page.scale = scale;
 
     return EINA_TRUE;
 }
@@ -1312,68 +2000,155 @@ _etui_epub_page_scale_set(void *d, double scale)
 static double
 _etui_epub_page_scale_get(void *d)
 {
-    Etui_Provider_Data *pd;
+    Etui_Module_Data *md;
 
     if (!d)
     {
         return -1.0;
     }
 
-    pd = (Etui_Provider_Data *)d;
+    md = (Etui_Module_Data *)d;
+
+    return md->page.scale;
+}
+
+/*
+ * The page is laid out and rasterised here, in the main loop, because
+ * of Evas. The chapters around it are laid out too, which may change
+ * the number of the current page.
+ */
+static void
+_etui_epub_page_render_pre(void *d)
+{
+    Etui_Module_Data *md;
+    Etui_Epub_Chapter *c;
+    const unsigned int *pixels;
+    int width;
+    int height;
+    int margin;
+    int bottom;
+    int fh;
+
+    if (!d)
+        return;
+
+    DBG("render pre");
+
+    md = (Etui_Module_Data *)d;
+
+    if (md->page.chapter < 0)
+        return;
+
+    _etui_epub_chapters_layout(md);
+
+    c = md->doc.chapters + md->page.chapter;
+    if (c->pages_nbr == 0)
+    {
+        ERR("Can not lay out chapter %s", c->path);
+        return;
+    }
+
+    /* the estimation of the pages count of the chapter may be wrong */
+    if (md->page.local >= c->pages_nbr)
+        md->page.local = c->pages_nbr - 1;
+    md->page.page_num = _etui_epub_page_num_get(md, md->page.chapter, md->page.local);
+
+    if (!_etui_epub_layout_chapter_set(md, md->page.chapter))
+        return;
+
+    width = (int)(ETUI_EPUB_PAGE_WIDTH * md->page.scale + 0.5);
+    height = (int)(ETUI_EPUB_PAGE_HEIGHT * md->page.scale + 0.5);
+    margin = (int)(ETUI_EPUB_PAGE_MARGIN * md->page.scale + 0.5);
+
+    evas_object_textblock_size_formatted_get(md->layout.tb, NULL, &fh);
+    if (md->page.local + 1 < c->pages_nbr)
+        bottom = c->breaks[md->page.local + 1];
+    else
+        bottom = fh;
+
+    ecore_evas_resize(md->layout.ee, width, height);
+    evas_object_resize(md->layout.bg, width, height);
+    evas_object_move(md->layout.tb, margin, margin - c->breaks[md->page.local]);
+    evas_object_resize(md->layout.tb, width - 2 * margin, fh);
+    evas_object_move(md->layout.clip, margin, margin);
+    evas_object_resize(md->layout.clip, width - 2 * margin,
+                       bottom - c->breaks[md->page.local]);
+
+    pixels = (const unsigned int *)ecore_evas_buffer_pixels_get(md->layout.ee);
+    if (!pixels)
+    {
+        ERR("Can not render page %d of chapter %s", md->page.local, c->path);
+        return;
+    }
+
+    if ((md->page.rotation == ETUI_ROTATION_90) ||
+        (md->page.rotation == ETUI_ROTATION_270))
+        evas_object_image_size_set(md->efl.obj, height, width);
+    else
+        evas_object_image_size_set(md->efl.obj, width, height);
+    evas_object_image_filled_set(md->efl.obj, EINA_TRUE);
+    md->efl.m = evas_object_image_data_get(md->efl.obj, 1);
+    if (!md->efl.m)
+        return;
 
-    return pd->page.scale;
+    _etui_epub_pixels_copy((unsigned int *)md->efl.m, pixels,
+                           width, height, md->page.rotation);
+    evas_object_image_size_get(md->efl.obj, &md->page.width, &md->page.height);
 }
 
-static Etui_Provider_Descriptor _etui_provider_descriptor_epub =
-{
-    /* .name                          */ "epub",
-    /* .version                       */ ETUI_PROVIDER_DESCRIPTOR_VERSION,
-    /* .priority                      */ ETUI_PROVIDER_DESCRIPTOR_PRIORITY_NORMAL,
-    /* .init                          */ _etui_epub_init,
-    /* .shutdown                      */ _etui_epub_shutdown,
-    /* .evas_object_get               */ _etui_epub_evas_object_get,
-    /* .file_open                     */ _etui_epub_file_open,
-    /* .file_close                    */ _etui_epub_file_close,
-    /* .version_get                   */ _etui_epub_version_get,
-    /* .title_get                     */ _etui_epub_title_get,
-    /* .author_get                    */ _etui_epub_author_get,
-    /* .subject_get                   */ NULL,
-    /* .keywords_get                  */ NULL,
-    /* .creator_get                   */ NULL,
-    /* .producer_get                  */ NULL,
-    /* .creation_date_get             */ NULL,
-    /* .modification_date_get         */ NULL,
-    /* .is_printable                  */ NULL,
-    /* .is_changeable                 */ NULL,
-    /* .is_copyable                   */ NULL,
-    /* .is_notable                    */ NULL,
-    /* .password_needed               */ NULL,
-    /* .password_set                  */ NULL,
-    /* .pages_count                   */ _etui_epub_pages_count,
-    /* .toc_get                       */ _etui_epub_toc_get,
-    /* .page_use_display_list_set     */ NULL,
-    /* .page_use_display_list_get     */ NULL,
-    /* .page_set                      */ _etui_epub_page_set,
-    /* .page_get                      */ _etui_epub_page_get,
-    /* .page_size_get                 */ NULL,//_etui_epub_page_size_get,
-    /* .page_rotation_set             */ _etui_epub_page_rotation_set,
-    /* .page_rotation_get             */ _etui_epub_page_rotation_get,
-    /* .page_scale_set                */ _etui_epub_page_scale_set,
-    /* .page_scale_get                */ _etui_epub_page_scale_get,
-    /* .page_dpi_set                  */ NULL,
-    /* .page_dpi_get                  */ NULL,
-    /* .page_links_get                */ NULL,
-    /* .page_render_pre               */ NULL,//_etui_epub_page_render_pre,
-    /* .page_render                   */ NULL,//_etui_epub_page_render,
-    /* .page_render_end               */ NULL,//_etui_epub_page_render_end,
-    /* .page_text_extract             */ NULL,
-    /* .page_text_find                */ NULL,
-    /* .page_duration_get             */ NULL,
-    /* .page_transition_type_get      */ NULL,
-    /* .page_transition_duration_get  */ NULL,
-    /* .page_transition_vertical_get  */ NULL,
-    /* .page_transition_outwards_get  */ NULL,
-    /* .page_transition_direction_get */ NULL
+static void
+_etui_epub_page_render(void *d, const Etui_Module_Cancel *cancel EINA_UNUSED)
+{
+    if (!d)
+        return;
+
+    /* the page is rasterised by _etui_epub_page_render_pre() */
+    DBG("render");
+}
+
+static void
+_etui_epub_page_render_end(void *d)
+{
+    Etui_Module_Data *md;
+    int width;
+    int height;
+
+    if (!d)
+        return;
+
+    DBG("render end");
+
+    md = (Etui_Module_Data *)d;
+
+    evas_object_image_size_get(md->efl.obj, &width, &height);
+    evas_object_image_data_set(md->efl.obj, md->efl.m);
+    evas_object_image_data_update_add(md->efl.obj, 0, 0, width, height);
+}
+
+static Etui_Module_Func _etui_module_func_epub =
+{
+    /* .init              */ _etui_epub_init,
+    /* .shutdown          */ _etui_epub_shutdown,
+    /* .evas_object_add   */ _etui_epub_evas_object_add,
+    /* .evas_object_del   */ _etui_epub_evas_object_del,
+    /* .info_get          */ _etui_epub_info_get,
+    /* .title_get         */ _etui_epub_title_get,
+    /* .pages_count       */ _etui_epub_pages_count,
+    /* .toc_get           */ _etui_epub_toc_get,
+    /* .page_set          */ _etui_epub_page_set,
+    /* .page_get          */ _etui_epub_page_get,
+    /* .page_size_get     */ _etui_epub_page_size_get,
+    /* .page_rotation_set */ _etui_epub_page_rotation_set,
+    /* .page_rotation_get */ _etui_epub_page_rotation_get,
+    /* .page_scale_set    */ _etui_epub_page_scale_set,
+    /* .page_scale_get    */ _etui_epub_page_scale_get,
+    /* .page_render_pre   */ _etui_epub_page_render_pre,
+    /* .page_render       */ _etui_epub_page_render,
+    /* .page_render_end   */ _etui_epub_page_render_end,
+    /* .api_get           */ NULL,
+    /* .page_raster_size  */ NULL,
+    /* .page_raster       */ NULL,
+    /* .page_text_get     */ NULL
 };
 
 /**
@@ -1385,8 +2160,10 @@ static Etui_Provider_Descriptor _etui_provider_descriptor_epub =
  *                                 Global                                     *
  *============================================================================*/
 
-Eina_Bool
-etui_module_epub_init(void)
+/**** module API access ****/
+
+static Eina_Bool
+module_open(Etui_Module *em)
 {
     if (_etui_module_epub_init_count > 0)
     {
@@ -1394,32 +2171,35 @@ etui_module_epub_init(void)
         return EINA_TRUE;
     }
 
+    if (!em)
+        return EINA_FALSE;
+
     _etui_module_epub_log_domain = eina_log_domain_register("etui-epub",
                                                             ETUI_MODULE_EPUB_DEFAULT_LOG_COLOR);
     if (_etui_module_epub_log_domain < 0)
     {
-        EINA_LOG_CRIT("Could not register log domain 'etui-epub'");
+        EINA_LOG_ERR("Can not create a module log domain.");
         return EINA_FALSE;
     }
 
-    if (!etui_module_register(&_etui_provider_descriptor_epub))
+    /* inititialize external libraries here */
+
+    if (!ecore_evas_init())
     {
-        ERR("Could not register module %p", &_etui_provider_descriptor_epub);
-        goto unregister_log;
+        ERR("Can not initialize Ecore_Evas.");
+        eina_log_domain_unregister(_etui_module_epub_log_domain);
+        _etui_module_epub_log_domain = -1;
+        return EINA_FALSE;
     }
 
+    em->functions = (void *)(&_etui_module_func_epub);
+
     _etui_module_epub_init_count = 1;
     return EINA_TRUE;
-
-  unregister_log:
-    eina_log_domain_unregister(_etui_module_epub_log_domain);
-    _etui_module_epub_log_domain = -1;
-
-    return EINA_FALSE;
 }
 
-void
-etui_module_epub_shutdown(void)
+static void
+module_close(Etui_Module *em EINA_UNUSED)
 {
     if (_etui_module_epub_init_count > 1)
     {
@@ -1434,19 +2214,32 @@ etui_module_epub_shutdown(void)
 
     DBG("shutdown epub module");
 
-    _etui_module_epub_init_count = 0;
+    /* documents are shut down by etui_file_free() */
+
+    /* shutdown external libraries here */
+
+    /* shutdown EFL here */
 
-    etui_module_unregister(&_etui_provider_descriptor_epub);
+    ecore_evas_shutdown();
 
     eina_log_domain_unregister(_etui_module_epub_log_domain);
     _etui_module_epub_log_domain = -1;
+    _etui_module_epub_init_count = 0;
 }
 
-#ifndef ETUI_BUILD_STATIC_EPUB
+static Etui_Module_Api _etui_modapi =
+{
+    "epub",
+    {
+        module_open,
+        module_close
+    }
+};
 
-EINA_MODULE_INIT(etui_module_epub_init);
-EINA_MODULE_SHUTDOWN(etui_module_epub_shutdown);
+ETUI_MODULE_DEFINE(epub)
 
+#ifndef ETUI_BUILD_STATIC_EPUB
+ETUI_EINA_MODULE_DEFINE(epub);
 #endif
 
 /*============================================================================*
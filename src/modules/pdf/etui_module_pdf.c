@@ -17,6 +17,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <Eina.h>
 #include <Ecore.h> /* for Ecore_Thread in Etui_Module */
 #include <Evas.h>
@@ -67,7 +69,20 @@
 #endif
 #define CRIT(...) EINA_LOG_DOM_CRIT(_etui_module_pdf_log_domain, __VA_ARGS__)
 
+/* a page is split in at most ETUI_PDF_BANDS_MAX bands drawn in parallel */
+#define ETUI_PDF_BANDS_MAX 32
+/* bands are not smaller than ETUI_PDF_BAND_HEIGHT_MIN rows */
+#define ETUI_PDF_BAND_HEIGHT_MIN 64
+/* display lists kept for the last drawn pages */
+#define ETUI_PDF_LISTS_MAX 8
+/* delay in seconds between two checks of the cancellation of a drawing */
+#define ETUI_PDF_CANCEL_POLL 0.01
+
 typedef struct _Etui_Module_Data Etui_Module_Data;
+typedef struct _Etui_Pdf_Band Etui_Pdf_Band;
+typedef struct _Etui_Pdf_Pool Etui_Pdf_Pool;
+typedef struct _Etui_Pdf_Worker Etui_Pdf_Worker;
+typedef struct _Etui_Pdf_List Etui_Pdf_List;
 
 struct _Etui_Module_Data
 {
@@ -90,14 +105,19 @@ struct _Etui_Module_Data
         char *title;
         fz_context *ctx;
         fz_document *doc;
+        /* locks shared by ctx and its clones */
+        fz_locks_context locks_ctx;
+        Eina_Lock locks[FZ_LOCK_MAX];
+        /* display lists of the pages, most recently used first */
+        Eina_Inlist *lists;
+        int lists_nbr;
+        Etui_Pdf_Pool *pool; /* NULL until a page is drawn in bands */
     } doc;
 
     /* Current page */
     struct
     {
         fz_page *page;
-        fz_display_list *list;
-        fz_pixmap *image;
         int width;
         int height;
         Eina_Array links;
@@ -106,13 +126,82 @@ struct _Etui_Module_Data
         double scale;
         float duration;
         fz_transition *transition;
-        unsigned int use_display_list :1;
     } page;
 };
 
+/* the content of a page, replayed at any scale and rotation */
+struct _Etui_Pdf_List
+{
+    EINA_INLIST;
+    int page_num;
+    fz_display_list *list;
+};
+
+/* horizontal band of a page, drawn by a thread */
+struct _Etui_Pdf_Band
+{
+    fz_context *ctx; /* context of the thread drawing the band */
+    fz_page *page; /* drawn when list is NULL */
+    fz_display_list *list;
+    fz_matrix ctm;
+    fz_irect bbox;
+    unsigned char *data; /* first pixel of the band */
+    fz_cookie cookie; /* abort is set to stop the drawing */
+    unsigned int res : 1;
+};
+
+/* thread of the pool, with its clone of the context of the document */
+struct _Etui_Pdf_Worker
+{
+    Etui_Pdf_Pool *pool;
+    fz_context *ctx;
+    Eina_Thread thread;
+};
+
+/*
+ * threads drawing the bands, started at the first drawing and kept until
+ * the document is closed. The bands of one drawing are given at a time,
+ * the drawings of a document being serialised by the library.
+ */
+struct _Etui_Pdf_Pool
+{
+    Eina_Lock lock;
+    Eina_Condition work; /* bands to draw or stop, waited by the workers */
+    Eina_Condition done; /* a band is finished, waited by the drawing thread */
+    Etui_Pdf_Band *bands;
+    int bands_nbr;
+    int next; /* next band to draw */
+    int pending; /* bands not finished */
+    const Etui_Module_Cancel *cancel; /* the remaining bands are skipped when set */
+    Etui_Pdf_Worker workers[ETUI_PDF_BANDS_MAX];
+    int workers_nbr;
+    unsigned int stop : 1;
+};
+
 static int _etui_module_pdf_init_count = 0;
 static int _etui_module_pdf_log_domain = -1;
 
+static void
+_etui_pdf_lock(void *user, int lock)
+{
+    eina_lock_take(&((Eina_Lock *)user)[lock]);
+}
+
+static void
+_etui_pdf_unlock(void *user, int lock)
+{
+    eina_lock_release(&((Eina_Lock *)user)[lock]);
+}
+
+static void
+_etui_pdf_locks_free(Etui_Module_Data *md)
+{
+    int i;
+
+    for (i = 0; i < FZ_LOCK_MAX; i++)
+        eina_lock_free(&md->doc.locks[i]);
+}
+
 static Eina_Inarray *
 _etui_pdf_search(void *mod, int page_num, const char *needle)
 {
@@ -422,12 +511,396 @@ _etui_pdf_info_set(Etui_Module_Data *md)
     md->doc.info->encryption = _etui_pdf_metadata_get(md, "encryption");
 }
 
+static void
+_etui_pdf_list_del(Etui_Module_Data *md, Etui_Pdf_List *l)
+{
+    md->doc.lists = eina_inlist_remove(md->doc.lists, EINA_INLIST_GET(l));
+    md->doc.lists_nbr--;
+    fz_drop_display_list(md->doc.ctx, l->list);
+    free(l);
+}
+
+static void
+_etui_pdf_lists_free(Etui_Module_Data *md)
+{
+    while (md->doc.lists)
+        _etui_pdf_list_del(md,
+                           EINA_INLIST_CONTAINER_GET(md->doc.lists,
+                                                     Etui_Pdf_List));
+}
+
+/*
+ * Returns the display list of the page, built on the first call only,
+ * so that the content stream is not interpreted again when the scale or
+ * the rotation changes. The list belongs to the cache.
+ */
+static fz_display_list *
+_etui_pdf_list_get(Etui_Module_Data *md, int page_num, fz_page *page)
+{
+    Etui_Pdf_List *l;
+    fz_display_list *list = NULL;
+
+    EINA_INLIST_FOREACH(md->doc.lists, l)
+    {
+        if (l->page_num == page_num)
+        {
+            md->doc.lists = eina_inlist_promote(md->doc.lists,
+                                                EINA_INLIST_GET(l));
+            return l->list;
+        }
+    }
+
+    l = (Etui_Pdf_List *)calloc(1, sizeof(Etui_Pdf_List));
+    if (!l)
+        return NULL;
+
+    fz_var(list);
+    fz_try(md->doc.ctx)
+    {
+        list = fz_new_display_list_from_page(md->doc.ctx, page);
+    }
+    fz_catch(md->doc.ctx)
+    {
+        ERR("could not create the display list of page %d", page_num);
+        free(l);
+        return NULL;
+    }
+
+    l->page_num = page_num;
+    l->list = list;
+    md->doc.lists = eina_inlist_prepend(md->doc.lists, EINA_INLIST_GET(l));
+    md->doc.lists_nbr++;
+
+    while (md->doc.lists_nbr > ETUI_PDF_LISTS_MAX)
+        _etui_pdf_list_del(md,
+                           EINA_INLIST_CONTAINER_GET(md->doc.lists->last,
+                                                     Etui_Pdf_List));
+
+    return list;
+}
+
+/* pixmap using the pixels of data, in the ARGB format of Evas */
+static fz_pixmap *
+_etui_pdf_pixmap_new(fz_context *ctx, const fz_irect *bbox, unsigned char *data)
+{
+#if FZ_VERSION_MINOR == 11
+    return fz_new_pixmap_with_bbox_and_data(ctx, fz_device_bgr(ctx),
+                                            bbox, 1, data);
+#elif FZ_VERSION_MINOR == 12 || FZ_VERSION_MINOR == 13
+    return fz_new_pixmap_with_bbox_and_data(ctx, fz_device_bgr(ctx),
+                                            bbox, NULL, 1, data);
+#else
+    return fz_new_pixmap_with_bbox_and_data(ctx, fz_device_bgr(ctx),
+                                            *bbox, NULL, 1, data);
+#endif
+}
+
+static void
+_etui_pdf_band_draw(Etui_Pdf_Band *band)
+{
+    fz_pixmap *image = NULL;
+    fz_device *dev = NULL;
+    fz_rect scissor;
+
+    scissor.x0 = band->bbox.x0;
+    scissor.y0 = band->bbox.y0;
+    scissor.x1 = band->bbox.x1;
+    scissor.y1 = band->bbox.y1;
+
+    band->res = 0;
+
+    fz_var(image);
+    fz_var(dev);
+    fz_try(band->ctx)
+    {
+        image = _etui_pdf_pixmap_new(band->ctx, &band->bbox, band->data);
+        fz_clear_pixmap_with_value(band->ctx, image, 0xff);
+#if FZ_VERSION_MINOR >= 14
+        dev = fz_new_draw_device(band->ctx, fz_identity, image);
+        if (band->list)
+            fz_run_display_list(band->ctx, band->list, dev, band->ctm, scissor, &band->cookie);
+        else
+            fz_run_page(band->ctx, band->page, dev, band->ctm, &band->cookie);
+#else
+        dev = fz_new_draw_device(band->ctx, &fz_identity, image);
+        if (band->list)
+            fz_run_display_list(band->ctx, band->list, dev, &band->ctm, &scissor, &band->cookie);
+        else
+            fz_run_page(band->ctx, band->page, dev, &band->ctm, &band->cookie);
+#endif
+        fz_close_device(band->ctx, dev);
+        /* an aborted drawing is incomplete */
+        band->res = !band->cookie.abort;
+    }
+    fz_always(band->ctx)
+    {
+        fz_drop_device(band->ctx, dev);
+        /* the pixels belong to the caller, they are not freed */
+        fz_drop_pixmap(band->ctx, image);
+    }
+    fz_catch(band->ctx)
+    {
+        ERR("could not draw the band %d-%d", band->bbox.y0, band->bbox.y1);
+    }
+}
+
+static void *
+_etui_pdf_worker_thread(void *data, Eina_Thread t EINA_UNUSED)
+{
+    Etui_Pdf_Worker *worker;
+    Etui_Pdf_Pool *pool;
+
+    worker = (Etui_Pdf_Worker *)data;
+    pool = worker->pool;
+
+    eina_lock_take(&pool->lock);
+    while (1)
+    {
+        Etui_Pdf_Band *band;
+
+        while (!pool->stop && (pool->next >= pool->bands_nbr))
+            eina_condition_wait(&pool->work);
+        if (pool->stop)
+            break;
+
+        band = pool->bands + pool->next++;
+        if (!ETUI_MODULE_CANCELLED(pool->cancel))
+        {
+            eina_lock_release(&pool->lock);
+            band->ctx = worker->ctx;
+            _etui_pdf_band_draw(band);
+            eina_lock_take(&pool->lock);
+        }
+
+        pool->pending--;
+        eina_condition_signal(&pool->done);
+    }
+    eina_lock_release(&pool->lock);
+
+    return NULL;
+}
+
+static void
+_etui_pdf_pool_free(Etui_Pdf_Pool *pool)
+{
+    int i;
+
+    if (!pool)
+        return;
+
+    eina_lock_take(&pool->lock);
+    pool->stop = 1;
+    eina_condition_broadcast(&pool->work);
+    eina_lock_release(&pool->lock);
+
+    for (i = 0; i < pool->workers_nbr; i++)
+    {
+        eina_thread_join(pool->workers[i].thread);
+        fz_drop_context(pool->workers[i].ctx);
+    }
+
+    eina_condition_free(&pool->done);
+    eina_condition_free(&pool->work);
+    eina_lock_free(&pool->lock);
+    free(pool);
+}
+
+/* one worker per page thread, the drawing thread only draws when it can not be cancelled */
+static Etui_Pdf_Pool *
+_etui_pdf_pool_get(Etui_Module_Data *md)
+{
+    Etui_Pdf_Pool *pool;
+    int workers_nbr;
+
+    if (md->doc.pool)
+        return md->doc.pool;
+
+    pool = (Etui_Pdf_Pool *)calloc(1, sizeof(Etui_Pdf_Pool));
+    if (!pool)
+        return NULL;
+
+    if (!eina_lock_new(&pool->lock))
+        goto free_pool;
+    if (!eina_condition_new(&pool->work, &pool->lock))
+        goto free_lock;
+    if (!eina_condition_new(&pool->done, &pool->lock))
+        goto free_work;
+
+    workers_nbr = etui_page_threads_get();
+    if (workers_nbr > ETUI_PDF_BANDS_MAX)
+        workers_nbr = ETUI_PDF_BANDS_MAX;
+
+    while (pool->workers_nbr < workers_nbr)
+    {
+        Etui_Pdf_Worker *worker;
+
+        worker = pool->workers + pool->workers_nbr;
+        worker->pool = pool;
+        worker->ctx = fz_clone_context(md->doc.ctx);
+        if (!worker->ctx)
+            break;
+
+        if (!eina_thread_create(&worker->thread, EINA_THREAD_NORMAL, -1,
+                                _etui_pdf_worker_thread, worker))
+        {
+            fz_drop_context(worker->ctx);
+            break;
+        }
+        pool->workers_nbr++;
+    }
+
+    if (pool->workers_nbr == 0)
+    {
+        ERR("could not start the threads drawing the pages");
+        _etui_pdf_pool_free(pool);
+        return NULL;
+    }
+
+    md->doc.pool = pool;
+
+    return pool;
+
+  free_work:
+    eina_condition_free(&pool->work);
+  free_lock:
+    eina_lock_free(&pool->lock);
+  free_pool:
+    free(pool);
+
+    return NULL;
+}
+
+/*
+ * Draws the part ibounds of the transformed page in buffer, from the
+ * display list of the page. Large areas are split in horizontal bands
+ * drawn in parallel by the threads of the pool of the document, each
+ * with its own clone of the context.
+ *
+ * When the drawing can be cancelled, the calling thread does not draw
+ * but polls cancel and aborts the bands through their cookie, and the
+ * workers do not start the remaining bands. Otherwise it draws bands too.
+ */
+static Eina_Bool
+_etui_pdf_draw(Etui_Module_Data *md, int page_num, fz_page *page, const fz_matrix *ctm, const fz_irect *ibounds, unsigned char *buffer, const Etui_Module_Cancel *cancel)
+{
+    Etui_Pdf_Band bands[ETUI_PDF_BANDS_MAX];
+    Etui_Pdf_Pool *pool = NULL;
+    fz_display_list *list;
+    size_t stride;
+    int bands_nbr;
+    int height;
+    int i;
+    Eina_Bool res = EINA_TRUE;
+
+    if (ETUI_MODULE_CANCELLED(cancel))
+        return EINA_FALSE;
+
+    height = ibounds->y1 - ibounds->y0;
+    bands_nbr = etui_page_threads_get();
+    if (bands_nbr > ETUI_PDF_BANDS_MAX)
+        bands_nbr = ETUI_PDF_BANDS_MAX;
+    if (bands_nbr > (height / ETUI_PDF_BAND_HEIGHT_MIN))
+        bands_nbr = height / ETUI_PDF_BAND_HEIGHT_MIN;
+
+    /* the page can not be run by several threads, a display list can */
+    list = _etui_pdf_list_get(md, page_num, page);
+    if (!list || (bands_nbr < 1))
+        bands_nbr = 1;
+
+    /* a single band is drawn by a worker only to be cancelled */
+    if ((bands_nbr > 1) || cancel)
+        pool = _etui_pdf_pool_get(md);
+
+    if (!pool)
+    {
+        memset(&bands[0], 0, sizeof(Etui_Pdf_Band));
+        bands[0].ctx = md->doc.ctx;
+        bands[0].page = page;
+        bands[0].list = list;
+        bands[0].ctm = *ctm;
+        bands[0].bbox = *ibounds;
+        bands[0].data = buffer;
+        _etui_pdf_band_draw(&bands[0]);
+        return bands[0].res;
+    }
+
+    stride = (size_t)(ibounds->x1 - ibounds->x0) * 4;
+    for (i = 0; i < bands_nbr; i++)
+    {
+        Etui_Pdf_Band *band;
+
+        band = bands + i;
+        memset(band, 0, sizeof(Etui_Pdf_Band));
+        band->page = list ? NULL : page;
+        band->list = list;
+        band->ctm = *ctm;
+        band->bbox = *ibounds;
+        band->bbox.y0 = ibounds->y0 + (height * i) / bands_nbr;
+        band->bbox.y1 = ibounds->y0 + (height * (i + 1)) / bands_nbr;
+        band->data = buffer + (band->bbox.y0 - ibounds->y0) * stride;
+    }
+
+    eina_lock_take(&pool->lock);
+    pool->bands = bands;
+    pool->bands_nbr = bands_nbr;
+    pool->next = 0;
+    pool->pending = bands_nbr;
+    pool->cancel = cancel;
+    eina_condition_broadcast(&pool->work);
+
+    if (!cancel)
+    {
+        /* the calling thread takes bands like the workers */
+        while (pool->next < pool->bands_nbr)
+        {
+            Etui_Pdf_Band *band;
+
+            band = pool->bands + pool->next++;
+            eina_lock_release(&pool->lock);
+            band->ctx = md->doc.ctx;
+            _etui_pdf_band_draw(band);
+            eina_lock_take(&pool->lock);
+            pool->pending--;
+        }
+    }
+
+    while (pool->pending > 0)
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+        {
+            for (i = 0; i < bands_nbr; i++)
+                bands[i].cookie.abort = 1;
+            eina_condition_wait(&pool->done);
+        }
+        else if (cancel)
+            eina_condition_timedwait(&pool->done, ETUI_PDF_CANCEL_POLL);
+        else
+            eina_condition_wait(&pool->done);
+    }
+
+    /* the bands are on the stack of this thread */
+    pool->bands = NULL;
+    pool->bands_nbr = 0;
+    pool->next = 0;
+    pool->cancel = NULL;
+    eina_lock_release(&pool->lock);
+
+    for (i = 0; i < bands_nbr; i++)
+    {
+        if (!bands[i].res)
+            res = EINA_FALSE;
+    }
+
+    return res;
+}
+
 /* Virtual functions */
 
 static void *
 _etui_pdf_init(const Etui_File *ef)
 {
     Etui_Module_Data *md;
+    int i;
 
     md = (Etui_Module_Data *)calloc(1, sizeof(Etui_Module_Data));
     if (!md)
@@ -435,16 +908,27 @@ _etui_pdf_init(const Etui_File *ef)
 
     DBG("init module");
 
+    /* the file is mapped on first use */
+    if (!etui_file_base_get(ef))
+    {
+        ERR("Could not map file %s", etui_file_filename_get(ef));
+        free(md);
+        return NULL;
+    }
+
+    for (i = 0; i < FZ_LOCK_MAX; i++)
+        eina_lock_new(&md->doc.locks[i]);
+    md->doc.locks_ctx.user = md->doc.locks;
+    md->doc.locks_ctx.lock = _etui_pdf_lock;
+    md->doc.locks_ctx.unlock = _etui_pdf_unlock;
+
     fz_var(md->doc.doc);
-    /* FIXME:
-     * 1st parameter: custom memory allocator ?
-     * 2nd parameter: locks/unlocks for multithreading
-     */
-    md->doc.ctx = fz_new_context(NULL, NULL, FZ_STORE_DEFAULT);
+    /* FIXME: 1st parameter: custom memory allocator ? */
+    md->doc.ctx = fz_new_context(NULL, &md->doc.locks_ctx, FZ_STORE_DEFAULT);
     if (!md->doc.ctx)
     {
         ERR("Could not create context");
-        goto free_md;
+        goto free_locks;
     }
 
     fz_try(md->doc.ctx)
@@ -539,7 +1023,8 @@ _etui_pdf_init(const Etui_File *ef)
     fz_drop_document(md->doc.ctx, md->doc.doc);
   drop_ctx:
     fz_drop_context(md->doc.ctx);
-  free_md:
+  free_locks:
+    _etui_pdf_locks_free(md);
     free(md);
 
     return NULL;
@@ -566,8 +1051,12 @@ _etui_pdf_shutdown(void *d)
     _etui_pdf_toc_unfill(&md->doc.toc, EINA_FALSE);
     eina_array_flush(&md->doc.toc);
     free(md->doc.title);
+    /* the workers use clones of the context */
+    _etui_pdf_pool_free(md->doc.pool);
+    _etui_pdf_lists_free(md);
     fz_drop_document(md->doc.ctx, md->doc.doc);
     fz_drop_context(md->doc.ctx);
+    _etui_pdf_locks_free(md);
     free(md);
 }
 
@@ -858,12 +1347,9 @@ _etui_pdf_page_render_pre(void *d)
 }
 
 static void
-_etui_pdf_page_render(void *d)
+_etui_pdf_page_render(void *d, const Etui_Module_Cancel *cancel)
 {
     Etui_Module_Data *md;
-    fz_device *dev = NULL;
-    fz_pixmap *image;
-    fz_cookie cookie = { 0 };
     fz_matrix ctm;
     fz_rect bounds;
     fz_irect ibounds;
@@ -875,20 +1361,6 @@ _etui_pdf_page_render(void *d)
 
     md = (Etui_Module_Data *)d;
 
-    if (md->page.use_display_list)
-    {
-        if (md->page.list)
-            fz_drop_display_list(md->doc.ctx, md->page.list);
-        md->page.list = fz_new_display_list_from_page(md->doc.ctx, md->page.page);
-
-        dev = fz_new_list_device(md->doc.ctx, md->page.list);
-#if FZ_VERSION_MINOR >= 14
-        fz_run_page(md->doc.ctx, md->page.page, dev, fz_identity, &cookie);
-#else
-        fz_run_page(md->doc.ctx, md->page.page, dev, &fz_identity, &cookie);
-#endif
-        fz_close_device(md->doc.ctx, dev);
-    }
 #if FZ_VERSION_MINOR >= 14
     bounds = fz_bound_page(md->doc.ctx, md->page.page);
     ctm = fz_rotate(md->page.rotation);
@@ -900,44 +1372,15 @@ _etui_pdf_page_render(void *d)
                  md->page.scale, md->page.scale);
     fz_round_rect(&ibounds, fz_transform_rect(&bounds, &ctm));
 #endif
-#if FZ_VERSION_MINOR == 11
-    image = fz_new_pixmap_with_bbox_and_data(md->doc.ctx,
-                                             fz_device_bgr(md->doc.ctx),
-                                             &ibounds, 1,
-                                             (unsigned char *)md->efl.m);
-#elif FZ_VERSION_MINOR == 12 || FZ_VERSION_MINOR == 13
-    image = fz_new_pixmap_with_bbox_and_data(md->doc.ctx,
-                                             fz_device_bgr(md->doc.ctx),
-                                             &ibounds, NULL, 1,
-                                             (unsigned char *)md->efl.m);
-#else
-    image = fz_new_pixmap_with_bbox_and_data(md->doc.ctx,
-                                             fz_device_bgr(md->doc.ctx),
-                                             ibounds, NULL, 1,
-                                             (unsigned char *)md->efl.m);
-#endif
 
-    fz_clear_pixmap_with_value(md->doc.ctx, image, 0xff);
-#if FZ_VERSION_MINOR >= 14
-    dev = fz_new_draw_device(md->doc.ctx, fz_identity, image);
-#else
-    dev = fz_new_draw_device(md->doc.ctx, &fz_identity, image);
-#endif
-    if (md->page.use_display_list)
-#if FZ_VERSION_MINOR >= 14
-        fz_run_display_list(md->doc.ctx, md->page.list, dev, ctm, bounds, &cookie);
-#else
-        fz_run_display_list(md->doc.ctx, md->page.list, dev, &ctm, &bounds, &cookie);
-#endif
-    else
-#if FZ_VERSION_MINOR >= 14
-        fz_run_page(md->doc.ctx, md->page.page, dev, ctm, &cookie);
-#else
-        fz_run_page(md->doc.ctx, md->page.page, dev, &ctm, &cookie);
-#endif
-    fz_close_device(md->doc.ctx, dev);
-    dev = NULL;
-    md->page.image = image;
+    if (!_etui_pdf_draw(md, md->page.page_num, md->page.page, &ctm, &ibounds,
+                        (unsigned char *)md->efl.m, cancel))
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+            DBG("rendering of page %d cancelled", md->page.page_num);
+        else
+            ERR("could not render page %d", md->page.page_num);
+    }
 }
 
 static void
@@ -959,9 +1402,225 @@ _etui_pdf_page_render_end(void *d)
     evas_object_size_hint_min_set(md->efl.obj, width, height);
     evas_object_image_data_set(md->efl.obj, md->efl.m);
     evas_object_image_data_update_add(md->efl.obj, 0, 0, width, height);
-    fz_drop_pixmap(md->doc.ctx, md->page.image);
 }
 
+static Eina_Bool
+_etui_pdf_page_raster_size(void *d, int page_num, double scale, Etui_Rotation rotation, int *width, int *height)
+{
+    Etui_Module_Data *md;
+    fz_page *page = NULL;
+    fz_matrix ctm;
+    fz_rect bounds;
+    fz_irect ibounds;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if (!md->doc.doc)
+        return EINA_FALSE;
+
+    fz_var(page);
+    fz_try(md->doc.ctx)
+    {
+        page = fz_load_page(md->doc.ctx, md->doc.doc, page_num);
+#if FZ_VERSION_MINOR >= 14
+        bounds = fz_bound_page(md->doc.ctx, page);
+        ctm = fz_rotate(rotation);
+        ctm = fz_pre_scale(ctm, scale, scale);
+        ibounds = fz_round_rect(fz_transform_rect(bounds, ctm));
+#else
+        fz_bound_page(md->doc.ctx, page, &bounds);
+        fz_pre_scale(fz_rotate(&ctm, rotation), scale, scale);
+        fz_round_rect(&ibounds, fz_transform_rect(&bounds, &ctm));
+#endif
+    }
+    fz_always(md->doc.ctx)
+    {
+        fz_drop_page(md->doc.ctx, page);
+    }
+    fz_catch(md->doc.ctx)
+    {
+        ERR("could not load page %d from the document", page_num);
+        return EINA_FALSE;
+    }
+
+    if (width) *width = ibounds.x1 - ibounds.x0;
+    if (height) *height = ibounds.y1 - ibounds.y0;
+
+    return EINA_TRUE;
+}
+
+static Eina_Bool
+_etui_pdf_page_raster(void *d, int page_num, double scale, Etui_Rotation rotation, unsigned int *buffer, int x, int y, int width, int height, const Etui_Module_Cancel *cancel)
+{
+    Etui_Module_Data *md;
+    fz_page *page = NULL;
+    fz_matrix ctm;
+    fz_rect bounds;
+    fz_irect ibounds;
+    Eina_Bool res = EINA_FALSE;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if (!md->doc.doc)
+        return EINA_FALSE;
+
+    fz_var(page);
+    fz_var(res);
+    fz_try(md->doc.ctx)
+    {
+        page = fz_load_page(md->doc.ctx, md->doc.doc, page_num);
+#if FZ_VERSION_MINOR >= 14
+        bounds = fz_bound_page(md->doc.ctx, page);
+        ctm = fz_rotate(rotation);
+        ctm = fz_pre_scale(ctm, scale, scale);
+        ibounds = fz_round_rect(fz_transform_rect(bounds, ctm));
+#else
+        fz_bound_page(md->doc.ctx, page, &bounds);
+        fz_pre_scale(fz_rotate(&ctm, rotation), scale, scale);
+        fz_round_rect(&ibounds, fz_transform_rect(&bounds, &ctm));
+#endif
+        if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) ||
+            ((x + width) > (ibounds.x1 - ibounds.x0)) ||
+            ((y + height) > (ibounds.y1 - ibounds.y0)))
+            fz_throw(md->doc.ctx, FZ_ERROR_GENERIC, "region out of the page");
+
+        /* only the region is drawn, the device clips to the pixmap */
+        ibounds.x0 += x;
+        ibounds.y0 += y;
+        ibounds.x1 = ibounds.x0 + width;
+        ibounds.y1 = ibounds.y0 + height;
+
+        /* a cancelled drawing is not an error */
+        res = _etui_pdf_draw(md, page_num, page, &ctm, &ibounds,
+                             (unsigned char *)buffer, cancel);
+        if (!res && !ETUI_MODULE_CANCELLED(cancel))
+            fz_throw(md->doc.ctx, FZ_ERROR_GENERIC, "drawing failed");
+    }
+    fz_always(md->doc.ctx)
+    {
+        fz_drop_page(md->doc.ctx, page);
+    }
+    fz_catch(md->doc.ctx)
+    {
+        ERR("could not render page %d from the document", page_num);
+        return EINA_FALSE;
+    }
+
+    return res;
+}
+
+#if FZ_VERSION_MINOR >= 14
+static Eina_Bool
+_etui_pdf_page_text_get(void *d, int page_num, Etui_Module_Text *text, const Etui_Module_Cancel *cancel)
+{
+    Etui_Module_Data *md;
+    fz_page *page = NULL;
+    fz_stext_page *stext = NULL;
+    fz_stext_block *block;
+    fz_stext_line *line;
+    fz_stext_char *ch;
+    unsigned int length;
+    Eina_Bool res = EINA_TRUE;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if (!md->doc.doc || (page_num < 0) || (page_num >= md->doc.page_nbr))
+        return EINA_FALSE;
+
+    if (ETUI_MODULE_CANCELLED(cancel))
+        return EINA_FALSE;
+
+    text->text = NULL;
+    text->boxes = NULL;
+    text->length = 0;
+
+    fz_var(page);
+    fz_var(stext);
+    fz_try(md->doc.ctx)
+    {
+        page = fz_load_page(md->doc.ctx, md->doc.doc, page_num);
+        stext = fz_new_stext_page_from_page(md->doc.ctx, page, NULL);
+    }
+    fz_always(md->doc.ctx)
+    {
+        fz_drop_page(md->doc.ctx, page);
+    }
+    fz_catch(md->doc.ctx)
+    {
+        ERR("could not extract the text of page %d", page_num);
+        return EINA_FALSE;
+    }
+
+    /* a space, without box, ends each line */
+    length = 0;
+    for (block = stext->first_block; block; block = block->next)
+    {
+        if (block->type != FZ_STEXT_BLOCK_TEXT)
+            continue;
+
+        for (line = block->u.t.first_line; line; line = line->next)
+        {
+            for (ch = line->first_char; ch; ch = ch->next)
+                length++;
+            length++;
+        }
+    }
+
+    if (length == 0)
+        goto drop_stext;
+
+    text->text = (Eina_Unicode *)malloc(length * sizeof(Eina_Unicode));
+    text->boxes = (Eina_Rectangle *)calloc(length, sizeof(Eina_Rectangle));
+    if (!text->text || !text->boxes)
+    {
+        free(text->text);
+        free(text->boxes);
+        text->text = NULL;
+        text->boxes = NULL;
+        res = EINA_FALSE;
+        goto drop_stext;
+    }
+
+    for (block = stext->first_block; block; block = block->next)
+    {
+        if (block->type != FZ_STEXT_BLOCK_TEXT)
+            continue;
+
+        for (line = block->u.t.first_line; line; line = line->next)
+        {
+            for (ch = line->first_char; ch; ch = ch->next)
+            {
+                Eina_Rectangle *box;
+                fz_rect r;
+
+                r = fz_rect_from_quad(ch->quad);
+                box = text->boxes + text->length;
+                box->x = floor(r.x0);
+                box->y = floor(r.y0);
+                box->w = ceil(r.x1 - r.x0);
+                box->h = ceil(r.y1 - r.y0);
+                text->text[text->length++] = ch->c;
+            }
+            text->text[text->length++] = ' ';
+        }
+    }
+
+  drop_stext:
+    fz_drop_stext_page(md->doc.ctx, stext);
+
+    return res;
+}
+#endif
+
 static const void *
 _etui_pdf_api_get(void *d)
 {
@@ -995,7 +1654,14 @@ static Etui_Module_Func _etui_module_func_pdf =
     /* .page_render_pre   */ _etui_pdf_page_render_pre,
     /* .page_render       */ _etui_pdf_page_render,
     /* .page_render_end   */ _etui_pdf_page_render_end,
-    /* .api_get           */ _etui_pdf_api_get
+    /* .api_get           */ _etui_pdf_api_get,
+    /* .page_raster_size  */ _etui_pdf_page_raster_size,
+    /* .page_raster       */ _etui_pdf_page_raster,
+#if FZ_VERSION_MINOR >= 14
+    /* .page_text_get     */ _etui_pdf_page_text_get
+#else
+    /* .page_text_get     */ NULL
+#endif
 };
 
 /**
@@ -1038,7 +1704,7 @@ module_open(Etui_Module *em)
 }
 
 static void
-module_close(Etui_Module *em)
+module_close(Etui_Module *em EINA_UNUSED)
 {
     if (_etui_module_pdf_init_count > 1)
     {
@@ -1053,8 +1719,7 @@ module_close(Etui_Module *em)
 
     DBG("shutdown pdf module");
 
-    /* shutdown module here */
-    em->functions->shutdown(em->data);
+    /* documents are shut down by etui_file_free() */
 
     /* shutdown external libraries here */
 
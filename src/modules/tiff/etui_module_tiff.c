@@ -17,6 +17,9 @@
 
 #include <config.h>
 
+#include <stdio.h>
+#include <string.h>
+
 #include <Eina.h>
 #include <Ecore.h> /* for Ecore_Thread in Etui_Module */
 #include <Evas.h>
@@ -67,6 +70,83 @@
 #endif
 #define CRIT(...) EINA_LOG_DOM_CRIT(_etui_module_tiff_log_domain, __VA_ARGS__)
 
+/* maximum number of threads decoding a region */
+#define ETUI_TIFF_WORKERS_MAX 16
+
+/* regions smaller than that (in source pixels) are decoded by one thread */
+#define ETUI_TIFF_PARALLEL_AREA_MIN (2048 * 2048)
+
+/* a libtiff handle reading the mapping of the file */
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    toff_t offset; /* position of libtiff in data */
+} Etui_Tiff_Io;
+
+/* image of a page in the file, the page itself or a reduced copy */
+typedef struct
+{
+    toff_t offset; /* of its directory */
+    unsigned int width;
+    unsigned int height;
+} Etui_Tiff_Image;
+
+/* a page and the levels of its pyramid, if any */
+typedef struct
+{
+    Etui_Tiff_Image image;
+    Etui_Tiff_Image *levels;
+    int levels_nbr;
+} Etui_Tiff_Page;
+
+/* additional handle, used by a thread decoding a region */
+typedef struct
+{
+    Etui_Tiff_Io io;
+    TIFF *tiff;
+} Etui_Tiff_Handle;
+
+/*
+ * part of a page decoded by several threads, one chunk of source rows
+ * (a strip or a row of tiles) at a time. The destination pixels are
+ * sampled (nearest neighbour) from the source pixels given by cols and
+ * rows, so only the chunks containing a sampled row are decoded.
+ */
+typedef struct
+{
+    const Etui_Module_Cancel *cancel;
+    unsigned int *buffer; /* destination region */
+    int width;
+    int height;
+    unsigned int *cols; /* source coordinate of each destination column */
+    unsigned int *rows; /* source coordinate of each destination row */
+    Eina_Bool swap; /* rows give the source columns (rotation of 90 or 270) */
+    unsigned int col0; /* source columns decoded */
+    unsigned int col1;
+    unsigned int src_h;
+    unsigned int chunk; /* rows per chunk */
+    unsigned int *chunks; /* first source row of the chunks to decode */
+    int chunks_nbr;
+    Eina_Bool bilevel; /* 1 bit page, strips are decoded as packed bits */
+    unsigned int colors[2]; /* of the bits 0 and 1 */
+    unsigned int (*bytes)[8]; /* pixels of each byte, if the columns are not scaled */
+    size_t scanline; /* bytes per source row */
+    Eina_Lock lock; /* protects next and res */
+    int next;
+    Eina_Bool res;
+} Etui_Tiff_Region;
+
+typedef struct
+{
+    Etui_Tiff_Region *region;
+    TIFFRGBAImage img;
+    unsigned int *raster; /* one chunk, or one strip of packed bits */
+    Eina_Thread thread;
+    unsigned int has_begun : 1;
+    unsigned int threaded : 1;
+} Etui_Tiff_Worker;
+
 typedef struct
 {
     /* specific EFL stuff for the module */
@@ -84,9 +164,10 @@ typedef struct
         TIFF *tiff;
         Etui_Module_Tiff_Info *info; /* information specific to the document (creator, ...) */
         int page_nbr;
+        Eina_Inarray *pages; /* Etui_Tiff_Page of each page, may be NULL */
         Eina_Array toc;
-        void *data;
-        size_t size;
+        Etui_Tiff_Io io; /* mapping of the file, read by libtiff */
+        Etui_Tiff_Handle handles[ETUI_TIFF_WORKERS_MAX - 1]; /* opened when needed */
     } doc;
 
     /* Current page */
@@ -99,6 +180,7 @@ typedef struct
         int page_num;
         Etui_Rotation rotation;
         double scale;
+        toff_t offset; /* of the directory img is begun on, 0 if unknown */
         unsigned int has_begun : 1;
         unsigned int has_rastered : 1;
     } page;
@@ -200,6 +282,1090 @@ _etui_tiff_info_set(Etui_Module_Data *md)
     }
 }
 
+/*
+ * I/O of libtiff over the mapping of the Etui_File: the strips and tiles
+ * which are not compressed are read in place with the map procedure,
+ * the others are copied from the mapping, without a second descriptor.
+ */
+static tmsize_t
+_etui_tiff_io_read(thandle_t h, void *buf, tmsize_t size)
+{
+    Etui_Tiff_Io *io;
+
+    io = (Etui_Tiff_Io *)h;
+
+    if ((size <= 0) || ((size_t)io->offset >= io->size))
+        return 0;
+
+    if ((size_t)size > (io->size - io->offset))
+        size = io->size - io->offset;
+
+    memcpy(buf, io->data + io->offset, size);
+    io->offset += size;
+
+    return size;
+}
+
+static tmsize_t
+_etui_tiff_io_write(thandle_t h EINA_UNUSED, void *buf EINA_UNUSED, tmsize_t size EINA_UNUSED)
+{
+    return -1;
+}
+
+static toff_t
+_etui_tiff_io_seek(thandle_t h, toff_t offset, int whence)
+{
+    Etui_Tiff_Io *io;
+    long long pos;
+
+    io = (Etui_Tiff_Io *)h;
+
+    switch (whence)
+    {
+        case SEEK_SET:
+            pos = (long long)offset;
+            break;
+        case SEEK_CUR:
+            pos = (long long)io->offset + (long long)offset;
+            break;
+        case SEEK_END:
+            pos = (long long)io->size + (long long)offset;
+            break;
+        default:
+            return (toff_t)-1;
+    }
+
+    if (pos < 0)
+        return (toff_t)-1;
+
+    io->offset = (toff_t)pos;
+
+    return io->offset;
+}
+
+static int
+_etui_tiff_io_close(thandle_t h EINA_UNUSED)
+{
+    /* the mapping belongs to the Etui_File */
+    return 0;
+}
+
+static toff_t
+_etui_tiff_io_size(thandle_t h)
+{
+    return ((Etui_Tiff_Io *)h)->size;
+}
+
+static int
+_etui_tiff_io_map(thandle_t h, void **base, toff_t *size)
+{
+    Etui_Tiff_Io *io;
+
+    io = (Etui_Tiff_Io *)h;
+    *base = (void *)io->data;
+    *size = io->size;
+
+    return 1;
+}
+
+static void
+_etui_tiff_io_unmap(thandle_t h EINA_UNUSED, void *base EINA_UNUSED, toff_t size EINA_UNUSED)
+{
+}
+
+static TIFF *
+_etui_tiff_io_open(const char *name, Etui_Tiff_Io *io)
+{
+    return TIFFClientOpen(name, "r", (thandle_t)io,
+                          _etui_tiff_io_read,
+                          _etui_tiff_io_write,
+                          _etui_tiff_io_seek,
+                          _etui_tiff_io_close,
+                          _etui_tiff_io_size,
+                          _etui_tiff_io_map,
+                          _etui_tiff_io_unmap);
+}
+
+static unsigned int
+_etui_tiff_uint16_get(const unsigned char *p, Eina_Bool le)
+{
+    return le ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+}
+
+static unsigned int
+_etui_tiff_uint32_get(const unsigned char *p, Eina_Bool le)
+{
+    return le ?
+        (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24)) :
+        (((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+static uint64_t
+_etui_tiff_uint64_get(const unsigned char *p, Eina_Bool le)
+{
+    uint64_t lo;
+    uint64_t hi;
+
+    lo = _etui_tiff_uint32_get(p + (le ? 0 : 4), le);
+    hi = _etui_tiff_uint32_get(p + (le ? 4 : 0), le);
+
+    return (hi << 32) | lo;
+}
+
+/* the file as seen by the directory index */
+typedef struct
+{
+    const unsigned char *base;
+    size_t size;
+    Eina_Bool le;
+    Eina_Bool big;
+} Etui_Tiff_Map;
+
+/* value n of the directory entry, for the integer types only */
+static Eina_Bool
+_etui_tiff_entry_value_get(const Etui_Tiff_Map *map, const unsigned char *entry,
+                           uint64_t n, uint64_t *value)
+{
+    const unsigned char *p;
+    uint64_t count;
+    unsigned int type_size;
+
+    switch (_etui_tiff_uint16_get(entry + 2, map->le))
+    {
+        case 3: /* SHORT */
+            type_size = 2;
+            break;
+        case 4: /* LONG */
+        case 13: /* IFD */
+            type_size = 4;
+            break;
+        case 16: /* LONG8 */
+        case 18: /* IFD8 */
+            type_size = 8;
+            break;
+        default:
+            return EINA_FALSE;
+    }
+
+    count = map->big ?
+        _etui_tiff_uint64_get(entry + 4, map->le) :
+        _etui_tiff_uint32_get(entry + 4, map->le);
+    if ((n >= count) || (count > map->size))
+        return EINA_FALSE;
+
+    if ((count * type_size) <= (map->big ? 8 : 4))
+        p = entry + (map->big ? 12 : 8);
+    else
+    {
+        uint64_t offset;
+
+        offset = map->big ?
+            _etui_tiff_uint64_get(entry + 12, map->le) :
+            _etui_tiff_uint32_get(entry + 8, map->le);
+        if ((offset > map->size) || ((count * type_size) > (map->size - offset)))
+            return EINA_FALSE;
+        p = map->base + offset;
+    }
+
+    p += n * type_size;
+    if (type_size == 2)
+        *value = _etui_tiff_uint16_get(p, map->le);
+    else if (type_size == 4)
+        *value = _etui_tiff_uint32_get(p, map->le);
+    else
+        *value = _etui_tiff_uint64_get(p, map->le);
+
+    return EINA_TRUE;
+}
+
+/*
+ * reads the size, the type and the reduced images of the directory at
+ * offset, without libtiff, and the offset of the next directory
+ */
+static Eina_Bool
+_etui_tiff_directory_read(const Etui_Tiff_Map *map, uint64_t offset,
+                          Etui_Tiff_Image *image, uint64_t *subfile_type,
+                          const unsigned char **sub_ifds, uint64_t *next)
+{
+    const unsigned char *entry;
+    uint64_t count;
+    uint64_t value;
+    unsigned int entry_size;
+    uint64_t i;
+
+    entry_size = map->big ? 20 : 12;
+
+    /* the offsets come from the file, offset + n can wrap */
+    if ((offset > map->size) || ((map->size - offset) < (map->big ? 8 : 2)))
+        return EINA_FALSE;
+
+    if (map->big)
+    {
+        count = _etui_tiff_uint64_get(map->base + offset, map->le);
+        offset += 8;
+        if ((count > map->size) || ((count * entry_size + 8) > (map->size - offset)))
+            return EINA_FALSE;
+        *next = _etui_tiff_uint64_get(map->base + offset + count * entry_size, map->le);
+    }
+    else
+    {
+        count = _etui_tiff_uint16_get(map->base + offset, map->le);
+        offset += 2;
+        if ((count * entry_size + 4) > (map->size - offset))
+            return EINA_FALSE;
+        *next = _etui_tiff_uint32_get(map->base + offset + count * entry_size, map->le);
+    }
+
+    image->width = 0;
+    image->height = 0;
+    *subfile_type = 0;
+    *sub_ifds = NULL;
+
+    entry = map->base + offset;
+    for (i = 0; i < count; i++, entry += entry_size)
+    {
+        switch (_etui_tiff_uint16_get(entry, map->le))
+        {
+            case TIFFTAG_SUBFILETYPE:
+                if (_etui_tiff_entry_value_get(map, entry, 0, &value))
+                    *subfile_type = value;
+                break;
+            case TIFFTAG_IMAGEWIDTH:
+                if (_etui_tiff_entry_value_get(map, entry, 0, &value))
+                    image->width = (unsigned int)value;
+                break;
+            case TIFFTAG_IMAGELENGTH:
+                if (_etui_tiff_entry_value_get(map, entry, 0, &value))
+                    image->height = (unsigned int)value;
+                break;
+            case TIFFTAG_SUBIFD:
+                *sub_ifds = entry;
+                break;
+        }
+    }
+
+    return EINA_TRUE;
+}
+
+static void
+_etui_tiff_level_add(Etui_Tiff_Page *page, const Etui_Tiff_Image *image)
+{
+    Etui_Tiff_Image *levels;
+
+    if ((image->width == 0) || (image->height == 0) ||
+        (image->width >= page->image.width))
+        return;
+
+    levels = (Etui_Tiff_Image *)realloc(page->levels,
+                                        (page->levels_nbr + 1) * sizeof(Etui_Tiff_Image));
+    if (!levels)
+        return;
+
+    page->levels = levels;
+    page->levels[page->levels_nbr++] = *image;
+}
+
+static void
+_etui_tiff_pages_free(Eina_Inarray *pages)
+{
+    Etui_Tiff_Page *page;
+
+    EINA_INARRAY_FOREACH(pages, page)
+        free(page->levels);
+    eina_inarray_free(pages);
+}
+
+/*
+ * Follows the chain of directories in the mapped file, like
+ * TIFFNumberOfDirectories(), and stores the offset and the size of each
+ * page, so that any page is then set in constant time with
+ * TIFFSetSubDirectory(), instead of TIFFSetDirectory() which walks the
+ * chain from the first directory.
+ *
+ * The reduced resolution images of a pyramid, either in the SubIFDs of
+ * a page or following it in the chain, are stored as levels of the page
+ * and are not pages themselves.
+ */
+static Eina_Inarray *
+_etui_tiff_directories_index(const Etui_File *ef)
+{
+    Etui_Tiff_Map map;
+    Eina_Inarray *pages;
+    Eina_Hash *seen;
+    uint64_t offset;
+
+    map.base = (const unsigned char *)etui_file_base_get(ef);
+    map.size = etui_file_size_get(ef);
+    if (!map.base || (map.size < 8))
+        return NULL;
+
+    map.le = (map.base[0] == 'I');
+    map.big = (_etui_tiff_uint16_get(map.base + 2, map.le) == 43);
+    if (map.big)
+    {
+        if (map.size < 16)
+            return NULL;
+        offset = _etui_tiff_uint64_get(map.base + 8, map.le);
+    }
+    else
+        offset = _etui_tiff_uint32_get(map.base + 4, map.le);
+
+    pages = eina_inarray_new(sizeof(Etui_Tiff_Page), 64);
+    if (!pages)
+        return NULL;
+
+    /* a malformed file can loop in its chain */
+    seen = eina_hash_int64_new(NULL);
+    if (!seen)
+    {
+        eina_inarray_free(pages);
+        return NULL;
+    }
+
+    while (offset)
+    {
+        Etui_Tiff_Page page;
+        Etui_Tiff_Page *last;
+        const unsigned char *sub_ifds;
+        uint64_t subfile_type;
+        uint64_t next;
+        uint64_t i;
+
+        if (eina_hash_find(seen, &offset))
+        {
+            WRN("Loop in the directories at offset %llu",
+                (unsigned long long)offset);
+            break;
+        }
+        eina_hash_add(seen, &offset, pages);
+
+        memset(&page, 0, sizeof(page));
+        if (!_etui_tiff_directory_read(&map, offset, &page.image,
+                                       &subfile_type, &sub_ifds, &next))
+            break;
+        page.image.offset = (toff_t)offset;
+
+        last = eina_inarray_count(pages) ?
+            (Etui_Tiff_Page *)eina_inarray_nth(pages, eina_inarray_count(pages) - 1) :
+            NULL;
+        if (last && (subfile_type & FILETYPE_REDUCEDIMAGE))
+        {
+            /* a reduced copy of the previous page (a mask is skipped) */
+            if (!(subfile_type & FILETYPE_MASK))
+                _etui_tiff_level_add(last, &page.image);
+            offset = next;
+            continue;
+        }
+
+        /* the reduced copies in the SubIFDs of the page */
+        for (i = 0; sub_ifds && _etui_tiff_entry_value_get(&map, sub_ifds, i, &offset); i++)
+        {
+            Etui_Tiff_Image level;
+            const unsigned char *unused;
+            uint64_t type;
+            uint64_t unused_next;
+
+            if (_etui_tiff_directory_read(&map, offset, &level, &type,
+                                          &unused, &unused_next) &&
+                (type & FILETYPE_REDUCEDIMAGE) && !(type & FILETYPE_MASK))
+            {
+                level.offset = (toff_t)offset;
+                _etui_tiff_level_add(&page, &level);
+            }
+        }
+
+        eina_inarray_push(pages, &page);
+        offset = next;
+    }
+
+    eina_hash_free(seen);
+
+    if (eina_inarray_count(pages) == 0)
+    {
+        eina_inarray_free(pages);
+        return NULL;
+    }
+
+    return pages;
+}
+
+static Eina_Bool
+_etui_tiff_offset_set(TIFF *tiff, toff_t offset)
+{
+    if (TIFFCurrentDirOffset(tiff) == (uint64)offset)
+        return EINA_TRUE;
+
+    return TIFFSetSubDirectory(tiff, offset);
+}
+
+static Eina_Bool
+_etui_tiff_directory_set(Etui_Module_Data *md, int page_num)
+{
+    Etui_Tiff_Page *page;
+
+    if (!md->doc.pages)
+        return TIFFSetDirectory(md->doc.tiff, page_num);
+
+    page = (Etui_Tiff_Page *)eina_inarray_nth(md->doc.pages, page_num);
+
+    return _etui_tiff_offset_set(md->doc.tiff, page->image.offset);
+}
+
+static void
+_etui_tiff_directory_restore(Etui_Module_Data *md)
+{
+    _etui_tiff_directory_set(md, (md->page.page_num >= 0) ? md->page.page_num : 0);
+}
+
+/*
+ * image of the page from which a raster of width x height (before the
+ * rotation) is sampled: the smallest level of the pyramid at least as
+ * large, or the page itself. NULL without directory index.
+ */
+static const Etui_Tiff_Image *
+_etui_tiff_level_get(Etui_Module_Data *md, int page_num,
+                     unsigned int width, unsigned int height)
+{
+    const Etui_Tiff_Page *page;
+    const Etui_Tiff_Image *image;
+    int i;
+
+    if (!md->doc.pages || (page_num < 0))
+        return NULL;
+
+    page = (const Etui_Tiff_Page *)eina_inarray_nth(md->doc.pages, page_num);
+    image = &page->image;
+    for (i = 0; i < page->levels_nbr; i++)
+    {
+        if ((page->levels[i].width >= width) &&
+            (page->levels[i].height >= height) &&
+            (page->levels[i].width < image->width))
+            image = page->levels + i;
+    }
+
+    return image;
+}
+
+/*
+ * Convert the ABGR raster of libtiff (already premultiplied) to the
+ * ARGB format of Evas, scaling it to dst_w x dst_h (nearest neighbour)
+ * and rotating it clockwise. Only the region (x, y, width, height) of
+ * the result is stored in dst.
+ */
+static void
+_etui_tiff_raster_convert(const unsigned int *src, int src_w, int src_h,
+                          unsigned int *dst, int dst_w, int dst_h,
+                          int x, int y, int width, int height,
+                          Etui_Rotation rotation)
+{
+    int w;
+    int h;
+    int i;
+    int j;
+
+    /* size of the scaled image before the rotation */
+    if ((rotation == ETUI_ROTATION_90) || (rotation == ETUI_ROTATION_270))
+    {
+        w = dst_h;
+        h = dst_w;
+    }
+    else
+    {
+        w = dst_w;
+        h = dst_h;
+    }
+
+    for (j = y; j < y + height; j++)
+    {
+        for (i = x; i < x + width; i++)
+        {
+            unsigned int p;
+            int ux;
+            int uy;
+
+            switch (rotation)
+            {
+                case ETUI_ROTATION_90:
+                    ux = j;
+                    uy = h - 1 - i;
+                    break;
+                case ETUI_ROTATION_180:
+                    ux = w - 1 - i;
+                    uy = h - 1 - j;
+                    break;
+                case ETUI_ROTATION_270:
+                    ux = w - 1 - j;
+                    uy = i;
+                    break;
+                default:
+                    ux = i;
+                    uy = j;
+                    break;
+            }
+
+            p = src[((size_t)uy * src_h / h) * src_w + ((size_t)ux * src_w / w)];
+            *dst++ = (TIFFGetA(p) << 24) | (TIFFGetR(p) << 16) |
+                (TIFFGetG(p) << 8) | TIFFGetB(p);
+        }
+    }
+}
+
+/*
+ * Reads the raster of img like TIFFRGBAImageGet(), one strip (or one
+ * row of tiles) at a time, so that a cancelled rendering stops between
+ * two of them. Images stored bottom-up are read at once, libtiff flips
+ * them as a whole.
+ */
+static Eina_Bool
+_etui_tiff_rgba_image_get(TIFFRGBAImage *img, unsigned int *raster,
+                          unsigned int w, unsigned int h,
+                          const Etui_Module_Cancel *cancel)
+{
+    unsigned int chunk;
+    unsigned int row;
+    Eina_Bool res = EINA_TRUE;
+
+    if (ETUI_MODULE_CANCELLED(cancel))
+        return EINA_FALSE;
+
+    if (!cancel ||
+        ((img->orientation != ORIENTATION_TOPLEFT) &&
+         (img->orientation != ORIENTATION_TOPRIGHT)))
+        return TIFFRGBAImageGet(img, raster, w, h);
+
+    if (TIFFIsTiled(img->tif))
+    {
+        if (!TIFFGetField(img->tif, TIFFTAG_TILELENGTH, &chunk))
+            chunk = h;
+    }
+    else
+        TIFFGetFieldDefaulted(img->tif, TIFFTAG_ROWSPERSTRIP, &chunk);
+    if ((chunk == 0) || (chunk > h))
+        chunk = h;
+
+    for (row = 0; res && (row < h); row += chunk)
+    {
+        if (ETUI_MODULE_CANCELLED(cancel))
+        {
+            res = EINA_FALSE;
+            break;
+        }
+
+        img->row_offset = row;
+        res = TIFFRGBAImageGet(img, raster + (size_t)row * w, w,
+                               ((h - row) < chunk) ? (h - row) : chunk);
+    }
+    img->row_offset = 0;
+
+    return res;
+}
+
+/*
+ * handle i for the threads decoding a region, opened on the mapping the
+ * first time and set to the directory at offset
+ */
+static TIFF *
+_etui_tiff_handle_get(Etui_Module_Data *md, int i, toff_t offset)
+{
+    Etui_Tiff_Handle *handle;
+
+    handle = md->doc.handles + i;
+    if (!handle->tiff)
+    {
+        handle->io.data = md->doc.io.data;
+        handle->io.size = md->doc.io.size;
+        handle->io.offset = 0;
+        handle->tiff = _etui_tiff_io_open(TIFFFileName(md->doc.tiff),
+                                          &handle->io);
+        if (!handle->tiff)
+            return NULL;
+    }
+
+    if (!_etui_tiff_offset_set(handle->tiff, offset))
+        return NULL;
+
+    return handle->tiff;
+}
+
+/* stores the sampled pixels of the source rows [c0, c1) in the region */
+static void
+_etui_tiff_region_fill(const Etui_Tiff_Region *region, const unsigned int *raster,
+                       unsigned int c0, unsigned int c1)
+{
+    unsigned int cw;
+    int first;
+    int last;
+    int i;
+    int j;
+
+    cw = region->col1 - region->col0;
+
+    if (!region->swap)
+    {
+        for (j = 0; j < region->height; j++)
+        {
+            const unsigned int *src;
+            unsigned int *dst;
+
+            if ((region->rows[j] < c0) || (region->rows[j] >= c1))
+                continue;
+
+            src = raster + (size_t)(region->rows[j] - c0) * cw - region->col0;
+            dst = region->buffer + (size_t)j * region->width;
+            for (i = 0; i < region->width; i++)
+            {
+                unsigned int p;
+
+                p = src[region->cols[i]];
+                dst[i] = (TIFFGetA(p) << 24) | (TIFFGetR(p) << 16) |
+                    (TIFFGetG(p) << 8) | TIFFGetB(p);
+            }
+        }
+        return;
+    }
+
+    /* the columns sampling the chunk are contiguous, cols is monotonic */
+    first = -1;
+    last = -1;
+    for (i = 0; i < region->width; i++)
+    {
+        if ((region->cols[i] >= c0) && (region->cols[i] < c1))
+        {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first < 0)
+        return;
+
+    for (j = 0; j < region->height; j++)
+    {
+        const unsigned int *src;
+        unsigned int *dst;
+
+        src = raster + region->rows[j] - region->col0;
+        dst = region->buffer + (size_t)j * region->width;
+        for (i = first; i <= last; i++)
+        {
+            unsigned int p;
+
+            p = src[(size_t)(region->cols[i] - c0) * cw];
+            dst[i] = (TIFFGetA(p) << 24) | (TIFFGetR(p) << 16) |
+                (TIFFGetG(p) << 8) | TIFFGetB(p);
+        }
+    }
+}
+
+#define BIT_GET(row_, c_) (((row_)[(c_) >> 3] >> (7 - ((c_) & 7))) & 1)
+
+/*
+ * stores the sampled pixels of the source rows [c0, c1) of a bilevel
+ * page in the region, bits being the strip starting at c0
+ */
+static void
+_etui_tiff_region_bits_fill(const Etui_Tiff_Region *region, const unsigned char *bits,
+                            unsigned int c0, unsigned int c1)
+{
+    int first;
+    int last;
+    int i;
+    int j;
+
+    if (!region->swap)
+    {
+        for (j = 0; j < region->height; j++)
+        {
+            const unsigned char *src;
+            unsigned int *dst;
+            unsigned int c;
+
+            if ((region->rows[j] < c0) || (region->rows[j] >= c1))
+                continue;
+
+            src = bits + (size_t)(region->rows[j] - c0) * region->scanline;
+            dst = region->buffer + (size_t)j * region->width;
+
+            if (!region->bytes)
+            {
+                for (i = 0; i < region->width; i++)
+                {
+                    c = region->cols[i];
+                    dst[i] = region->colors[BIT_GET(src, c)];
+                }
+                continue;
+            }
+
+            /* unscaled columns: a whole byte gives 8 pixels at once */
+            c = region->cols[0];
+            for (i = 0; (i < region->width) && (c & 7); i++, c++)
+                dst[i] = region->colors[BIT_GET(src, c)];
+            for (; (i + 8) <= region->width; i += 8, c += 8)
+                memcpy(dst + i, region->bytes[src[c >> 3]], 8 * sizeof(unsigned int));
+            for (; i < region->width; i++, c++)
+                dst[i] = region->colors[BIT_GET(src, c)];
+        }
+        return;
+    }
+
+    /* the columns sampling the strip are contiguous, cols is monotonic */
+    first = -1;
+    last = -1;
+    for (i = 0; i < region->width; i++)
+    {
+        if ((region->cols[i] >= c0) && (region->cols[i] < c1))
+        {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first < 0)
+        return;
+
+    for (j = 0; j < region->height; j++)
+    {
+        unsigned int *dst;
+        unsigned int c;
+
+        c = region->rows[j];
+        dst = region->buffer + (size_t)j * region->width;
+        for (i = first; i <= last; i++)
+        {
+            const unsigned char *src;
+
+            src = bits + (size_t)(region->cols[i] - c0) * region->scanline;
+            dst[i] = region->colors[BIT_GET(src, c)];
+        }
+    }
+}
+
+#undef BIT_GET
+
+static void
+_etui_tiff_worker_run(Etui_Tiff_Worker *w)
+{
+    Etui_Tiff_Region *region;
+    Eina_Bool res;
+    int k;
+
+    region = w->region;
+
+    while (1)
+    {
+        unsigned int c0;
+        unsigned int c1;
+
+        eina_lock_take(&region->lock);
+        if (ETUI_MODULE_CANCELLED(region->cancel))
+            region->res = EINA_FALSE;
+        k = region->res ? region->next++ : region->chunks_nbr;
+        eina_lock_release(&region->lock);
+
+        if (k >= region->chunks_nbr)
+            break;
+
+        c0 = region->chunks[k];
+        c1 = c0 + region->chunk;
+        if (c1 > region->src_h)
+            c1 = region->src_h;
+
+        if (region->bilevel)
+        {
+            /* the chunk is a strip, decoded without the RGBA conversion */
+            res = (TIFFReadEncodedStrip(w->img.tif,
+                                        TIFFComputeStrip(w->img.tif, c0, 0),
+                                        w->raster, (tmsize_t)-1) >= 0);
+        }
+        else
+        {
+            /* only the strips or tiles of the chunk and the columns are read */
+            w->img.row_offset = c0;
+            w->img.col_offset = region->col0;
+            res = TIFFRGBAImageGet(&w->img, w->raster,
+                                   region->col1 - region->col0, c1 - c0);
+        }
+
+        if (!res)
+        {
+            eina_lock_take(&region->lock);
+            region->res = EINA_FALSE;
+            eina_lock_release(&region->lock);
+            break;
+        }
+
+        if (region->bilevel)
+            _etui_tiff_region_bits_fill(region, (const unsigned char *)w->raster,
+                                        c0, c1);
+        else
+            _etui_tiff_region_fill(region, w->raster, c0, c1);
+    }
+
+    w->img.row_offset = 0;
+    w->img.col_offset = 0;
+}
+
+static void *
+_etui_tiff_worker_thread(void *data, Eina_Thread t EINA_UNUSED)
+{
+    _etui_tiff_worker_run((Etui_Tiff_Worker *)data);
+
+    return NULL;
+}
+
+/*
+ * Decodes the region (x, y, width, height) of the page, scaled to
+ * dst_w x dst_h and rotated, in buffer. img is begun on the directory at
+ * offset (0 if unknown) and is used by the calling thread. Only the strips or tiles
+ * sampled by the region are read, and large regions are shared between
+ * threads, each with its own handle on the mapping. The memory used is
+ * a chunk per thread, whatever the size of the page. The strips of 1 bit
+ * pages are expanded from the packed bits, without RGBA raster.
+ */
+static Eina_Bool
+_etui_tiff_region_get(Etui_Module_Data *md, toff_t offset, TIFFRGBAImage *img,
+                      int dst_w, int dst_h, Etui_Rotation rotation,
+                      unsigned int *buffer, int x, int y, int width, int height,
+                      const Etui_Module_Cancel *cancel)
+{
+    Etui_Tiff_Worker workers[ETUI_TIFF_WORKERS_MAX];
+    Etui_Tiff_Region region;
+    unsigned int *lines;
+    unsigned int *sampled;
+    size_t chunk_size;
+    size_t area;
+    int sampled_nbr;
+    int workers_nbr;
+    int w;
+    int h;
+    int i;
+
+    if (ETUI_MODULE_CANCELLED(cancel))
+        return EINA_FALSE;
+
+    memset(&region, 0, sizeof(region));
+    region.cancel = cancel;
+    region.buffer = buffer;
+    region.width = width;
+    region.height = height;
+    region.swap = ((rotation == ETUI_ROTATION_90) ||
+                   (rotation == ETUI_ROTATION_270));
+    region.src_h = img->height;
+    region.res = EINA_TRUE;
+
+    /* size of the scaled image before the rotation */
+    w = region.swap ? dst_h : dst_w;
+    h = region.swap ? dst_w : dst_h;
+
+    lines = (unsigned int *)malloc((width + height) * sizeof(unsigned int));
+    if (!lines)
+        return EINA_FALSE;
+    region.cols = lines;
+    region.rows = lines + width;
+
+    /* same sampling as _etui_tiff_raster_convert() */
+    for (i = 0; i < width; i++)
+    {
+        int c;
+
+        c = x + i;
+        switch (rotation)
+        {
+            case ETUI_ROTATION_90:
+                region.cols[i] = (size_t)(h - 1 - c) * img->height / h;
+                break;
+            case ETUI_ROTATION_180:
+                region.cols[i] = (size_t)(w - 1 - c) * img->width / w;
+                break;
+            case ETUI_ROTATION_270:
+                region.cols[i] = (size_t)c * img->height / h;
+                break;
+            default:
+                region.cols[i] = (size_t)c * img->width / w;
+                break;
+        }
+    }
+    for (i = 0; i < height; i++)
+    {
+        int r;
+
+        r = y + i;
+        switch (rotation)
+        {
+            case ETUI_ROTATION_90:
+                region.rows[i] = (size_t)r * img->width / w;
+                break;
+            case ETUI_ROTATION_180:
+                region.rows[i] = (size_t)(h - 1 - r) * img->height / h;
+                break;
+            case ETUI_ROTATION_270:
+                region.rows[i] = (size_t)(w - 1 - r) * img->width / w;
+                break;
+            default:
+                region.rows[i] = (size_t)r * img->height / h;
+                break;
+        }
+    }
+
+    /* source columns and sampled source rows (both are monotonic) */
+    if (region.swap)
+    {
+        region.col0 = region.rows[0];
+        region.col1 = region.rows[height - 1];
+        sampled = region.cols;
+        sampled_nbr = width;
+    }
+    else
+    {
+        region.col0 = region.cols[0];
+        region.col1 = region.cols[width - 1];
+        sampled = region.rows;
+        sampled_nbr = height;
+    }
+    if (region.col0 > region.col1)
+    {
+        unsigned int tmp;
+
+        tmp = region.col0;
+        region.col0 = region.col1;
+        region.col1 = tmp;
+    }
+    region.col1++;
+
+    if (TIFFIsTiled(img->tif))
+    {
+        if (!TIFFGetField(img->tif, TIFFTAG_TILELENGTH, &region.chunk))
+            region.chunk = img->height;
+    }
+    else
+        TIFFGetFieldDefaulted(img->tif, TIFFTAG_ROWSPERSTRIP, &region.chunk);
+    if ((region.chunk == 0) || (region.chunk > img->height))
+        region.chunk = img->height;
+
+    region.chunks = (unsigned int *)malloc(sampled_nbr * sizeof(unsigned int));
+    if (!region.chunks)
+    {
+        free(lines);
+        return EINA_FALSE;
+    }
+
+    chunk_size = (size_t)(region.col1 - region.col0) * region.chunk * sizeof(unsigned int);
+    if ((img->bitspersample == 1) && (img->samplesperpixel == 1) &&
+        ((img->photometric == PHOTOMETRIC_MINISWHITE) ||
+         (img->photometric == PHOTOMETRIC_MINISBLACK)) &&
+        !TIFFIsTiled(img->tif))
+    {
+        region.bilevel = EINA_TRUE;
+        region.scanline = TIFFScanlineSize(img->tif);
+        chunk_size = TIFFStripSize(img->tif);
+        region.colors[0] = (img->photometric == PHOTOMETRIC_MINISWHITE) ? 0xffffffff : 0xff000000;
+        region.colors[1] = (img->photometric == PHOTOMETRIC_MINISWHITE) ? 0xff000000 : 0xffffffff;
+
+        /* unscaled and not rotated */
+        if (!region.swap && (width >= 64) &&
+            (region.cols[width - 1] == (region.cols[0] + width - 1)))
+        {
+            region.bytes = (unsigned int (*)[8])malloc(256 * sizeof(region.bytes[0]));
+            if (region.bytes)
+            {
+                for (i = 0; i < 256; i++)
+                {
+                    int b;
+
+                    for (b = 0; b < 8; b++)
+                        region.bytes[i][b] = region.colors[(i >> (7 - b)) & 1];
+                }
+            }
+        }
+    }
+    for (i = 0; i < sampled_nbr; i++)
+    {
+        unsigned int c0;
+
+        c0 = (sampled[i] / region.chunk) * region.chunk;
+        if ((region.chunks_nbr == 0) ||
+            (region.chunks[region.chunks_nbr - 1] != c0))
+            region.chunks[region.chunks_nbr++] = c0;
+    }
+
+    area = (size_t)(region.col1 - region.col0) * region.chunks_nbr * region.chunk;
+    workers_nbr = 1;
+    if (offset && (area >= ETUI_TIFF_PARALLEL_AREA_MIN))
+    {
+        workers_nbr = etui_page_threads_get();
+        if (workers_nbr > ETUI_TIFF_WORKERS_MAX)
+            workers_nbr = ETUI_TIFF_WORKERS_MAX;
+        if (workers_nbr > region.chunks_nbr)
+            workers_nbr = region.chunks_nbr;
+        if (workers_nbr < 1)
+            workers_nbr = 1;
+    }
+
+    if ((chunk_size == 0) || !eina_lock_new(&region.lock))
+    {
+        free(region.bytes);
+        free(region.chunks);
+        free(lines);
+        return EINA_FALSE;
+    }
+
+    memset(workers, 0, sizeof(workers));
+    for (i = 0; i < workers_nbr; i++)
+    {
+        Etui_Tiff_Worker *worker;
+
+        worker = workers + i;
+        worker->region = &region;
+        worker->raster = (unsigned int *)_TIFFmalloc(chunk_size);
+        if (!worker->raster)
+            break;
+
+        if (i == 0)
+        {
+            worker->img = *img;
+            continue;
+        }
+
+        {
+            char emsg[1024];
+            TIFF *tiff;
+
+            tiff = _etui_tiff_handle_get(md, i - 1, offset);
+            if (!tiff || !TIFFRGBAImageBegin(&worker->img, tiff, 0, emsg))
+                break;
+        }
+        worker->img.req_orientation = ORIENTATION_TOPLEFT;
+        worker->has_begun = 1;
+
+        if (eina_thread_create(&worker->thread, EINA_THREAD_NORMAL, -1,
+                               _etui_tiff_worker_thread, worker))
+            worker->threaded = 1;
+        else
+            break;
+    }
+
+    /* the calling thread decodes too, with a copy of img */
+    if (workers[0].raster)
+        _etui_tiff_worker_run(&workers[0]);
+    else
+        region.res = EINA_FALSE;
+
+    for (i = 0; i < workers_nbr; i++)
+    {
+        if (workers[i].threaded)
+            eina_thread_join(workers[i].thread);
+        if (workers[i].has_begun)
+            TIFFRGBAImageEnd(&workers[i].img);
+        if (workers[i].raster)
+            _TIFFfree(workers[i].raster);
+    }
+
+    eina_lock_free(&region.lock);
+    free(region.bytes);
+    free(region.chunks);
+    free(lines);
+
+    return region.res;
+}
+
 /* Virtual functions */
 
 static void *
@@ -213,7 +1379,13 @@ _etui_tiff_init(const Etui_File *ef)
 
     DBG("init module");
 
-    md->doc.tiff = TIFFOpen(etui_file_filename_get(ef), "r");
+    md->doc.io.data = (const unsigned char *)etui_file_base_get(ef);
+    md->doc.io.size = etui_file_size_get(ef);
+    if (md->doc.io.data)
+        md->doc.tiff = _etui_tiff_io_open(etui_file_filename_get(ef),
+                                          &md->doc.io);
+    else
+        md->doc.tiff = TIFFOpen(etui_file_filename_get(ef), "r");
     if (!md->doc.tiff)
         goto free_md;
 
@@ -224,7 +1396,11 @@ _etui_tiff_init(const Etui_File *ef)
         goto close_tiff;
     }
 
-    md->doc.page_nbr = TIFFNumberOfDirectories(md->doc.tiff);
+    md->doc.pages = _etui_tiff_directories_index(ef);
+    if (md->doc.pages)
+        md->doc.page_nbr = eina_inarray_count(md->doc.pages);
+    else
+        md->doc.page_nbr = TIFFNumberOfDirectories(md->doc.tiff);
     md->page.page_num = -1;
     md->page.rotation = ETUI_ROTATION_0;
     md->page.scale = 1.0f;
@@ -246,6 +1422,7 @@ static void
 _etui_tiff_shutdown(void *d)
 {
     Etui_Module_Data *md;
+    int i;
 
     DBG("shutdown module");
 
@@ -256,6 +1433,13 @@ _etui_tiff_shutdown(void *d)
 
     if (md->page.raster)
         _TIFFfree(md->page.raster);
+    for (i = 0; i < (ETUI_TIFF_WORKERS_MAX - 1); i++)
+    {
+        if (md->doc.handles[i].tiff)
+            TIFFClose(md->doc.handles[i].tiff);
+    }
+    if (md->doc.pages)
+        _etui_tiff_pages_free(md->doc.pages);
     free(md->doc.info);
     TIFFClose(md->doc.tiff);
     free(md);
@@ -356,7 +1540,7 @@ _etui_tiff_page_set(void *d, int page_num)
     if (page_num == md->page.page_num)
         return EINA_FALSE;
 
-    if (!TIFFSetDirectory(md->doc.tiff, page_num))
+    if (!_etui_tiff_directory_set(md, page_num))
         return EINA_FALSE;
 
     md->page.page_num = page_num;
@@ -474,6 +1658,12 @@ _etui_tiff_page_render_pre(void *d)
 {
     char emsg[1024];
     Etui_Module_Data *md;
+    const Etui_Tiff_Image *image = NULL;
+    unsigned int *raster;
+    unsigned int page_w;
+    unsigned int page_h;
+    unsigned int width;
+    unsigned int height;
 
     if (!d)
         return;
@@ -485,40 +1675,55 @@ _etui_tiff_page_render_pre(void *d)
     md->page.has_begun = 0;
     md->page.has_rastered = 0;
     if (md->page.raster)
+    {
         _TIFFfree(md->page.raster);
+        md->page.raster = NULL;
+    }
 
-    if (!TIFFRGBAImageOK(md->doc.tiff, emsg))
+    if (!TIFFGetField(md->doc.tiff, TIFFTAG_IMAGEWIDTH, &page_w) ||
+        !TIFFGetField(md->doc.tiff, TIFFTAG_IMAGELENGTH, &page_h))
         return;
 
-    if (TIFFRGBAImageBegin(&md->page.img, md->doc.tiff, 0, emsg))
-    {
-        unsigned int *raster;
-        unsigned int width;
-        unsigned int height;
+    /* scale first */
+    width = (unsigned int)(page_w * md->page.scale);
+    height = (unsigned int)(page_h * md->page.scale);
 
-        md->page.img.req_orientation = ORIENTATION_TOPLEFT;
+    /* the smallest level of the pyramid covering the scaled page is decoded */
+    image = _etui_tiff_level_get(md, md->page.page_num, width, height);
+    md->page.offset = image ? image->offset : 0;
+    if (image && !_etui_tiff_offset_set(md->doc.tiff, image->offset))
+        goto restore_directory;
 
-        /* scale first */
-        width = (unsigned int)(md->page.img.width * md->page.scale);
-        height = (unsigned int)(md->page.img.height * md->page.scale);
-        raster = (unsigned int *)_TIFFmalloc(width * height * sizeof(unsigned int));
-        if (!raster)
-            return;
+    if (!TIFFRGBAImageOK(md->doc.tiff, emsg) ||
+        !TIFFRGBAImageBegin(&md->page.img, md->doc.tiff, 0, emsg))
+    {
+        TIFFError("Etui", "%s", emsg);
+        goto restore_directory;
+    }
 
-        evas_object_image_size_set(md->efl.obj, width, height);
-        evas_object_image_filled_set(md->efl.obj, EINA_TRUE);
-        evas_object_resize(md->efl.obj, width, height);
-        md->page.width = width;
-        md->page.height = height;
-        md->page.raster = raster;
-        md->page.has_begun = 1;
+    md->page.img.req_orientation = ORIENTATION_TOPLEFT;
+
+    raster = (unsigned int *)_TIFFmalloc(width * height * sizeof(unsigned int));
+    if (!raster)
+    {
+        TIFFRGBAImageEnd(&md->page.img);
+        goto restore_directory;
     }
-    else
-        TIFFError("Etui", "%s", emsg);
+
+    evas_object_image_size_set(md->efl.obj, width, height);
+    evas_object_image_filled_set(md->efl.obj, EINA_TRUE);
+    evas_object_resize(md->efl.obj, width, height);
+    md->page.width = width;
+    md->page.height = height;
+    md->page.raster = raster;
+    md->page.has_begun = 1;
+
+  restore_directory:
+    _etui_tiff_directory_restore(md);
 }
 
 static void
-_etui_tiff_page_render(void *d)
+_etui_tiff_page_render(void *d, const Etui_Module_Cancel *cancel)
 {
     Etui_Module_Data *md;
 
@@ -531,9 +1736,25 @@ _etui_tiff_page_render(void *d)
     if (!md->page.has_begun)
         return;
 
-    if (TIFFRGBAImageGet(&md->page.img, md->page.raster,
-                         md->page.width, md->page.height))
+    /* img reads the directory it has been begun on */
+    if (md->page.offset && !_etui_tiff_offset_set(md->doc.tiff, md->page.offset))
+        goto restore_directory;
+
+    if (md->page.img.orientation == ORIENTATION_TOPLEFT)
+    {
+        if (_etui_tiff_region_get(md, md->page.offset, &md->page.img,
+                                  md->page.width, md->page.height,
+                                  ETUI_ROTATION_0, md->page.raster,
+                                  0, 0, md->page.width, md->page.height,
+                                  cancel))
+            md->page.has_rastered = 1;
+    }
+    else if (_etui_tiff_rgba_image_get(&md->page.img, md->page.raster,
+                                       md->page.width, md->page.height, cancel))
         md->page.has_rastered = 1;
+
+  restore_directory:
+    _etui_tiff_directory_restore(md);
 }
 
 static void
@@ -559,6 +1780,141 @@ _etui_tiff_page_render_end(void *d)
 }
 
 
+static Eina_Bool
+_etui_tiff_page_raster_size(void *d, int page_num, double scale, Etui_Rotation rotation, int *width, int *height)
+{
+    Etui_Module_Data *md;
+    unsigned int w;
+    unsigned int h;
+    Eina_Bool res;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if ((page_num < 0) || (page_num >= md->doc.page_nbr))
+        return EINA_FALSE;
+
+    if (md->doc.pages)
+    {
+        const Etui_Tiff_Page *page;
+
+        page = (const Etui_Tiff_Page *)eina_inarray_nth(md->doc.pages, page_num);
+        w = page->image.width;
+        h = page->image.height;
+        res = (w && h);
+    }
+    else
+    {
+        if (!_etui_tiff_directory_set(md, page_num))
+            return EINA_FALSE;
+
+        res = (TIFFGetField(md->doc.tiff, TIFFTAG_IMAGEWIDTH, &w) &&
+               TIFFGetField(md->doc.tiff, TIFFTAG_IMAGELENGTH, &h));
+        _etui_tiff_directory_restore(md);
+    }
+    if (!res)
+        return EINA_FALSE;
+
+    w = (unsigned int)(w * scale);
+    h = (unsigned int)(h * scale);
+    if (!w) w = 1;
+    if (!h) h = 1;
+
+    if ((rotation == ETUI_ROTATION_90) || (rotation == ETUI_ROTATION_270))
+    {
+        if (width) *width = h;
+        if (height) *height = w;
+    }
+    else
+    {
+        if (width) *width = w;
+        if (height) *height = h;
+    }
+
+    return EINA_TRUE;
+}
+
+static Eina_Bool
+_etui_tiff_page_raster(void *d, int page_num, double scale, Etui_Rotation rotation, unsigned int *buffer, int x, int y, int width, int height, const Etui_Module_Cancel *cancel)
+{
+    char emsg[1024];
+    Etui_Module_Data *md;
+    TIFFRGBAImage img;
+    const Etui_Tiff_Image *image;
+    unsigned int *raster;
+    toff_t offset = 0;
+    int dst_w;
+    int dst_h;
+    Eina_Bool res = EINA_FALSE;
+
+    if (!d)
+        return EINA_FALSE;
+
+    md = (Etui_Module_Data *)d;
+
+    if (!_etui_tiff_page_raster_size(d, page_num, scale, rotation, &dst_w, &dst_h))
+        return EINA_FALSE;
+
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) ||
+        ((x + width) > dst_w) || ((y + height) > dst_h))
+        return EINA_FALSE;
+
+    /* the smallest level of the pyramid covering the scaled page is decoded */
+    if ((rotation == ETUI_ROTATION_90) || (rotation == ETUI_ROTATION_270))
+        image = _etui_tiff_level_get(md, page_num, dst_h, dst_w);
+    else
+        image = _etui_tiff_level_get(md, page_num, dst_w, dst_h);
+    if (image)
+    {
+        offset = image->offset;
+        if (!_etui_tiff_offset_set(md->doc.tiff, offset))
+            goto restore_directory;
+    }
+    else if (!_etui_tiff_directory_set(md, page_num))
+        goto restore_directory;
+
+    if (!TIFFRGBAImageOK(md->doc.tiff, emsg) ||
+        !TIFFRGBAImageBegin(&img, md->doc.tiff, 0, emsg))
+    {
+        TIFFError("Etui", "%s", emsg);
+        goto restore_directory;
+    }
+
+    img.req_orientation = ORIENTATION_TOPLEFT;
+
+    /* only what the region shows is decoded */
+    if (img.orientation == ORIENTATION_TOPLEFT)
+    {
+        res = _etui_tiff_region_get(md, offset, &img, dst_w, dst_h, rotation,
+                                    buffer, x, y, width, height, cancel);
+        goto end_image;
+    }
+
+    /* images stored in another orientation are flipped by libtiff as a whole */
+    raster = (unsigned int *)_TIFFmalloc(img.width * img.height * sizeof(unsigned int));
+    if (!raster)
+        goto end_image;
+
+    if (_etui_tiff_rgba_image_get(&img, raster, img.width, img.height, cancel))
+    {
+        _etui_tiff_raster_convert(raster, img.width, img.height,
+                                  buffer, dst_w, dst_h,
+                                  x, y, width, height, rotation);
+        res = EINA_TRUE;
+    }
+
+    _TIFFfree(raster);
+  end_image:
+    TIFFRGBAImageEnd(&img);
+  restore_directory:
+    _etui_tiff_directory_restore(md);
+
+    return res;
+}
+
+
 static Etui_Module_Func _etui_module_func_tiff =
 {
     /* .init              */ _etui_tiff_init,
@@ -579,7 +1935,10 @@ static Etui_Module_Func _etui_module_func_tiff =
     /* .page_render_pre   */ _etui_tiff_page_render_pre,
     /* .page_render       */ _etui_tiff_page_render,
     /* .page_render_end   */ _etui_tiff_page_render_end,
-    /* .api_get           */ NULL
+    /* .api_get           */ NULL,
+    /* .page_raster_size  */ _etui_tiff_page_raster_size,
+    /* .page_raster       */ _etui_tiff_page_raster,
+    /* .page_text_get     */ NULL
 };
 
 /**
@@ -622,7 +1981,7 @@ module_open(Etui_Module *em)
 }
 
 static void
-module_close(Etui_Module *em)
+module_close(Etui_Module *em EINA_UNUSED)
 {
     if (_etui_module_tiff_init_count > 1)
     {
@@ -637,8 +1996,7 @@ module_close(Etui_Module *em)
 
     DBG("shutdown tiff module");
 
-    /* shutdown module here */
-    em->functions->shutdown(em->data);
+    /* documents are shut down by etui_file_free() */
 
     /* shutdown external libraries here */
 